@@ -0,0 +1,8 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+// On-target benchmarks, run as `smart_doorbell --bench <name> [args...]`.
+// Returns the process exit code.
+int bench_run(int argc, char* argv[]);
+
+#endif
@@ -0,0 +1,21 @@
+#ifndef BLOCK_MOTION_H
+#define BLOCK_MOTION_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Compressed-domain motion detection on per-8x8-block luma coefficients, as
+// returned by jpeg_decode_luma_coefs() (planar: DC, then optionally the first
+// horizontal and vertical AC terms).
+//
+// A block counts as changed when its DC moved by more than `dc_thresh`, or,
+// with 3 coefficients per block, when |dAC_h| + |dAC_v| exceeds `ac_thresh`
+// (an edge moving inside a block without changing its mean brightness).
+// The background model has the same layout and is blended with the same Q8
+// running average as the pixel engine:
+//   bg = (bg * (256 - alpha) + curr * alpha + 128) >> 8
+// Returns the number of changed blocks.
+size_t block_motion_diff_update(int16_t* bg, const int16_t* curr, size_t blocks, int coefs_per_block,
+                                int dc_thresh, int ac_thresh, uint8_t alpha);
+
+#endif
@@ -1,12 +1,73 @@
 #ifndef CAMERA_H
 #define CAMERA_H
 #include <stdbool.h>
+#include <stddef.h>
+
+// Pipeline counters (latencies are per-frame averages in milliseconds)
+typedef struct {
+    unsigned long captured;       // Frames fetched from the ESP32 (stream parts or stills)
+    unsigned long analyzed;       // Frames decoded and checked for motion
+    unsigned long dropped;        // Frames replaced by a newer one before analysis
+    unsigned long fetch_failures; // Failed stills, or stream read errors/reconnects
+    double fetch_ms;
+    double decode_ms;
+    double analyze_ms;
+    double latency_ms;            // Fetch start to motion verdict
+    unsigned long pool_failures;  // Buffer requests the frame pool could not satisfy (frame skipped)
+    unsigned long warm_allocs;    // Pool, HTTP and libjpeg heap allocations since the first analyzed frame (0 when warm)
+} camera_stats_t;
+
+// Where frames come from
+typedef enum {
+    CAMERA_SOURCE_STREAM = 0, // Subscribe once to the ESP32's MJPEG stream at "/" (default)
+    CAMERA_SOURCE_STILL,      // Request /still every capture interval
+} camera_source_t;
+
+// What to do when analysis falls behind capture
+typedef enum {
+    CAMERA_DROP_STALE = 0, // Replace the unanalyzed frame with the newest one (default, lowest latency)
+    CAMERA_DROP_NONE,      // Hold the new frame until analysis takes the previous one
+} camera_drop_policy_t;
+
+// How frames are compared against the background
+typedef enum {
+    CAMERA_ENGINE_PIXEL = 0, // Decode luma at the decode scale, compare pixels (default)
+    CAMERA_ENGINE_DC,        // Compare per-8x8-block DC coefficients; no IDCT
+    CAMERA_ENGINE_DC_AC,     // DC plus the first horizontal and vertical AC coefficients
+} camera_motion_engine_t;
 
 void camera_init(void);
-// Download image from ESP32
-int camera_capture(const char* ip_address);
-// Check if downloaded image has motion
-bool camera_check_motion(void);
+// Select the frame source. Takes effect on the next camera_start().
+void camera_set_source(camera_source_t source);
+// Select the frame-drop policy. Can be changed while running.
+void camera_set_drop_policy(camera_drop_policy_t policy);
+// Start background capture + motion analysis threads for the ESP32 at ip_address
+int camera_start(const char* ip_address);
+// Stop the background threads
+void camera_stop(void);
+// Readable when motion was detected (for epoll); then call camera_poll_motion()
+int camera_get_event_fd(void);
+// Non-blocking: true if motion was detected since the last call
+bool camera_poll_motion(void);
+// Downscale factor for motion analysis decode (1, 2, 4 or 8). Returns -1 if unsupported.
+int camera_set_decode_scale(int denom);
+// Select the motion engine. Can be changed while running.
+void camera_set_motion_engine(camera_motion_engine_t engine);
+// Write the latest frame to /tmp/visitor.jpg (for alerts). Returns 0 on success.
+int camera_save_snapshot(void);
+// Pre-event ring size in bytes and the window exported per event (default
+// 4 MB / 5 s). Call before camera_start(). Returns -1 while running.
+int camera_set_preroll(size_t bytes, int window_ms);
+// Have the export thread write the last pre-event window to /tmp/preroll
+// (index.txt + frame_NNN.jpg). Sets *ticket; returns -1 if not running.
+int camera_request_preroll(unsigned int* ticket);
+// Readable when a requested export has finished (for epoll); then call camera_poll_preroll()
+int camera_get_preroll_fd(void);
+// Highest ticket whose export has finished; *frames is what it wrote, or -1
+unsigned int camera_poll_preroll(int* frames);
+// Frame rate, drops and stage latencies
+void camera_get_stats(camera_stats_t* stats);
+void camera_print_stats(void);
 void camera_cleanup(void);
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,68 @@
+#ifndef CREDENTIAL_STORE_H
+#define CREDENTIAL_STORE_H
+
+#include <stdint.h>
+#include <time.h>
+
+// Who may open the door: RFID tags and PINs, each with an optional validity
+// window. credential_store_build() turns a text list into a binary file with
+// a hash index over the keys; the doorbell maps that file read-only and
+// answers each lookup with one or two probes, comparing keys in constant
+// time. When the file is replaced (rename() over it, as the builder does)
+// the new one is mapped and swapped in whole, so a lookup sees either the
+// old set or the new one. Lookups and reloads run on the reactor thread.
+#define CREDENTIAL_MAX_KEY 16
+#define CREDENTIAL_MAX_LABEL 24
+
+typedef enum {
+    CREDENTIAL_RFID = 1,   // Key: UID bytes
+    CREDENTIAL_PIN = 2     // Key: one of 'U', 'D', 'L', 'R' per stick press
+} credential_kind_t;
+
+typedef enum {
+    CREDENTIAL_UNKNOWN = 0,
+    CREDENTIAL_VALID,
+    CREDENTIAL_NOT_YET_VALID,
+    CREDENTIAL_EXPIRED
+} credential_result_t;
+
+typedef struct {
+    unsigned long entries;     // In the mapped file
+    unsigned long lookups;
+    unsigned long granted;
+    unsigned long reloads;
+    unsigned long reload_failures; // The previous set stayed in use
+} credential_stats_t;
+
+// Map the store at `path` and watch it for replacement.
+// Returns 0, or -1 if it is missing or malformed.
+int credential_store_open(const char* path);
+
+// Map the file again and swap it in. Returns 0, or -1 if the new file is
+// unusable, in which case the current set stays in use.
+int credential_store_reload(void);
+
+// inotify fd that becomes readable when the file may have been replaced
+// (-1 if not watching); pass readiness to credential_store_handle_watch()
+int credential_store_get_watch_fd(void);
+void credential_store_handle_watch(void);
+
+// Look up a key at wall-clock time `now`. On a match, *label (if not NULL)
+// points at the credential's NUL-terminated label until the next reload.
+credential_result_t credential_store_check(credential_kind_t kind, const uint8_t* key, int key_len,
+                                           time_t now, const char** label);
+
+// Offline builder. Each line of `text_path` is
+//   <rfid|pin> <key> <valid_from|-> <valid_until|-> [label]
+// with RFID keys in hex, PINs as U/D/L/R letters and times in Unix seconds
+// ('-' for no bound); blank lines and lines starting with '#' are skipped.
+// Writes `db_path` atomically. Returns 0, or -1 after reporting the error.
+int credential_store_build(const char* text_path, const char* db_path);
+
+void credential_store_get_stats(credential_stats_t* stats);
+
+void credential_store_print_stats(void);
+
+void credential_store_close(void);
+
+#endif
@@ -0,0 +1,37 @@
+#ifndef FFT_Q15_H
+#define FFT_Q15_H
+
+#include <stdint.h>
+
+// In-place radix-2 FFT on Q15 data held as separate real and imaginary arrays.
+//
+// Every stage halves its outputs, so the result is the DFT scaled by 1/n and
+// cannot overflow as long as the input magnitudes stay within +/-16384.
+// Twiddles are Q15 with rounding multiplies; every implementation produces
+// bit-identical results to the scalar one.
+#define FFT_Q15_MAX_LOG2 10 // Up to 1024 points
+
+typedef struct {
+    const char* name;
+
+    // Transform 2^log2n points (1 <= log2n <= FFT_Q15_MAX_LOG2)
+    void (*fft)(int16_t* re, int16_t* im, int log2n);
+} fft_q15_t;
+
+// Fastest implementation this CPU supports (NEON or scalar).
+// Chosen on first call; a candidate that disagrees with the scalar reference
+// on the built-in self-test is skipped.
+const fft_q15_t* fft_q15_get(void);
+
+// The portable reference implementation
+const fft_q15_t* fft_q15_scalar(void);
+
+// Every implementation compiled in and supported by this CPU (scalar first).
+// Fills up to `max` entries and returns how many were written.
+int fft_q15_list(const fft_q15_t** out, int max);
+
+// Compare `f` against the scalar reference on pseudo-random data at every
+// size. Returns 0 if the results are identical, -1 otherwise.
+int fft_q15_verify(const fft_q15_t* f);
+
+#endif
@@ -0,0 +1,43 @@
+#ifndef FRAME_POOL_H
+#define FRAME_POOL_H
+
+#include <stddef.h>
+
+// Preallocated, size-classed buffer pool for the camera pipeline. All blocks
+// are carved from one arena allocated (and pre-faulted) at init, so borrowing
+// and returning frames in steady state never touches the heap.
+
+// One size class: `count` blocks of `size` bytes
+typedef struct {
+    size_t size;
+    int count;
+} frame_pool_class_t;
+
+typedef struct {
+    size_t budget;             // Configured memory budget in bytes
+    size_t arena_bytes;        // Bytes actually reserved for blocks
+    size_t in_use;             // Bytes currently borrowed (whole blocks)
+    size_t peak_in_use;
+    unsigned long borrows;     // Successful frame_pool_get() calls
+    unsigned long failures;    // Requests no free block could satisfy
+    unsigned long heap_allocs; // Heap allocations made by the pool (1 after init)
+} frame_pool_stats_t;
+
+// Reserve the arena for `classes` (sorted by size, smallest first). Fails with
+// -1 if the classes do not fit in `budget` bytes or the arena cannot be allocated.
+int frame_pool_init(const frame_pool_class_t* classes, int n, size_t budget);
+
+// Borrow a block of at least `size` bytes from the smallest class that has one
+// free. Sets *cap to the block size. Returns NULL if none is available.
+// Thread-safe.
+void* frame_pool_get(size_t size, size_t* cap);
+
+// Return a block from frame_pool_get(). NULL is ignored. Thread-safe.
+void frame_pool_put(void* block);
+
+void frame_pool_get_stats(frame_pool_stats_t* stats);
+
+// Free the arena. Every block must have been returned.
+void frame_pool_cleanup(void);
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef FRAME_RING_H
+#define FRAME_RING_H
+
+#include <stddef.h>
+
+// Pre-event history: the most recent JPEG frames, stored compressed and
+// back to back in one fixed-size byte ring with their capture timestamps.
+// Memory is reserved once at init; pushing a frame only copies bytes and
+// evicts the oldest frames it overwrites.
+
+typedef struct {
+    size_t capacity;          // Ring size in bytes
+    size_t bytes;             // Bytes held by buffered frames
+    int frames;               // Frames currently buffered
+    long long span_ms;        // Oldest to newest buffered frame
+    unsigned long pushed;     // Frames stored
+    unsigned long evicted;    // Frames overwritten by newer ones
+    unsigned long skipped;    // Frames not stored (ring frozen for export, or larger than the ring)
+    unsigned long exports;    // Successful frame_ring_export() calls
+} frame_ring_stats_t;
+
+// Reserve `capacity` bytes. Exports cover the last `window_ms` milliseconds.
+int frame_ring_init(size_t capacity, int window_ms);
+
+// Copy one JPEG into the ring, stamped with the current time. Thread-safe.
+void frame_ring_push(const unsigned char* jpg, size_t len);
+
+// Freeze the ring and write every frame from the last window to `dir` as
+// frame_000.jpg (oldest) onwards, plus index.txt with one line per frame:
+// "<file> <unix time ms> <ms before export>". index.txt is replaced
+// atomically, so readers never see a partial list. Frames pushed while the
+// export runs are skipped. Returns the number of frames written, or -1, in
+// which case index.txt is removed rather than left listing older frames.
+int frame_ring_export(const char* dir);
+
+void frame_ring_get_stats(frame_ring_stats_t* stats);
+void frame_ring_cleanup(void);
+
+#endif
@@ -0,0 +1,43 @@
+#ifndef HTTP_CLIENT_H
+#define HTTP_CLIENT_H
+
+#include <stddef.h>
+
+// Counters for the persistent HTTP connection (latencies in milliseconds)
+typedef struct {
+    unsigned long fetches;   // Successful GET requests (or stream parts received)
+    unsigned long failures;  // Failed GET requests / stream reads (connect, timeout, bad response)
+    unsigned long connects;  // TCP connections opened (stays at 1 while keep-alive holds)
+    double last_ms;          // Latency of the most recent successful GET (or wait for a stream part)
+    double avg_ms;           // Mean latency over all successful fetches
+    double max_ms;           // Worst latency seen
+    unsigned long allocs;    // Body buffer (re)allocations; stops once the largest frame has been seen
+} http_client_stats_t;
+
+// Set the server to talk to. Does not connect until the first request.
+// Returns 0 on success, -1 if the host cannot be resolved.
+int http_client_init(const char* host, int port, int timeout_ms);
+
+// GET `path` over the persistent HTTP/1.1 connection (reconnects if needed).
+// On success *body points at the response body inside an internal buffer that
+// stays valid until the next request. Returns 0 on success, -1 on failure.
+int http_client_get(const char* path, const unsigned char** body, size_t* len);
+
+// Open a long-lived streaming GET (e.g. the ESP32's multipart MJPEG stream at
+// "/") on a fresh connection. Returns 0 on success, -1 on failure.
+int http_client_stream_open(const char* path);
+
+// Read the next part of a multipart/x-mixed-replace stream opened with
+// http_client_stream_open(). Chunked transfer encoding is handled. On success
+// *body points at the part payload (e.g. one JPEG) inside the internal buffer,
+// valid until the next call. On failure the connection is closed and the
+// stream must be reopened. Each part counts as one fetch in the stats.
+int http_client_stream_next(const unsigned char** body, size_t* len);
+
+// Copy the current counters into `stats`
+void http_client_get_stats(http_client_stats_t* stats);
+
+// Close the connection and free the body buffer
+void http_client_cleanup(void);
+
+#endif
@@ -0,0 +1,11 @@
+#ifndef ISQRT_H
+#define ISQRT_H
+
+#include <stdint.h>
+
+// Integer square root, floor(sqrt(v)), by the bit-by-bit method: no floating
+// point and a fixed 32 iterations at most. Used to turn summed energies into
+// RMS levels (tamper_detector.c, vibration_classifier.c).
+int isqrt64(uint64_t v);
+
+#endif
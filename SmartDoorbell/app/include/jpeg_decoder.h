@@ -0,0 +1,54 @@
+#ifndef JPEG_DECODER_H
+#define JPEG_DECODER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef enum {
+    JPEG_DECODE_RGB = 0, // Packed RGB, 3 bytes per pixel
+    JPEG_DECODE_GRAY     // Luma plane, 1 byte per pixel (chroma is never decoded)
+} jpeg_decode_format_t;
+
+// Decode a JPEG held in memory into the requested pixel format.
+// `scale_denom` (1, 2, 4 or 8) downscales in the DCT domain, so 1/8 decodes
+// only the DC coefficient of each block. Uses the fast integer IDCT and no
+// fancy upsampling: the output is meant for analysis, not display.
+// Returns a malloc'd buffer (caller frees) or NULL on failure. Corrupt or
+// truncated input fails cleanly instead of terminating the process.
+unsigned char* jpeg_decode_mem(const unsigned char* jpg, size_t len, jpeg_decode_format_t format,
+                               int scale_denom, int* w, int* h);
+
+// Same as jpeg_decode_mem(), but decodes into the caller's buffer of `cap`
+// bytes (e.g. a frame pool block) instead of allocating one. Returns the
+// number of bytes the image needs; if that exceeds `cap`, nothing is decoded
+// (*w and *h are still set) and the call can be retried with a bigger buffer.
+// Returns -1 for invalid input.
+long jpeg_decode_mem_into(const unsigned char* jpg, size_t len, jpeg_decode_format_t format,
+                          int scale_denom, unsigned char* dst, size_t cap, int* w, int* h);
+
+// Read the luma DCT coefficients of every 8x8 block without running any IDCT
+// or colour conversion (entropy decoding only). `coefs_per_block` is 1 (DC) or
+// 3 (DC, first horizontal AC, first vertical AC). The result is planar: all DC
+// terms, then all horizontal AC terms, then all vertical AC terms, each plane
+// blocks_w * blocks_h values in raster order. Values are dequantized, so frames
+// encoded at different quality compare directly; DC is 8 * (mean luma - 128).
+// Returns a malloc'd buffer (caller frees) or NULL on failure.
+int16_t* jpeg_decode_luma_coefs(const unsigned char* jpg, size_t len, int coefs_per_block,
+                                int* blocks_w, int* blocks_h);
+
+// Caller-buffer variant of jpeg_decode_luma_coefs(), with the same contract as
+// jpeg_decode_mem_into(); `cap` and the return value are in bytes.
+long jpeg_decode_luma_coefs_into(const unsigned char* jpg, size_t len, int coefs_per_block,
+                                 int16_t* dst, size_t cap, int* blocks_w, int* blocks_h);
+
+// Each thread decodes with its own decompress object, kept between calls so
+// that its working memory is reused. Frees the calling thread's object; call
+// it before a decoding thread exits. Decoding again afterwards is allowed.
+void jpeg_decoder_release(void);
+
+// Heap allocations made for libjpeg's working memory since start-up, across
+// all threads. Stays flat while a thread keeps decoding frames of one size.
+// The output buffers of the allocating variants above are not included.
+unsigned long jpeg_decoder_heap_allocs(void);
+
+#endif
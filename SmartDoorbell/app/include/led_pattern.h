@@ -0,0 +1,35 @@
+#ifndef LED_PATTERN_H
+#define LED_PATTERN_H
+
+#include <stdbool.h>
+
+// Non-blocking LED sequences. Each LED has a resting level (e.g. red while
+// the door is locked) and plays at most one pattern at a time; every step is
+// a timer wheel callback, so the caller returns immediately. Flashes are
+// handed to the kernel's LED pattern trigger where available, leaving one
+// callback at the end. When a pattern ends the LED goes back to its resting
+// level. Reactor thread only.
+
+typedef enum {
+    LED_PATTERN_GREEN = 0,
+    LED_PATTERN_RED,
+    LED_PATTERN_COUNT
+} led_pattern_led_t;
+
+// Needs timer_wheel_init() first
+void led_pattern_init(void);
+
+// Change the resting level. Applied now, or when the current pattern ends.
+void led_pattern_set_rest(led_pattern_led_t led, bool on);
+
+// Hold `on` for `ms`, then return to rest. Replaces any running pattern.
+void led_pattern_hold(led_pattern_led_t led, bool on, int ms);
+
+// `n` on/off flashes spread over `total_ms`, then return to rest.
+// Replaces any running pattern.
+void led_pattern_flash(led_pattern_led_t led, int n, int total_ms);
+
+// Stop all patterns and switch both LEDs off
+void led_pattern_cleanup(void);
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef MOTION_KERNELS_H
+#define MOTION_KERNELS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Per-pixel kernels for background-subtraction motion detection on 8-bit luma.
+//
+// A pixel counts as changed when |curr - bg| > thresh. The background update is
+// a fixed-point running average with weight `alpha` in Q8 (alpha/256 of the new
+// frame):  bg = (bg * (256 - alpha) + curr * alpha + 128) >> 8
+// Every implementation produces bit-identical results to the scalar one.
+typedef struct {
+    const char* name;
+
+    // Count changed pixels without touching the background
+    size_t (*diff_count)(const uint8_t* bg, const uint8_t* curr, size_t n, uint8_t thresh);
+
+    // Blend curr into bg
+    void (*bg_update)(uint8_t* bg, const uint8_t* curr, size_t n, uint8_t alpha);
+
+    // Both in one pass over the data; returns the changed-pixel count
+    size_t (*diff_update)(uint8_t* bg, const uint8_t* curr, size_t n, uint8_t thresh, uint8_t alpha);
+} motion_kernels_t;
+
+// Fastest implementation this CPU supports (NEON, AVX2, SSE2 or scalar).
+// Chosen on first call; a candidate that disagrees with the scalar reference
+// on the built-in self-test is skipped.
+const motion_kernels_t* motion_kernels_get(void);
+
+// The portable reference implementation
+const motion_kernels_t* motion_kernels_scalar(void);
+
+// Every implementation compiled in and supported by this CPU (scalar first).
+// Fills up to `max` entries and returns how many were written.
+int motion_kernels_list(const motion_kernels_t** out, int max);
+
+// Compare `k` against the scalar reference on pseudo-random data, including
+// unaligned lengths. Returns 0 if the results are identical, -1 otherwise.
+int motion_kernels_verify(const motion_kernels_t* k);
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef REACTOR_H
+#define REACTOR_H
+
+#include <stdint.h>
+
+// Single-threaded epoll event loop for the control logic. Handlers run on the
+// thread that calls reactor_run(); between events the process sleeps in
+// epoll_wait() instead of polling.
+
+// Called when `fd` is ready. `events` is the epoll event mask. For timers the
+// reactor has already consumed the timerfd; `events` is then the number of
+// expirations since the last call.
+typedef void (*reactor_handler_t)(int fd, uint32_t events, void* ctx);
+
+typedef struct {
+    unsigned long wakeups;     // epoll_wait() returns
+    unsigned long dispatches;  // Handler calls
+    unsigned long timer_overruns; // Timer expirations beyond the first per dispatch
+    double cpu_ms;             // User + system CPU time of the process
+    double uptime_ms;          // Time since reactor_init()
+} reactor_stats_t;
+
+int reactor_init(void);
+
+// Watch `fd` for `events` (EPOLLIN, ...). Returns 0 on success, -1 on failure.
+int reactor_add(int fd, uint32_t events, reactor_handler_t handler, void* ctx);
+
+// Stop watching `fd` (does not close it)
+void reactor_remove(int fd);
+
+// Create a timerfd-backed timer. It stays disarmed until reactor_timer_set().
+// Returns the timer fd, or -1 on failure. Closed by reactor_cleanup().
+int reactor_add_timer(reactor_handler_t handler, void* ctx);
+
+// Arm a timer: first expiry after `initial_ms`, then every `period_ms`
+// (0 for one-shot). initial_ms == 0 disarms it.
+int reactor_timer_set(int timer_fd, int initial_ms, int period_ms);
+
+// Dispatch events until reactor_stop(). Returns 0, or -1 if epoll fails.
+int reactor_run(void);
+
+// Make reactor_run() return after the current dispatch. Safe from handlers.
+void reactor_stop(void);
+
+void reactor_get_stats(reactor_stats_t* stats);
+
+// Print wakeups/s and CPU use since the previous call
+void reactor_print_stats(void);
+
+void reactor_cleanup(void);
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef TAMPER_DETECTOR_H
+#define TAMPER_DETECTOR_H
+
+#include <stdbool.h>
+
+// Streaming tamper detection on the accelerometer. Each sample goes through
+// an integer high-pass filter (removing gravity and slow tilt), its vibration
+// energy is summed over a sliding window, and the windowed RMS must stay above
+// `enter_rms` for `min_duration_ms` to raise an alarm. The alarm ends once the
+// RMS falls below `exit_rms`. Per-sample cost is O(1) with no allocation.
+
+typedef struct {
+    int sample_rate_hz;
+    int hpf_ms;            // High-pass time constant (gravity tracking)
+    int window_ms;         // RMS window
+    int enter_rms;         // ADC counts; start of an alarm
+    int exit_rms;          // ADC counts; end of an alarm (below enter_rms)
+    int min_duration_ms;   // RMS must stay above enter_rms this long
+} tamper_config_t;
+
+typedef enum {
+    TAMPER_NONE = 0,
+    TAMPER_START,          // Sustained vibration: raise the alarm
+    TAMPER_END             // Vibration has died down
+} tamper_event_t;
+
+typedef struct {
+    unsigned long samples;
+    unsigned long alarms;
+    bool active;
+    int rms;               // Current windowed RMS, ADC counts
+    int peak_rms;          // Highest RMS since the last tamper_detector_print_stats()
+} tamper_stats_t;
+
+// Returns 0, or -1 if the configuration is invalid
+int tamper_detector_init(const tamper_config_t* config);
+
+// Feed one accelerometer sample (raw ADC counts)
+tamper_event_t tamper_detector_push(int x, int y, int z);
+
+void tamper_detector_get_stats(tamper_stats_t* stats);
+
+void tamper_detector_print_stats(void);
+
+#endif
@@ -0,0 +1,60 @@
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Hierarchical timer wheel for deferred actions on the reactor thread (LED
+// sequences, cooldowns, relock delays). Scheduling and cancelling are O(1);
+// every pending timer shares one timerfd, armed for the earliest expiry only,
+// so an idle wheel causes no wakeups. Not thread-safe: call it from reactor
+// handlers or before reactor_run().
+
+typedef void (*timer_wheel_fn)(void* ctx);
+
+// Embedded by the owner; the wheel links it in place and never allocates.
+// Set up with timer_wheel_timer_init() before first use.
+typedef struct wheel_timer {
+    struct wheel_timer* next;
+    struct wheel_timer** pprev; // NULL while not scheduled
+    uint64_t expires;           // Tick at which it fires
+    int8_t level;               // Wheel level holding it, -1 while being expired
+    uint8_t slot;
+    timer_wheel_fn fn;
+    void* ctx;
+} wheel_timer_t;
+
+typedef struct {
+    unsigned long scheduled;
+    unsigned long cancelled;   // Pending timers cancelled or rescheduled
+    unsigned long fired;
+    unsigned long cascaded;    // Timers moved down a level
+    unsigned long wakeups;     // timerfd expirations handled
+    unsigned long pending;
+    long max_late_ms;          // Worst delay between expiry and callback
+} timer_wheel_stats_t;
+
+// Register the wheel with the reactor. `tick_ms` is the timer resolution;
+// delays are rounded up to it. Returns 0 on success, -1 on failure.
+int timer_wheel_init(int tick_ms);
+
+// `fn` may be NULL for a timer that only marks a period (see timer_wheel_pending())
+void timer_wheel_timer_init(wheel_timer_t* t, timer_wheel_fn fn, void* ctx);
+
+// Fire `t` once after `delay_ms`. A pending timer is moved to the new expiry.
+// Callbacks may schedule or cancel any timer, including their own.
+void timer_wheel_schedule(wheel_timer_t* t, int delay_ms);
+
+// Stop `t` if it is pending; otherwise does nothing
+void timer_wheel_cancel(wheel_timer_t* t);
+
+bool timer_wheel_pending(const wheel_timer_t* t);
+
+void timer_wheel_get_stats(timer_wheel_stats_t* stats);
+
+void timer_wheel_print_stats(void);
+
+// Drop all pending timers without running them
+void timer_wheel_cleanup(void);
+
+#endif
@@ -0,0 +1,37 @@
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+
+#include <stdbool.h>
+#include <stdatomic.h>
+
+// Lock-free single-producer/single-consumer "latest value" handoff between
+// three slots. The caller owns the slot storage; this only hands out indices
+// (0, 1 or 2). The writer always has a slot to fill and never waits; the
+// reader always gets the newest published slot. Anything published but not
+// yet picked up is overwritten by the next publish.
+typedef struct {
+    atomic_uint middle;  // Shared slot index, plus a "fresh" flag bit
+    unsigned int back;   // Writer-owned slot
+    unsigned int front;  // Reader-owned slot
+} triple_buffer_t;
+
+void triple_buffer_init(triple_buffer_t* tb);
+
+// Writer: slot to fill next
+unsigned int triple_buffer_write_index(const triple_buffer_t* tb);
+
+// Writer: publish the filled slot and take a new one. Returns true if the
+// previously published slot was never read (i.e. a frame was dropped).
+bool triple_buffer_publish(triple_buffer_t* tb);
+
+// Reader: take the newest published slot if there is one. Returns false if
+// nothing new was published since the last call (front slot is unchanged).
+bool triple_buffer_acquire(triple_buffer_t* tb);
+
+// Either side: true if a published slot is waiting for the reader
+bool triple_buffer_pending(const triple_buffer_t* tb);
+
+// Reader: slot currently held by the reader
+unsigned int triple_buffer_read_index(const triple_buffer_t* tb);
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef VIBRATION_CLASSIFIER_H
+#define VIBRATION_CLASSIFIER_H
+
+#include <stdbool.h>
+
+// Tells a visitor knocking on the door from someone handling or prying at the
+// unit. Every VIB_HOP samples the last VIB_WINDOW accelerometer samples are
+// analysed: the share of their energy in the loudest VIB_BLOCK samples says
+// whether the vibration is one impulse or sustained, and a Q15 FFT of each
+// axis gives the share above `knock_hz`. An impulse with most of its energy
+// in that band is a knock; sustained vibration for `tamper_ms` is tampering.
+#define VIB_WINDOW_LOG2 7
+#define VIB_WINDOW (1 << VIB_WINDOW_LOG2)
+#define VIB_HOP (VIB_WINDOW / 4)
+#define VIB_BLOCK (VIB_WINDOW / 8)
+
+typedef struct {
+    int sample_rate_hz;
+    int min_rms;           // ADC counts; quieter windows are ignored
+    int knock_hz;          // Lower edge of the knock band (below Nyquist)
+    int knock_band_pct;    // A knock has at least this share of its energy in the band
+    int impulse_pct;       // An impulse has at least this share in one block
+    int tamper_ms;         // Sustained vibration this long raises tamper
+} vibration_config_t;
+
+typedef enum {
+    VIB_NONE = 0,
+    VIB_KNOCK,             // One per impulse
+    VIB_TAMPER             // Once per stretch of sustained vibration
+} vibration_event_t;
+
+typedef struct {
+    unsigned long windows;
+    unsigned long knocks;
+    unsigned long tampers;
+    // Last window above min_rms
+    int rms;               // ADC counts
+    int knock_band_pct;
+    int impulse_pct;
+} vibration_stats_t;
+
+// Returns 0, or -1 if the configuration is invalid
+int vibration_classifier_init(const vibration_config_t* config);
+
+// Feed one accelerometer sample (raw ADC counts)
+vibration_event_t vibration_classifier_push(int x, int y, int z);
+
+void vibration_classifier_get_stats(vibration_stats_t* stats);
+
+void vibration_classifier_print_stats(void);
+
+#endif
@@ -0,0 +1,1707 @@
+/**
+ * @file bench.c
+ * @brief On-target benchmarks for the doorbell pipeline.
+ * * Invoked as `smart_doorbell --bench <name> [args...]` so measurements are
+ * taken with the exact binary and compiler flags that run on the BeagleY-AI.
+ */
+
+#define _GNU_SOURCE
+#include "bench.h"
+#include "jpeg_decoder.h"
+#include "block_motion.h"
+#include "motion_kernels.h"
+#include "fft_q15.h"
+#include "vibration_classifier.h"
+#include "tamper_detector.h"
+#include "credential_store.h"
+#include "tag_dedupe.h"
+#include "hal/spi_adc.h"
+#include "hal/led.h"
+#include "hal/uart.h"
+#include "hal/rfid_frame.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/stat.h>
+#include <ftw.h>
+#include <poll.h>
+#include <math.h>
+
+#define DECODE_ITERATIONS 50
+#define KERNEL_DEFAULT_PIXELS (800 * 600)
+#define KERNEL_MIN_MS 200.0 // Run each kernel at least this long
+#define MAX_KERNELS 8
+#define ENGINE_ROUNDS 20    // Passes over the recorded frame sequence per engine
+#define MAX_FRAMES 64
+#define SPI_MIN_MS 1000.0   // Run each SPI mode at least this long
+#define SPI_DEFAULT_DEVICE "/dev/spidev0.0"
+#define IIO_BLOCK_FRAMES 256 // Frames requested per read() in block mode
+#define IIO_BUFFER_FRAMES 1024
+#define FFT_MIN_MS 200.0    // Run each FFT size at least this long
+#define VIB_RATE_HZ 1000
+#define VIB_CYCLE_S 10      // Length of the synthetic vibration script
+#define VIB_DEFAULT_S 60    // Seconds of samples fed to the classifier
+#define TAMPER_CASE_S 4     // Length of each synthetic tamper script
+#define TAMPER_TIMED_S 600  // Seconds of samples timed per rate
+#define LED_MIN_MS 500.0    // Run each LED write method at least this long
+#define UART_LINES 2000     // Lines the pty writer sends
+#define UART_ABANDONED 3    // ...of which are cut off, each followed by a pause
+#define UART_IDLE_MS 500    // Reader gives up after this long without data
+#define UART_LATENCY_TAGS 200 // Tags sent to each read mode
+#define UART_POLL_MS 10     // Period of the polled read mode
+#define RFID_FUZZ_FRAMES 100000
+#define RFID_CORRUPT_PCT 5  // Frames damaged in the fuzz stream
+#define RFID_NOISE_PCT 5    // Gaps between frames that get noise bytes
+#define RFID_MIN_MS 500.0   // Decode each throughput stream at least this long
+#define RFID_READ_CHUNK 256 // Bytes per simulated read() in the throughput test
+#define CRED_DEFAULT_ENTRIES 100000
+#define CRED_LOOKUPS 1000000 // Timed back to back, half of them unknown keys
+#define CRED_TIMED 100000   // Timed one by one for the latency percentiles
+
+// Same tuning as camera.c
+#define PIXEL_THRESH 60
+#define BG_ALPHA_Q8 51
+#define DC_THRESH (8 * 30)
+#define AC_THRESH 400
+#define MOTION_THRESH 0.15
+
+// Same tuning as smart_doorbell.c
+#define VIB_MIN_RMS 50
+#define VIB_KNOCK_HZ 60
+#define VIB_KNOCK_BAND_PCT 50
+#define VIB_IMPULSE_PCT 50
+#define VIB_TAMPER_MS 400
+#define TAMPER_HPF_MS 250
+#define TAMPER_WINDOW_MS 100
+#define TAMPER_ENTER_RMS 150
+#define TAMPER_EXIT_RMS 80
+#define TAMPER_MIN_MS 150
+#define TAMPER_APP_RATE_HZ 50 // 1000 / SAMPLE_PERIOD_MS: the direct-read path
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+// Read a whole file into a malloc'd buffer (caller frees)
+static unsigned char* read_file(const char* path, size_t* len) {
+    FILE* f = fopen(path, "rb");
+    if (!f) {
+        perror(path);
+        return NULL;
+    }
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    unsigned char* buf = size > 0 ? malloc(size) : NULL;
+    if (buf && fread(buf, 1, size, f) != (size_t)size) {
+        free(buf);
+        buf = NULL;
+    }
+    fclose(f);
+    *len = buf ? (size_t)size : 0;
+    return buf;
+}
+
+/**
+ * @brief Decode time per frame at each DCT scale (1/1, 1/2, 1/4, 1/8),
+ * for both RGB and luma-only output.
+ * * Usage: --bench decode <frame.jpg>...
+ */
+static int bench_decode(int argc, char* argv[]) {
+    if (argc < 1) {
+        fprintf(stderr, "usage: --bench decode <frame.jpg>...\n");
+        return 1;
+    }
+
+    for (int f = 0; f < argc; f++) {
+        size_t len;
+        unsigned char* jpg = read_file(argv[f], &len);
+        if (!jpg) return 1;
+        printf("%s (%zu bytes)\n", argv[f], len);
+
+        for (int denom = 1; denom <= 8; denom *= 2) {
+            for (int gray = 0; gray <= 1; gray++) {
+                jpeg_decode_format_t format = gray ? JPEG_DECODE_GRAY : JPEG_DECODE_RGB;
+                int w = 0, h = 0;
+                double start = now_ms();
+                for (int i = 0; i < DECODE_ITERATIONS; i++) {
+                    unsigned char* pixels = jpeg_decode_mem(jpg, len, format, denom, &w, &h);
+                    if (!pixels) {
+                        fprintf(stderr, "  decode failed\n");
+                        free(jpg);
+                        return 1;
+                    }
+                    free(pixels);
+                }
+                double ms = (now_ms() - start) / DECODE_ITERATIONS;
+                printf("  scale 1/%d %-4s: %4dx%-4d %7.2f ms/frame\n",
+                       denom, gray ? "gray" : "rgb", w, h, ms);
+            }
+        }
+        free(jpg);
+    }
+    jpeg_decoder_release();
+    return 0;
+}
+
+typedef enum { KERNEL_DIFF_COUNT, KERNEL_BG_UPDATE, KERNEL_DIFF_UPDATE } kernel_op_t;
+
+// Run one kernel repeatedly over an n-pixel frame; returns pixels per nanosecond
+static double time_kernel(const motion_kernels_t* k, kernel_op_t op,
+                          uint8_t* bg, const uint8_t* curr, size_t n) {
+    volatile size_t sink = 0; // Keeps the counting kernels from being optimized away
+    long reps = 0;
+    double start = now_ms(), elapsed;
+    do {
+        for (int i = 0; i < 10; i++) {
+            switch (op) {
+                case KERNEL_DIFF_COUNT:  sink += k->diff_count(bg, curr, n, 60); break;
+                case KERNEL_BG_UPDATE:   k->bg_update(bg, curr, n, 51); break;
+                case KERNEL_DIFF_UPDATE: sink += k->diff_update(bg, curr, n, 60, 51); break;
+            }
+        }
+        reps += 10;
+        elapsed = now_ms() - start;
+    } while (elapsed < KERNEL_MIN_MS);
+    (void)sink;
+    return (double)n * reps / (elapsed * 1e6);
+}
+
+/**
+ * @brief Throughput of every motion kernel implementation, after checking each
+ * against the scalar reference.
+ * * Usage: --bench kernels [pixels]
+ */
+static int bench_kernels(int argc, char* argv[]) {
+    size_t n = argc >= 1 ? strtoul(argv[0], NULL, 10) : KERNEL_DEFAULT_PIXELS;
+    if (n == 0) n = KERNEL_DEFAULT_PIXELS;
+
+    uint8_t* bg = malloc(n);
+    uint8_t* curr = malloc(n);
+    if (!bg || !curr) {
+        free(bg);
+        free(curr);
+        return 1;
+    }
+    uint32_t seed = 12345;
+    for (size_t i = 0; i < n; i++) {
+        seed = seed * 1664525u + 1013904223u;
+        bg[i] = (uint8_t)(seed >> 24);
+        curr[i] = (uint8_t)(seed >> 16);
+    }
+
+    const motion_kernels_t* kernels[MAX_KERNELS];
+    int count = motion_kernels_list(kernels, MAX_KERNELS);
+    int failures = 0;
+    printf("%zu pixels, selected: %s\n", n, motion_kernels_get()->name);
+    printf("%-8s %-6s %12s %12s %12s  (pixels/ns)\n", "impl", "check", "diff_count", "bg_update", "diff_update");
+    for (int i = 0; i < count; i++) {
+        bool ok = motion_kernels_verify(kernels[i]) == 0;
+        if (!ok) failures++;
+        printf("%-8s %-6s %12.3f %12.3f %12.3f\n", kernels[i]->name, ok ? "ok" : "FAIL",
+               time_kernel(kernels[i], KERNEL_DIFF_COUNT, bg, curr, n),
+               time_kernel(kernels[i], KERNEL_BG_UPDATE, bg, curr, n),
+               time_kernel(kernels[i], KERNEL_DIFF_UPDATE, bg, curr, n));
+    }
+
+    free(bg);
+    free(curr);
+    return failures ? 1 : 0;
+}
+
+typedef struct {
+    const char* name;
+    int scale_denom; // Pixel engines: decode scale; 0 for block engines
+    int coefs;       // Block engines: coefficients per block
+} engine_config_t;
+
+static const engine_config_t engines[] = {
+    { "pixel 1/4", 4, 0 },
+    { "pixel 1/8", 8, 0 },
+    { "dc",        0, 1 },
+    { "dc+ac",     0, 3 },
+};
+
+// Decode one frame for `e`; returns the malloc'd plane and its element count
+static void* engine_decode(const engine_config_t* e, const unsigned char* jpg, size_t len, size_t* n) {
+    int w = 0, h = 0;
+    void* plane = e->scale_denom
+        ? (void*)jpeg_decode_mem(jpg, len, JPEG_DECODE_GRAY, e->scale_denom, &w, &h)
+        : (void*)jpeg_decode_luma_coefs(jpg, len, e->coefs, &w, &h);
+    *n = (size_t)w * h;
+    return plane;
+}
+
+/**
+ * @brief Decode + analysis cost per frame of each motion engine (pixel domain
+ * at 1/4 and 1/8, DC and DC+AC block domain), run over a recorded frame
+ * sequence in order, with the motion verdicts each engine reached.
+ * * Usage: --bench engines <frame.jpg>...
+ */
+static int bench_engines(int argc, char* argv[]) {
+    if (argc < 2 || argc > MAX_FRAMES) {
+        fprintf(stderr, "usage: --bench engines <frame.jpg>... (2 to %d frames)\n", MAX_FRAMES);
+        return 1;
+    }
+
+    unsigned char* jpgs[MAX_FRAMES];
+    size_t lens[MAX_FRAMES];
+    int ret = 0;
+    int loaded = 0;
+    for (; loaded < argc; loaded++) {
+        jpgs[loaded] = read_file(argv[loaded], &lens[loaded]);
+        if (!jpgs[loaded]) {
+            ret = 1;
+            goto out;
+        }
+    }
+
+    const motion_kernels_t* k = motion_kernels_get();
+    printf("%d frames x %d rounds, pixel kernels: %s\n", argc, ENGINE_ROUNDS, k->name);
+    printf("%-10s %9s %10s %10s %10s %11s  %s\n", "engine", "cells", "decode ms", "analyze ms", "total ms",
+           "warm allocs", "motion");
+    for (size_t e = 0; e < sizeof(engines) / sizeof(engines[0]); e++) {
+        const engine_config_t* cfg = &engines[e];
+        size_t n = 0;
+        void* bg = engine_decode(cfg, jpgs[0], lens[0], &n);
+        if (!bg) {
+            fprintf(stderr, "  %s: decode failed\n", cfg->name);
+            ret = 1;
+            goto out;
+        }
+
+        double decode_ms = 0, analyze_ms = 0;
+        int frames = 0, motion = 0;
+        unsigned long warm_base = 0;
+        for (int r = 0; r < ENGINE_ROUNDS; r++) {
+            // Decoding is warm after one pass: libjpeg should not allocate again
+            if (r == 1) warm_base = jpeg_decoder_heap_allocs();
+            for (int f = 1; f < argc; f++) {
+                size_t cn;
+                double t0 = now_ms();
+                void* curr = engine_decode(cfg, jpgs[f], lens[f], &cn);
+                double t1 = now_ms();
+                if (!curr || cn != n) {
+                    fprintf(stderr, "  %s: %s does not match the first frame\n", cfg->name, argv[f]);
+                    free(curr);
+                    free(bg);
+                    ret = 1;
+                    goto out;
+                }
+                size_t changed = cfg->scale_denom
+                    ? k->diff_update(bg, curr, n, PIXEL_THRESH, BG_ALPHA_Q8)
+                    : block_motion_diff_update(bg, curr, n, cfg->coefs, DC_THRESH, AC_THRESH, BG_ALPHA_Q8);
+                double t2 = now_ms();
+                free(curr);
+
+                decode_ms += t1 - t0;
+                analyze_ms += t2 - t1;
+                frames++;
+                // Verdicts are only reported for the first pass, before the
+                // background has adapted to the looping sequence
+                if (r == 0 && (double)changed / n > MOTION_THRESH) motion++;
+            }
+        }
+        free(bg);
+        unsigned long warm_allocs = jpeg_decoder_heap_allocs() - warm_base;
+        printf("%-10s %9zu %10.3f %10.4f %10.3f %11lu  %d/%d\n", cfg->name, n, decode_ms / frames,
+               analyze_ms / frames, (decode_ms + analyze_ms) / frames, warm_allocs, motion, argc - 1);
+        if (warm_allocs != 0) ret = 1;
+    }
+
+out:
+    for (int i = 0; i < loaded; i++) free(jpgs[i]);
+    jpeg_decoder_release();
+    return ret;
+}
+
+// Channels one main-loop pass reads: accelerometer Z/Y/X, joystick X/Y
+static const int spi_channels[] = { 0, 1, 2, 6, 7 };
+#define SPI_CHANNELS ((int)(sizeof(spi_channels) / sizeof(spi_channels[0])))
+
+// Read every channel repeatedly for SPI_MIN_MS; returns channel samples/s, or -1
+static double time_spi(int fd, uint32_t speed_hz, bool batched) {
+    int values[SPI_CHANNELS];
+    long passes = 0;
+    double start = now_ms(), elapsed;
+    do {
+        if (batched) {
+            if (hal_spi_adc_read_channels(fd, spi_channels, SPI_CHANNELS, values) != 0) return -1;
+        } else {
+            for (int c = 0; c < SPI_CHANNELS; c++) {
+                if ((values[c] = hal_spi_adc_read_ch(fd, spi_channels[c], speed_hz)) < 0) return -1;
+            }
+        }
+        passes++;
+        elapsed = now_ms() - start;
+    } while (elapsed < SPI_MIN_MS);
+    return passes * SPI_CHANNELS * 1000.0 / elapsed;
+}
+
+/**
+ * @brief ADC samples per second with one ioctl per channel versus one
+ * batched ioctl for all the channels the main loop reads, at the joystick
+ * (250 kHz) and accelerometer (1 MHz) bus speeds.
+ * * Usage: --bench spi [device]
+ */
+static int bench_spi(int argc, char* argv[]) {
+    const char* device = argc >= 1 ? argv[0] : SPI_DEFAULT_DEVICE;
+    static const uint32_t speeds[] = { 250000, 1000000 };
+
+    printf("%s, %d channels per pass\n", device, SPI_CHANNELS);
+    printf("%-9s %14s %14s %8s\n", "speed", "single (sa/s)", "batched (sa/s)", "speedup");
+    for (size_t i = 0; i < sizeof(speeds) / sizeof(speeds[0]); i++) {
+        int fd = hal_spi_adc_open(device, speeds[i]);
+        if (fd < 0) return 1;
+        double single = time_spi(fd, speeds[i], false);
+        double batched = time_spi(fd, speeds[i], true);
+        hal_spi_adc_close(fd);
+        if (single < 0 || batched < 0) return 1;
+        printf("%5u kHz %14.0f %14.0f %7.2fx\n", speeds[i] / 1000, single, batched, batched / single);
+    }
+    return 0;
+}
+
+static double thread_cpu_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+typedef struct {
+    double frames_per_s;
+    double cpu_us_per_frame;  // Reader thread only
+    double frames_per_call;
+    long bad;                 // Frames that did not decode to the simulated values
+} adc_result_t;
+
+// Fake sysfs trees for the IIO and LED benches: plain files under a fresh
+// directory in /tmp, which keep whatever is written last so a driver's writes
+// can be read back. `rel` paths are relative to the tree's root.
+static int sysfs_sim_create(char* dir, size_t len, const char* name) {
+    snprintf(dir, len, "/tmp/%s-sim-XXXXXX", name);
+    if (mkdtemp(dir)) return 0;
+    dir[0] = '\0';
+    return -1;
+}
+
+static int sysfs_sim_path(const char* dir, const char* rel, char* path, size_t len) {
+    int n = snprintf(path, len, "%s/%s", dir, rel);
+    return n < 0 || (size_t)n >= len ? -1 : 0;
+}
+
+// Creates the file, and any directories above it, if it does not exist
+static int sysfs_sim_write(const char* dir, const char* rel, const char* value) {
+    char path[160];
+    if (sysfs_sim_path(dir, rel, path, sizeof(path)) != 0) return -1;
+    for (char* slash = strchr(path + strlen(dir) + 1, '/'); slash; slash = strchr(slash + 1, '/')) {
+        *slash = '\0';
+        mkdir(path, 0755);
+        *slash = '/';
+    }
+    FILE* f = fopen(path, "w");
+    if (!f) return -1;
+    fputs(value, f);
+    return fclose(f);
+}
+
+// First line of the file, without the newline
+static int sysfs_sim_read(const char* dir, const char* rel, char* buf, size_t len) {
+    char path[160];
+    if (sysfs_sim_path(dir, rel, path, sizeof(path)) != 0) return -1;
+    FILE* f = fopen(path, "r");
+    if (!f) return -1;
+    bool ok = fgets(buf, (int)len, f) != NULL;
+    fclose(f);
+    if (!ok) buf[0] = '\0';
+    buf[strcspn(buf, "\n")] = '\0';
+    return 0;
+}
+
+static int sysfs_sim_unlink(const char* path, const struct stat* st, int type, struct FTW* ftw) {
+    (void)st; (void)type; (void)ftw;
+    return remove(path);
+}
+
+static void sysfs_sim_remove(const char* dir) {
+    if (dir[0]) nftw(dir, sysfs_sim_unlink, 8, FTW_DEPTH | FTW_PHYS);
+}
+
+// Simulated mcp320x IIO device: a sysfs-like tree plus a FIFO as the device
+// node, fed with big-endian u12/16 scans and an s64 timestamp by a thread
+typedef struct {
+    char dir[64];
+    char node[96];
+    pthread_t thread;
+    atomic_bool stop;
+} iio_sim_t;
+
+static const char* iio_sim_files[] = {
+    "buffer/enable", "buffer/length", "buffer/watermark", "trigger/current_trigger",
+    "scan_elements/in_timestamp_en", "scan_elements/in_timestamp_index", "scan_elements/in_timestamp_type",
+};
+
+static int iio_sim_create(iio_sim_t* sim) {
+    if (sysfs_sim_create(sim->dir, sizeof(sim->dir), "iio") != 0) return -1;
+    char rel[64], value[32];
+    int err = 0;
+    for (size_t i = 0; i < sizeof(iio_sim_files) / sizeof(iio_sim_files[0]); i++) {
+        err |= sysfs_sim_write(sim->dir, iio_sim_files[i], "0\n");
+    }
+    err |= sysfs_sim_write(sim->dir, "scan_elements/in_timestamp_index", "8\n");
+    err |= sysfs_sim_write(sim->dir, "scan_elements/in_timestamp_type", "le:s64/64>>0\n");
+    for (int ch = 0; ch < 8; ch++) {
+        snprintf(rel, sizeof(rel), "scan_elements/in_voltage%d_en", ch);
+        err |= sysfs_sim_write(sim->dir, rel, "0\n");
+        snprintf(rel, sizeof(rel), "scan_elements/in_voltage%d_index", ch);
+        snprintf(value, sizeof(value), "%d\n", ch);
+        err |= sysfs_sim_write(sim->dir, rel, value);
+        snprintf(rel, sizeof(rel), "scan_elements/in_voltage%d_type", ch);
+        err |= sysfs_sim_write(sim->dir, rel, "be:u12/16>>0\n");
+    }
+    snprintf(sim->node, sizeof(sim->node), "%s/iio:device0", sim->dir);
+    if (mkfifo(sim->node, 0600) != 0) err = -1;
+    return err ? -1 : 0;
+}
+
+static int iio_sim_value(int ch, unsigned seq) {
+    return (ch * 500 + (int)(seq % 97)) & 0xFFF;
+}
+
+// Plays the kernel: queues whole scans of the enabled channels (0, 1, 2, 6, 7,
+// 16 bits each, index order) padded to 16 bytes, then the timestamp
+static void* iio_sim_producer(void* arg) {
+    iio_sim_t* sim = arg;
+    enum { FRAME = 24, BLOCK = 128 };
+    unsigned char block[FRAME * BLOCK];
+    int fd = open(sim->node, O_WRONLY | O_CLOEXEC);
+    if (fd < 0) return NULL;
+    unsigned seq = 0;
+    while (!atomic_load(&sim->stop)) {
+        memset(block, 0, sizeof(block));
+        for (int f = 0; f < BLOCK; f++, seq++) {
+            unsigned char* p = block + f * FRAME;
+            for (int i = 0; i < SPI_CHANNELS; i++) {
+                int v = iio_sim_value(spi_channels[i], seq);
+                p[2 * i] = (unsigned char)(v >> 8);
+                p[2 * i + 1] = (unsigned char)v;
+            }
+            int64_t ts = (int64_t)seq * 1000000;
+            for (int b = 0; b < 8; b++) p[16 + b] = (unsigned char)(ts >> (8 * b));
+        }
+        if (write(fd, block, sizeof(block)) != (ssize_t)sizeof(block)) break;
+    }
+    close(fd);
+    return NULL;
+}
+
+// Read IIO frames for SPI_MIN_MS, `per_call` frames per read()
+static adc_result_t time_iio(int fd, int per_call, bool check) {
+    static int values[IIO_BLOCK_FRAMES * SPI_CHANNELS];
+    static int64_t stamps[IIO_BLOCK_FRAMES];
+    adc_result_t r = { 0 };
+    long frames = 0, calls = 0;
+    double start = now_ms(), cpu = thread_cpu_ms(), elapsed;
+    do {
+        int n = hal_spi_adc_iio_read(fd, values, stamps, per_call);
+        if (n < 0) break;
+        for (int f = 0; check && f < n; f++) {
+            unsigned seq = (unsigned)(stamps[f] / 1000000);
+            for (int i = 0; i < SPI_CHANNELS; i++) {
+                if (values[f * SPI_CHANNELS + i] != iio_sim_value(spi_channels[i], seq)) {
+                    r.bad++;
+                    break;
+                }
+            }
+        }
+        frames += n;
+        calls++;
+        elapsed = now_ms() - start;
+    } while (elapsed < SPI_MIN_MS);
+    if (frames > 0) {
+        r.frames_per_s = frames * 1000.0 / elapsed;
+        r.cpu_us_per_frame = (thread_cpu_ms() - cpu) * 1000.0 / frames;
+        r.frames_per_call = (double)frames / calls;
+    }
+    return r;
+}
+
+// Batched spidev reads of the same channels for SPI_MIN_MS
+static adc_result_t time_spidev(int fd) {
+    adc_result_t r = { 0 };
+    int values[SPI_CHANNELS];
+    long frames = 0;
+    double start = now_ms(), cpu = thread_cpu_ms(), elapsed;
+    do {
+        if (hal_spi_adc_read_channels(fd, spi_channels, SPI_CHANNELS, values) != 0) return r;
+        frames++;
+        elapsed = now_ms() - start;
+    } while (elapsed < SPI_MIN_MS);
+    r.frames_per_s = frames * 1000.0 / elapsed;
+    r.cpu_us_per_frame = (thread_cpu_ms() - cpu) * 1000.0 / frames;
+    r.frames_per_call = 1;
+    return r;
+}
+
+static void print_adc_result(const char* name, adc_result_t r) {
+    printf("%-22s %12.0f %12.3f %14.1f\n", name, r.frames_per_s, r.cpu_us_per_frame, r.frames_per_call);
+}
+
+// One simulated capture: returns the result of reading `per_call` frames per call
+static int run_iio_sim(iio_sim_t* sim, int per_call, adc_result_t* r) {
+    atomic_store(&sim->stop, false);
+    if (pthread_create(&sim->thread, NULL, iio_sim_producer, sim) != 0) return -1;
+    int fd = hal_spi_adc_iio_open(sim->dir, sim->node, "sim-trigger", spi_channels, SPI_CHANNELS,
+                                  IIO_BUFFER_FRAMES);
+    if (fd >= 0) {
+        *r = time_iio(fd, per_call, true);
+    }
+    // Let the producer see the flag, then drain until it closes its end
+    atomic_store(&sim->stop, true);
+    if (fd >= 0) {
+        unsigned char buf[4096];
+        while (read(fd, buf, sizeof(buf)) > 0) {
+        }
+        hal_spi_adc_iio_close(fd);
+    } else {
+        // Unblock the producer's open()
+        int unblock = open(sim->node, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+        if (unblock >= 0) close(unblock);
+    }
+    pthread_join(sim->thread, NULL);
+    return fd >= 0 ? 0 : -1;
+}
+
+/**
+ * @brief ADC frames per second and reader CPU per frame through the IIO
+ * buffered backend (many frames per read()) against batched spidev ioctls
+ * (one per frame), for the five channels the main loop uses.
+ * * On the target the kernel samples the ADC, so the IIO numbers only include
+ * the copy-out cost; the trigger rate caps frames/s. With --sim a FIFO-backed
+ * fake device stands in for /dev/iio:deviceN and the spidev row is replaced
+ * by single-frame reads of the same FIFO, i.e. one syscall per frame.
+ * * Usage: --bench iio <sysfs_dir> <dev_node> [trigger] [spidev]
+ *          --bench iio --sim
+ */
+static int bench_iio(int argc, char* argv[]) {
+    bool sim = argc >= 1 && strcmp(argv[0], "--sim") == 0;
+    if (!sim && argc < 2) {
+        fprintf(stderr, "usage: --bench iio <sysfs_dir> <dev_node> [trigger] [spidev] | --sim\n");
+        return 1;
+    }
+
+    printf("%d channels per frame%s\n", SPI_CHANNELS, sim ? ", simulated IIO device" : "");
+    printf("%-22s %12s %12s %14s\n", "backend", "frames/s", "cpu us/frame", "frames/syscall");
+    if (sim) {
+        iio_sim_t sim_dev;
+        if (iio_sim_create(&sim_dev) != 0) {
+            perror("Error creating simulated IIO device");
+            sysfs_sim_remove(sim_dev.dir);
+            return 1;
+        }
+        adc_result_t block = { 0 }, single = { 0 };
+        int ret = run_iio_sim(&sim_dev, IIO_BLOCK_FRAMES, &block) == 0 &&
+                  run_iio_sim(&sim_dev, 1, &single) == 0 ? 0 : 1;
+        sysfs_sim_remove(sim_dev.dir);
+        if (ret != 0) return 1;
+        print_adc_result("iio block read", block);
+        print_adc_result("one syscall per frame", single);
+        if (block.bad + single.bad > 0) {
+            fprintf(stderr, "%ld frames decoded wrongly\n", block.bad + single.bad);
+            return 1;
+        }
+        return 0;
+    }
+
+    const char* trigger = argc >= 3 ? argv[2] : NULL;
+    const char* spidev = argc >= 4 ? argv[3] : SPI_DEFAULT_DEVICE;
+    int fd = hal_spi_adc_iio_open(argv[0], argv[1], trigger, spi_channels, SPI_CHANNELS, IIO_BUFFER_FRAMES);
+    if (fd < 0) return 1;
+    print_adc_result("iio block read", time_iio(fd, IIO_BLOCK_FRAMES, false));
+    hal_spi_adc_iio_close(fd);
+
+    // The IIO driver owns the ADC while it is bound; spidev needs the other binding
+    fd = hal_spi_adc_open(spidev, 1000000);
+    if (fd < 0) {
+        printf("%-22s (unavailable)\n", "spidev batched");
+        return 0;
+    }
+    print_adc_result("spidev batched 1 MHz", time_spidev(fd));
+    hal_spi_adc_close(fd);
+    return 0;
+}
+
+// Nanoseconds per transform of 2^log2n points
+static double time_fft(const fft_q15_t* f, int log2n) {
+    int n = 1 << log2n;
+    static int16_t src[1 << FFT_Q15_MAX_LOG2], re[1 << FFT_Q15_MAX_LOG2], im[1 << FFT_Q15_MAX_LOG2];
+    uint32_t seed = 12345;
+    for (int i = 0; i < n; i++) {
+        seed = seed * 1664525u + 1013904223u;
+        src[i] = (int16_t)((int32_t)(seed >> 16) % 32769 - 16384);
+    }
+    long iterations = 0;
+    double start = now_ms(), elapsed;
+    do {
+        for (int rep = 0; rep < 64; rep++) {
+            memcpy(re, src, n * sizeof(int16_t));
+            memset(im, 0, n * sizeof(int16_t));
+            f->fft(re, im, log2n);
+        }
+        iterations += 64;
+        elapsed = now_ms() - start;
+    } while (elapsed < FFT_MIN_MS);
+    return elapsed * 1e6 / iterations;
+}
+
+// A damped ring at 180 Hz, like a knuckle on the door frame
+static double knock_at(double t) {
+    return t >= 0 && t < 0.04 ? exp(-t / 0.008) * sin(2 * M_PI * 180 * t) : 0;
+}
+
+// One VIB_CYCLE_S script at VIB_RATE_HZ: a single knock at 2 s, four knocks
+// from 4 s, 1.5 s of shaking and rattling from 6 s, and a 60 ms push at 8.5 s.
+// Expected per cycle: 5 knocks, 1 tamper.
+static void synth_vibration(int16_t* xyz, int samples) {
+    static const double knocks[] = { 2.0, 4.0, 4.25, 4.5, 4.75 };
+    uint32_t seed = 777;
+    for (int i = 0; i < samples; i++) {
+        double t = (double)i / VIB_RATE_HZ;
+        double v[3] = { 2048, 2048, 2400 }; // Gravity on z
+        for (size_t k = 0; k < sizeof(knocks) / sizeof(knocks[0]); k++) {
+            double ring = knock_at(t - knocks[k]);
+            v[0] += 400 * ring;
+            v[2] += 900 * ring;
+        }
+        bool shaking = t >= 6.0 && t < 7.5;
+        if (shaking) {
+            v[0] += 350 * sin(2 * M_PI * 5 * t);
+            v[1] += 250 * sin(2 * M_PI * 7 * t + 1);
+        }
+        if (t >= 8.5 && t < 8.56) v[2] += 600 * sin(M_PI * (t - 8.5) / 0.06);
+        for (int a = 0; a < 3; a++) {
+            seed = seed * 1664525u + 1013904223u;
+            int noise = (int)(seed >> 16) % 9 - 4;
+            if (shaking) noise = (int)(seed >> 16) % 121 - 60;
+            xyz[i * 3 + a] = (int16_t)lrint(v[a] + noise);
+        }
+    }
+}
+
+/**
+ * @brief Q15 FFT time per transform for each implementation, and the
+ * vibration classifier's CPU load on a synthetic accelerometer stream at
+ * 1 kHz (knocks, pounding, shaking and a push), with the events it reported.
+ * * Usage: --bench fft [seconds]
+ */
+static int bench_fft(int argc, char* argv[]) {
+    int seconds = argc >= 1 ? atoi(argv[0]) : VIB_DEFAULT_S;
+    if (seconds < VIB_CYCLE_S) seconds = VIB_CYCLE_S;
+
+    const fft_q15_t* impls[MAX_KERNELS];
+    int count = fft_q15_list(impls, MAX_KERNELS);
+    int failures = 0;
+    printf("selected: %s\n", fft_q15_get()->name);
+    printf("%-8s %-6s %12s %12s  (ns/transform)\n", "impl", "check", "128 points", "1024 points");
+    for (int i = 0; i < count; i++) {
+        bool ok = fft_q15_verify(impls[i]) == 0;
+        if (!ok) failures++;
+        printf("%-8s %-6s %12.0f %12.0f\n", impls[i]->name, ok ? "ok" : "FAIL",
+               time_fft(impls[i], VIB_WINDOW_LOG2), time_fft(impls[i], 10));
+    }
+
+    int cycle = VIB_CYCLE_S * VIB_RATE_HZ;
+    int16_t* xyz = malloc((size_t)cycle * 3 * sizeof(int16_t));
+    if (!xyz) return 1;
+    synth_vibration(xyz, cycle);
+
+    vibration_config_t config = {
+        .sample_rate_hz = VIB_RATE_HZ,
+        .min_rms = VIB_MIN_RMS,
+        .knock_hz = VIB_KNOCK_HZ,
+        .knock_band_pct = VIB_KNOCK_BAND_PCT,
+        .impulse_pct = VIB_IMPULSE_PCT,
+        .tamper_ms = VIB_TAMPER_MS,
+    };
+    if (vibration_classifier_init(&config) != 0) {
+        free(xyz);
+        return 1;
+    }
+    int cycles = seconds / VIB_CYCLE_S;
+    double cpu = thread_cpu_ms();
+    for (int c = 0; c < cycles; c++) {
+        for (int i = 0; i < cycle; i++) {
+            vibration_classifier_push(xyz[i * 3], xyz[i * 3 + 1], xyz[i * 3 + 2]);
+        }
+    }
+    cpu = thread_cpu_ms() - cpu;
+    free(xyz);
+
+    vibration_stats_t vs;
+    vibration_classifier_get_stats(&vs);
+    double data_s = (double)cycles * VIB_CYCLE_S;
+    printf("\nclassifier: %.0f s of %d Hz samples in %.1f ms CPU, %.1f us per window, %.3f%% of one core\n",
+           data_s, VIB_RATE_HZ, cpu, cpu * 1000.0 / vs.windows, cpu / (data_s * 10.0));
+    printf("events: %lu knocks (expected %d), %lu tamper (expected %d)\n",
+           vs.knocks, cycles * 5, vs.tampers, cycles);
+    failures += vs.knocks != (unsigned long)cycles * 5 || vs.tampers != (unsigned long)cycles;
+    return failures ? 1 : 0;
+}
+
+typedef enum { TAMPER_KNOCK, TAMPER_SHAKE, TAMPER_TILT, TAMPER_LONG_SHAKE, TAMPER_TWO_SHAKES } tamper_case_t;
+
+typedef struct {
+    const char* name;
+    tamper_case_t signal;
+    unsigned long alarms;  // Expected TAMPER_START events
+} tamper_case_info_t;
+
+static const tamper_case_info_t tamper_cases[] = {
+    { "20 ms knock", TAMPER_KNOCK, 0 },
+    { "500 ms shake", TAMPER_SHAKE, 1 },
+    { "slow tilt", TAMPER_TILT, 0 },
+    { "3 s shake", TAMPER_LONG_SHAKE, 1 },
+    { "two shakes", TAMPER_TWO_SHAKES, 2 },
+};
+
+// One accelerometer sample at time t of a TAMPER_CASE_S script: the unit at
+// rest (gravity on z) until 1 s, then the event
+static void tamper_sample(tamper_case_t c, double t, int xyz[3]) {
+    double v[3] = { 2048, 2048, 2400 };
+    double e = t - 1.0;
+    bool shaking = (c == TAMPER_SHAKE && e >= 0 && e < 0.5) ||
+                   (c == TAMPER_LONG_SHAKE && e >= 0 && e < 3.0) ||
+                   (c == TAMPER_TWO_SHAKES && ((e >= 0 && e < 0.5) || (e >= 1.5 && e < 2.0)));
+    if (shaking) {
+        v[0] += 400 * sin(2 * M_PI * 30 * t);
+        v[1] += 300 * sin(2 * M_PI * 30 * t + 1);
+    }
+    // Knock: one 20 ms, 1500-count half sine on z, peaking on a 50 Hz sample
+    if (c == TAMPER_KNOCK && e >= -0.01 && e < 0.01) v[2] += 1500 * cos(M_PI * e / 0.02);
+    // Tilt: a quarter turn over 2 s moves gravity from z to x
+    if (c == TAMPER_TILT && e >= 0) {
+        double f = e < 2.0 ? e / 2.0 : 1.0;
+        v[0] += 352 * f;
+        v[2] -= 352 * f;
+    }
+    for (int a = 0; a < 3; a++) xyz[a] = (int)lrint(v[a]);
+}
+
+static int tamper_init(int rate_hz) {
+    tamper_config_t config = {
+        .sample_rate_hz = rate_hz,
+        .hpf_ms = TAMPER_HPF_MS,
+        .window_ms = TAMPER_WINDOW_MS,
+        .enter_rms = TAMPER_ENTER_RMS,
+        .exit_rms = TAMPER_EXIT_RMS,
+        .min_duration_ms = TAMPER_MIN_MS,
+    };
+    return tamper_detector_init(&config);
+}
+
+/**
+ * @brief Tamper detector on synthetic accelerometer scripts at the rate the
+ * doorbell feeds it and at the sampler rate: a knock and slow tilt must not
+ * alarm, each shake must alarm exactly once. Also the time per sample.
+ * * Usage: --bench tamper
+ */
+static int bench_tamper(int argc, char* argv[]) {
+    (void)argc; (void)argv;
+    static const int rates[] = { TAMPER_APP_RATE_HZ, VIB_RATE_HZ };
+    int failures = 0;
+    printf("%-14s %6s %8s %8s %9s\n", "script", "rate", "alarms", "expected", "peak rms");
+    for (size_t r = 0; r < sizeof(rates) / sizeof(rates[0]); r++) {
+        for (size_t c = 0; c < sizeof(tamper_cases) / sizeof(tamper_cases[0]); c++) {
+            const tamper_case_info_t* tc = &tamper_cases[c];
+            if (tamper_init(rates[r]) != 0) return 1;
+            int samples = TAMPER_CASE_S * rates[r];
+            for (int i = 0; i < samples; i++) {
+                int xyz[3];
+                tamper_sample(tc->signal, (double)i / rates[r], xyz);
+                tamper_detector_push(xyz[0], xyz[1], xyz[2]);
+            }
+            tamper_stats_t ts;
+            tamper_detector_get_stats(&ts);
+            bool ok = ts.alarms == tc->alarms;
+            if (!ok) failures++;
+            printf("%-14s %6d %8lu %8lu %9d%s\n", tc->name, rates[r], ts.alarms, tc->alarms,
+                   ts.peak_rms, ok ? "" : "  FAIL");
+        }
+    }
+
+    // Per-sample cost at the sampler rate, on the two-shake script
+    int cycle = TAMPER_CASE_S * VIB_RATE_HZ;
+    int* xyz = malloc((size_t)cycle * 3 * sizeof(int));
+    if (!xyz || tamper_init(VIB_RATE_HZ) != 0) {
+        free(xyz);
+        return 1;
+    }
+    for (int i = 0; i < cycle; i++) tamper_sample(TAMPER_TWO_SHAKES, (double)i / VIB_RATE_HZ, &xyz[i * 3]);
+    int cycles = TAMPER_TIMED_S / TAMPER_CASE_S;
+    double cpu = thread_cpu_ms();
+    for (int c = 0; c < cycles; c++) {
+        for (int i = 0; i < cycle; i++) tamper_detector_push(xyz[i * 3], xyz[i * 3 + 1], xyz[i * 3 + 2]);
+    }
+    cpu = thread_cpu_ms() - cpu;
+    free(xyz);
+    printf("\ndetector: %.1f ns per sample\n", cpu * 1e6 / ((double)cycles * cycle));
+    return failures ? 1 : 0;
+}
+
+static const char* led_sim_names[] = { "ACT", "PWR" };
+static const char* led_sim_files[] = { "brightness", "max_brightness", "trigger",
+                                       "delay_on", "delay_off", "pattern", "repeat" };
+#define LED_SIM_FILES (sizeof(led_sim_files) / sizeof(led_sim_files[0]))
+
+static int led_sim_write(const char* dir, const char* led, const char* attr, const char* value) {
+    char rel[64];
+    snprintf(rel, sizeof(rel), "%s/%s", led, attr);
+    return sysfs_sim_write(dir, rel, value);
+}
+
+// A fake /sys/class/leds with both LEDs offering the timer and pattern triggers
+static int led_sim_create(char* dir, size_t len) {
+    if (sysfs_sim_create(dir, len, "leds") != 0) return -1;
+    int err = 0;
+    for (int i = 0; i < 2; i++) {
+        for (size_t k = 0; k < LED_SIM_FILES; k++) err |= led_sim_write(dir, led_sim_names[i], led_sim_files[k], "0\n");
+        err |= led_sim_write(dir, led_sim_names[i], "max_brightness", "1\n");
+        err |= led_sim_write(dir, led_sim_names[i], "trigger", "none [mmc0] timer heartbeat pattern\n");
+    }
+    return err ? -1 : 0;
+}
+
+// The driver's previous write path: fopen/fprintf/fclose per change
+static void led_write_by_path(const char* path, int value) {
+    FILE* f = fopen(path, "w");
+    if (!f) return;
+    fprintf(f, "%d", value);
+    fclose(f);
+}
+
+// Nanoseconds per brightness change; by path, or through the HAL's open fd
+static double time_led_writes(const char* dir, bool by_path) {
+    char path[160];
+    snprintf(path, sizeof(path), "%s/%s/brightness", dir, led_sim_names[0]);
+    long writes = 0;
+    double start = now_ms(), elapsed;
+    do {
+        for (int i = 0; i < 256; i++) {
+            if (by_path) led_write_by_path(path, i & 1);
+            else hal_led_set(HAL_LED_GREEN, i & 1);
+        }
+        writes += 256;
+        elapsed = now_ms() - start;
+    } while (elapsed < LED_MIN_MS);
+    return elapsed * 1e6 / writes;
+}
+
+static int led_check(const char* dir, const char* led, const char* attr, const char* expected) {
+    char rel[64], buf[128];
+    snprintf(rel, sizeof(rel), "%s/%s", led, attr);
+    if (sysfs_sim_read(dir, rel, buf, sizeof(buf)) != 0 || strcmp(buf, expected) != 0) {
+        fprintf(stderr, "%s/%s is \"%s\", expected \"%s\"\n", led, attr, buf, expected);
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Cost of one LED brightness change through the old fopen/fprintf/
+ * fclose path and through the HAL's persistent fd, and which blink patterns
+ * the kernel's LED triggers take over.
+ * * With --sim the LEDs live in a fake sysfs tree, and the files the HAL
+ * writes for steady levels, the timer trigger and the pattern trigger are
+ * checked. On the target the green LED flashes while it runs.
+ * * Usage: --bench led <leds_dir>
+ *          --bench led --sim
+ */
+static int bench_led(int argc, char* argv[]) {
+    bool sim = argc >= 1 && strcmp(argv[0], "--sim") == 0;
+    if (!sim && argc < 1) {
+        fprintf(stderr, "usage: --bench led <leds_dir> | --sim\n");
+        return 1;
+    }
+    char sim_dir[64] = "";
+    const char* dir = argv[0];
+    if (sim) {
+        if (led_sim_create(sim_dir, sizeof(sim_dir)) != 0) {
+            perror("Error creating simulated LED tree");
+            sysfs_sim_remove(sim_dir);
+            return 1;
+        }
+        dir = sim_dir;
+    }
+    if (hal_led_init_at(dir) != 0) {
+        if (sim) sysfs_sim_remove(sim_dir);
+        return 1;
+    }
+
+    double by_path = time_led_writes(dir, true);
+    double by_fd = time_led_writes(dir, false);
+    printf("%s%s\n", dir, sim ? " (simulated)" : "");
+    printf("%-22s %10s\n", "brightness write", "ns/change");
+    printf("%-22s %10.0f\n", "fopen/fprintf/fclose", by_path);
+    printf("%-22s %10.0f  (%.1fx)\n", "pwrite on open fd", by_fd, by_path / by_fd);
+
+    // Five flashes over 500 ms, as for a tamper alarm
+    bool pattern = hal_led_flash(HAL_LED_GREEN, 5, 50, 50) == 0;
+    printf("pattern trigger: %s\n", pattern ? "5 flashes handed to the kernel" : "unavailable");
+    int failures = 0;
+    if (sim) {
+        failures += !pattern;
+        failures += led_check(dir, "ACT", "trigger", "pattern");
+        failures += led_check(dir, "ACT", "repeat", "5");
+        failures += led_check(dir, "ACT", "pattern", "1 50 1 0 0 50 0 0");
+    } else if (pattern) {
+        usleep(600000);
+    }
+
+    bool timer = hal_led_blink(HAL_LED_GREEN, 100, 400) == 0;
+    printf("timer trigger: %s\n", timer ? "blinking handed to the kernel" : "unavailable");
+    if (sim) {
+        failures += !timer;
+        failures += led_check(dir, "ACT", "trigger", "timer");
+        failures += led_check(dir, "ACT", "delay_on", "100");
+        failures += led_check(dir, "ACT", "delay_off", "400");
+    } else if (timer) {
+        sleep(2);
+    }
+
+    // A steady level takes the LED back from the trigger
+    hal_led_set(HAL_LED_GREEN, true);
+    if (sim) {
+        failures += led_check(dir, "ACT", "trigger", "none");
+        failures += led_check(dir, "ACT", "brightness", "1");
+        failures += led_check(dir, "PWR", "brightness", "0");
+    }
+    hal_led_cleanup();
+    if (sim) sysfs_sim_remove(sim_dir);
+    return failures ? 1 : 0;
+}
+
+typedef enum { LINE_TAG, LINE_GARBAGE, LINE_OVERLONG, LINE_ABANDONED } uart_line_kind_t;
+
+typedef struct {
+    char text[64];
+    int len;
+    bool abandoned;            // Followed by a pause longer than the frame gap
+} uart_line_t;
+
+typedef struct {
+    int master;
+    uart_line_t* lines;
+    char (*tags)[HAL_UART_MAX_FRAME + 1]; // Tags the reader should see, in order
+    int num_tags;
+    int garbage_bytes, overflow_bytes, partial_bytes;
+} uart_script_t;
+
+static uint32_t uart_rand(uint32_t* seed) {
+    *seed = *seed * 1664525u + 1013904223u;
+    return *seed >> 8;
+}
+
+// Every line the writer will send, and what the reader should make of it
+static void uart_script_build(uart_script_t* sc) {
+    static const char hex[] = "0123456789ABCDEF";
+    uint32_t seed = 4242;
+    for (int i = 0; i < UART_LINES; i++) {
+        uart_line_t* l = &sc->lines[i];
+        uart_line_kind_t kind = LINE_TAG;
+        uint32_t r = uart_rand(&seed) % 10;
+        if (i % (UART_LINES / UART_ABANDONED) == UART_LINES / UART_ABANDONED / 2) kind = LINE_ABANDONED;
+        else if (r == 0) kind = LINE_GARBAGE;
+        else if (r == 1) kind = LINE_OVERLONG;
+
+        int len;
+        if (kind == LINE_GARBAGE) {
+            len = snprintf(l->text, sizeof(l->text), "ERR:%u?", uart_rand(&seed) % 1000);
+            sc->garbage_bytes += len;
+        } else {
+            int digits = kind == LINE_OVERLONG ? HAL_UART_MAX_FRAME + 8 : 4 + 2 * (int)(uart_rand(&seed) % 6);
+            for (len = 0; len < digits; len++) l->text[len] = hex[uart_rand(&seed) % 16];
+            l->text[len] = '\0';
+            if (kind == LINE_TAG) strcpy(sc->tags[sc->num_tags++], l->text);
+            if (kind == LINE_OVERLONG) sc->overflow_bytes += len;
+        }
+        if (kind == LINE_ABANDONED) {
+            // The sender stops mid-tag (e.g. unplugged); the next line must not inherit it
+            len /= 2;
+            sc->partial_bytes += len;
+            l->abandoned = true;
+        } else {
+            // Flipper ends lines with CRLF, other senders with a bare LF
+            len += snprintf(l->text + len, sizeof(l->text) - len, i % 3 ? "\r\n" : "\n");
+        }
+        l->len = len;
+    }
+}
+
+// Send each line to the pty master in random pieces, sometimes pausing
+// (well inside the assembler's gap) between them
+static void* uart_script_writer(void* arg) {
+    uart_script_t* sc = arg;
+    uint32_t seed = 777;
+    for (int i = 0; i < UART_LINES; i++) {
+        const char* data = sc->lines[i].text;
+        int len = sc->lines[i].len;
+        while (len > 0) {
+            int piece = 1 + (int)(uart_rand(&seed) % (uint32_t)len);
+            ssize_t n = write(sc->master, data, piece);
+            if (n <= 0) return NULL;
+            data += n;
+            len -= (int)n;
+            if (uart_rand(&seed) % 4 == 0) usleep(1000 + uart_rand(&seed) % 3000);
+        }
+        if (sc->lines[i].abandoned) usleep(250000);
+    }
+    return NULL;
+}
+
+static int open_pty(void) {
+    int master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0) {
+        perror("Error creating pty");
+        if (master >= 0) close(master);
+        return -1;
+    }
+    return master;
+}
+
+// Frame assembly: exactly the tags, in order, with every dropped byte
+// counted in the right bucket
+static int uart_frame_test(void) {
+    uart_script_t sc = { .master = open_pty() };
+    if (sc.master < 0) return 1;
+    sc.lines = calloc(UART_LINES, sizeof(*sc.lines));
+    sc.tags = calloc(UART_LINES, sizeof(*sc.tags));
+    if (!sc.lines || !sc.tags || hal_uart_init(ptsname(sc.master), 9600) != 0) {
+        free(sc.lines);
+        free(sc.tags);
+        close(sc.master);
+        return 1;
+    }
+    uart_script_build(&sc);
+
+    pthread_t writer;
+    if (pthread_create(&writer, NULL, uart_script_writer, &sc) != 0) {
+        hal_uart_cleanup();
+        free(sc.lines);
+        free(sc.tags);
+        close(sc.master);
+        return 1;
+    }
+    int got = 0, wrong = 0, wakeups = 0;
+    char frame[HAL_UART_MAX_FRAME + 1];
+    double start = now_ms();
+    struct pollfd pfd = { .fd = hal_uart_get_fd(), .events = POLLIN };
+    while (poll(&pfd, 1, UART_IDLE_MS) > 0) {
+        wakeups++;
+        while (hal_uart_read_frame(frame, sizeof(frame)) > 0) {
+            if (got < sc.num_tags && strcmp(frame, sc.tags[got]) != 0) wrong++;
+            got++;
+        }
+    }
+    double elapsed = now_ms() - start - UART_IDLE_MS;
+    pthread_join(writer, NULL);
+
+    hal_uart_frame_stats_t st;
+    hal_uart_get_frame_stats(&st);
+    printf("%d lines in %.0f ms, %d wakeups\n", UART_LINES, elapsed, wakeups);
+    printf("%-16s %8s %8s\n", "", "got", "expected");
+    printf("%-16s %8d %8d\n", "tags", got, sc.num_tags);
+    printf("%-16s %8lu\n", "reassembled", st.reassembled);
+    printf("%-16s %8lu %8d\n", "partial bytes", st.partial_bytes, sc.partial_bytes);
+    printf("%-16s %8lu %8d\n", "overflow bytes", st.overflow_bytes, sc.overflow_bytes);
+    printf("%-16s %8lu %8d\n", "garbage bytes", st.garbage_bytes, sc.garbage_bytes);
+    int failures = wrong + (got != sc.num_tags) + (st.partial_bytes != (unsigned long)sc.partial_bytes) +
+                   (st.overflow_bytes != (unsigned long)sc.overflow_bytes) +
+                   (st.garbage_bytes != (unsigned long)sc.garbage_bytes);
+    if (wrong) fprintf(stderr, "%d tags came out wrong\n", wrong);
+
+    hal_uart_cleanup();
+    close(sc.master);
+    free(sc.lines);
+    free(sc.tags);
+    return failures ? 1 : 0;
+}
+
+typedef enum { READ_POLLED, READ_POLL, READ_BLOCKING } uart_read_mode_t;
+
+typedef struct {
+    const char* name;
+    uart_read_mode_t mode;
+    int vmin, vtime_ds;
+} uart_read_case_t;
+
+typedef struct {
+    int master;
+    atomic_llong sent_us[UART_LATENCY_TAGS];
+} uart_latency_script_t;
+
+// One tag every 2-8 ms, each carrying its index, then hang up so a reader
+// still blocked in read() gets EIO instead of waiting forever
+static void* uart_latency_writer(void* arg) {
+    uart_latency_script_t* ls = arg;
+    uint32_t seed = 99;
+    usleep(50000); // Let the reader settle into its wait
+    for (int i = 0; i < UART_LATENCY_TAGS; i++) {
+        char tag[16];
+        int len = snprintf(tag, sizeof(tag), "%08X\r\n", (unsigned)i);
+        atomic_store(&ls->sent_us[i], (long long)(now_ms() * 1000.0));
+        if (write(ls->master, tag, len) != len) break;
+        usleep(2000 + uart_rand(&seed) % 6000);
+    }
+    usleep(300000);
+    close(ls->master);
+    return NULL;
+}
+
+// Tag-to-frame latency and read() calls per tag for one way of waiting
+static int uart_latency_case(const uart_read_case_t* rc) {
+    uart_latency_script_t* ls = calloc(1, sizeof(*ls));
+    if (!ls) return 1;
+    ls->master = open_pty();
+    hal_uart_config_t config = {
+        .baud_rate = 115200,
+        .blocking = rc->mode == READ_BLOCKING,
+        .vmin = rc->vmin,
+        .vtime_ds = rc->vtime_ds,
+    };
+    if (ls->master < 0 || hal_uart_open(ptsname(ls->master), &config) != 0) {
+        if (ls->master >= 0) close(ls->master);
+        free(ls);
+        return 1;
+    }
+    pthread_t writer;
+    if (pthread_create(&writer, NULL, uart_latency_writer, ls) != 0) {
+        hal_uart_cleanup();
+        close(ls->master);
+        free(ls);
+        return 1;
+    }
+
+    int got = 0, reads = 0, empty = 0;
+    double total_us = 0, max_us = 0;
+    char buf[256], frame[HAL_UART_MAX_FRAME + 1];
+    double cpu = thread_cpu_ms();
+    while (got < UART_LATENCY_TAGS) {
+        int n;
+        if (rc->mode == READ_POLLED) {
+            usleep(UART_POLL_MS * 1000);
+            n = hal_uart_read(buf, sizeof(buf));
+        } else if (rc->mode == READ_POLL) {
+            n = hal_uart_read_timeout(buf, sizeof(buf), -1);
+        } else {
+            n = hal_uart_read(buf, sizeof(buf));
+        }
+        if (n < 0) break;
+        reads++;
+        if (n == 0) {
+            empty++;
+            continue;
+        }
+        hal_uart_frame_feed(buf, n);
+        while (hal_uart_frame_next(frame, sizeof(frame)) > 0) {
+            unsigned long seq = strtoul(frame, NULL, 16);
+            if (seq >= UART_LATENCY_TAGS) continue;
+            double us = now_ms() * 1000.0 - (double)atomic_load(&ls->sent_us[seq]);
+            total_us += us;
+            if (us > max_us) max_us = us;
+            got++;
+        }
+    }
+    cpu = thread_cpu_ms() - cpu;
+    hal_uart_cleanup();
+    pthread_join(writer, NULL);
+    free(ls);
+
+    printf("%-26s %6d %10.0f %10.0f %10.2f %10d %10.3f\n", rc->name, got,
+           got ? total_us / got : 0.0, max_us, got ? (double)reads / got : 0.0, empty,
+           got ? cpu * 1000.0 / got : 0.0);
+    return got == UART_LATENCY_TAGS ? 0 : 1;
+}
+
+// Rates with and without a termios speed code must read back unchanged
+static int uart_baud_test(void) {
+    static const int rates[] = { 230400, 921600, 250000, 1000000, 3000000 };
+    int master = open_pty();
+    if (master < 0) return 1;
+    int failures = 0;
+    for (size_t i = 0; i < sizeof(rates) / sizeof(rates[0]); i++) {
+        hal_uart_config_t config = { .baud_rate = rates[i] };
+        int got = -1;
+        if (hal_uart_open(ptsname(master), &config) == 0) {
+            got = hal_uart_get_baud();
+            hal_uart_cleanup();
+        }
+        printf("%-26d %10d %s\n", rates[i], got, got == rates[i] ? "ok" : "MISMATCH");
+        failures += got != rates[i];
+    }
+    close(master);
+    return failures;
+}
+
+/**
+ * @brief UART receive path over a pseudo-terminal.
+ * * Frame assembly: a writer thread sends tags, garbage lines, over-long
+ * lines and abandoned half tags to the pty master in random fragments; the
+ * reader uses hal_uart_read_frame() on the slave. Latency: tags sent every
+ * few milliseconds are read with each wait strategy (sleep-and-read, poll(),
+ * blocking reads with VMIN/VTIME), reporting tag-to-frame latency, read()
+ * calls per tag and reader CPU. Baud: standard and BOTHER rates set on the
+ * pty must read back unchanged.
+ * * Usage: --bench uart
+ */
+static int bench_uart(int argc, char* argv[]) {
+    (void)argc; (void)argv;
+    static const uart_read_case_t cases[] = {
+        { "polled every 10 ms", READ_POLLED, 0, 0 },
+        { "poll()", READ_POLL, 0, 0 },
+        { "blocking VMIN=1", READ_BLOCKING, 1, 0 },
+        { "blocking VMIN=64 VTIME=1", READ_BLOCKING, 64, 1 },
+    };
+    int failures = uart_frame_test();
+
+    printf("\n%d tags per mode\n", UART_LATENCY_TAGS);
+    printf("%-26s %6s %10s %10s %10s %10s %10s\n", "mode", "tags", "mean us", "max us",
+           "reads/tag", "empty", "cpu us/tag");
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) failures += uart_latency_case(&cases[i]);
+
+    printf("\n%-26s %10s\n", "baud requested", "reported");
+    failures += uart_baud_test();
+    return failures ? 1 : 0;
+}
+
+typedef struct {
+    uint8_t* data;
+    size_t len, cap;
+    hal_rfid_frame_t* sent;    // Every frame encoded, by sequence number
+    uint8_t (*uids)[HAL_RFID_MAX_UID];
+    bool* intact;              // ...and whether it went out undamaged
+    int num_frames, num_intact;
+} rfid_stream_t;
+
+static void rfid_stream_put(rfid_stream_t* st, const uint8_t* bytes, size_t len) {
+    memcpy(st->data + st->len, bytes, len);
+    st->len += len;
+}
+
+// Back-to-back frames with EM4100-sized and random UIDs; `corrupt_pct` of
+// them get a bit flipped, a byte dropped or are cut short, and `noise_pct`
+// of the gaps get random bytes heavy in sync bytes
+static int rfid_stream_build(rfid_stream_t* st, int frames, int corrupt_pct, int noise_pct, uint32_t seed) {
+    st->cap = (size_t)frames * (HAL_RFID_MAX_FRAME + 8);
+    st->data = malloc(st->cap);
+    st->sent = calloc(frames, sizeof(*st->sent));
+    st->uids = calloc(frames, sizeof(*st->uids));
+    st->intact = calloc(frames, sizeof(*st->intact));
+    st->len = 0;
+    st->num_frames = frames;
+    st->num_intact = 0;
+    if (!st->data || !st->sent || !st->uids || !st->intact) return -1;
+
+    for (int i = 0; i < frames; i++) {
+        hal_rfid_frame_t* f = &st->sent[i];
+        f->uid_len = uart_rand(&seed) % 2 ? 5 : (uint8_t)(1 + uart_rand(&seed) % HAL_RFID_MAX_UID);
+        for (int b = 0; b < f->uid_len; b++) st->uids[i][b] = (uint8_t)uart_rand(&seed);
+        f->uid = st->uids[i];
+        f->protocol = (uint8_t)(uart_rand(&seed) % 32);
+        f->timestamp_ms = uart_rand(&seed);
+        f->seq = (uint16_t)i;
+
+        uint8_t frame[HAL_RFID_MAX_FRAME];
+        int len = hal_rfid_frame_encode(frame, f);
+        st->intact[i] = true;
+        if ((int)(uart_rand(&seed) % 100) < corrupt_pct) {
+            st->intact[i] = false;
+            int at = (int)(uart_rand(&seed) % (uint32_t)len);
+            switch (uart_rand(&seed) % 3) {
+            case 0: frame[at] ^= (uint8_t)(1 << (uart_rand(&seed) % 8)); break;
+            case 1: memmove(frame + at, frame + at + 1, (size_t)(len - at - 1)); len--; break;
+            default: len = at; break;
+            }
+        }
+        if (st->intact[i]) st->num_intact++;
+        rfid_stream_put(st, frame, (size_t)len);
+
+        if ((int)(uart_rand(&seed) % 100) < noise_pct) {
+            int n = 1 + (int)(uart_rand(&seed) % 8);
+            for (int b = 0; b < n; b++) {
+                uint8_t c = uart_rand(&seed) % 2 ? HAL_RFID_SYNC : (uint8_t)uart_rand(&seed);
+                rfid_stream_put(st, &c, 1);
+            }
+        }
+    }
+    return 0;
+}
+
+static void rfid_stream_free(rfid_stream_t* st) {
+    free(st->data);
+    free(st->sent);
+    free(st->uids);
+    free(st->intact);
+}
+
+typedef struct {
+    int good;                  // Decoded, and identical to the next frame sent
+    int salvaged;              // ...of which were damaged (see bench_rfid)
+    int bad;                   // Decoded but not a frame that was sent, or out of order
+} rfid_check_t;
+
+static void rfid_check_frame(const rfid_stream_t* st, const hal_rfid_frame_t* f, int* last, rfid_check_t* check) {
+    // The sequence number wraps; the frame is the next one sent with it
+    int i = *last + 1 + (uint16_t)(f->seq - (*last + 1));
+    const hal_rfid_frame_t* s = i < st->num_frames ? &st->sent[i] : NULL;
+    if (!s || s->protocol != f->protocol || s->uid_len != f->uid_len || s->timestamp_ms != f->timestamp_ms ||
+        memcmp(s->uid, f->uid, f->uid_len) != 0) {
+        check->bad++;
+        return;
+    }
+    *last = i;
+    check->good++;
+    if (!st->intact[i]) check->salvaged++;
+}
+
+// Feed the stream to the decoder in read()-sized pieces (random up to
+// `max_chunk`, or exactly `max_chunk`) and take every frame after each one.
+// Returns the number of frames decoded.
+static long rfid_decode_stream(const rfid_stream_t* st, size_t max_chunk, bool random_chunks, rfid_check_t* check) {
+    uint32_t seed = 1234;
+    long frames = 0;
+    int last = -1;
+    hal_rfid_frame_t f;
+    for (size_t off = 0; off < st->len;) {
+        size_t room;
+        uint8_t* space = hal_rfid_rx_space(&room);
+        size_t n = random_chunks ? 1 + uart_rand(&seed) % max_chunk : max_chunk;
+        if (n > room) n = room;
+        if (n > st->len - off) n = st->len - off;
+        memcpy(space, st->data + off, n);
+        hal_rfid_rx_commit(n);
+        off += n;
+        while (hal_rfid_frame_next(&f)) {
+            frames++;
+            if (check) rfid_check_frame(st, &f, &last, check);
+        }
+    }
+    return frames;
+}
+
+static double time_rfid_decode(const rfid_stream_t* st, long* frames_per_pass) {
+    int passes = 0;
+    double start = now_ms(), elapsed;
+    do {
+        hal_rfid_frame_reset();
+        *frames_per_pass = rfid_decode_stream(st, RFID_READ_CHUNK, false, NULL);
+        passes++;
+        elapsed = now_ms() - start;
+    } while (elapsed < RFID_MIN_MS);
+    return elapsed / passes;
+}
+
+/**
+ * @brief Binary RFID frame decoder. Fuzz: a long stream of frames with
+ * damaged frames and noise between them, fed in random-sized pieces, must
+ * give back every undamaged frame, in order, and nothing else. A frame cut
+ * short by its last byte still decodes when the byte after it happens to be
+ * that byte ("salvaged"); the frame after it must not be lost. Throughput:
+ * clean and noisy streams decoded from read()-sized chunks, compared with
+ * what the UART can deliver at common baud rates.
+ * * Usage: --bench rfid
+ */
+static int bench_rfid(int argc, char* argv[]) {
+    (void)argc; (void)argv;
+    rfid_stream_t noisy = {0}, clean = {0};
+    if (rfid_stream_build(&noisy, RFID_FUZZ_FRAMES, RFID_CORRUPT_PCT, RFID_NOISE_PCT, 2024) != 0 ||
+        rfid_stream_build(&clean, RFID_FUZZ_FRAMES, 0, 0, 7) != 0) {
+        rfid_stream_free(&noisy);
+        rfid_stream_free(&clean);
+        return 1;
+    }
+
+    rfid_check_t check = {0};
+    hal_rfid_frame_reset();
+    rfid_decode_stream(&noisy, 64, true, &check);
+    hal_rfid_frame_stats_t rs;
+    hal_rfid_frame_get_stats(&rs);
+    printf("fuzz: %d frames, %d undamaged, %zu bytes\n", noisy.num_frames, noisy.num_intact, noisy.len);
+    printf("%-16s %8d (expected %d)\n", "recovered", check.good - check.salvaged, noisy.num_intact);
+    printf("%-16s %8d\n", "salvaged", check.salvaged);
+    printf("%-16s %8d\n", "false accepts", check.bad);
+    printf("%-16s %8lu\n", "CRC errors", rs.crc_errors);
+    printf("%-16s %8lu\n", "skipped bytes", rs.skipped_bytes);
+    int lost = noisy.num_intact - (check.good - check.salvaged);
+    int failures = (lost != 0) + (check.bad != 0);
+
+    printf("\n%-8s %10s %12s %10s  (%d-byte reads)\n", "stream", "MB/s", "frames/s", "ns/frame", RFID_READ_CHUNK);
+    rfid_stream_t* streams[] = { &clean, &noisy };
+    const char* names[] = { "clean", "noisy" };
+    double clean_bytes_per_s = 0;
+    for (int i = 0; i < 2; i++) {
+        long frames = 0;
+        double ms = time_rfid_decode(streams[i], &frames);
+        double bytes_per_s = streams[i]->len / ms * 1000.0;
+        if (i == 0) clean_bytes_per_s = bytes_per_s;
+        printf("%-8s %10.1f %12.0f %10.1f\n", names[i], bytes_per_s / 1e6, frames / ms * 1000.0, ms * 1e6 / frames);
+    }
+
+    // 10 bits per byte on the line (8N1); an EM4100 read is a 16-byte frame
+    static const int bauds[] = { 9600, 115200, 921600, 3000000 };
+    int em4100 = HAL_RFID_OVERHEAD + HAL_RFID_FIXED_LEN + 5;
+    printf("\n%-8s %12s %16s\n", "baud", "frames/s", "decoder load");
+    for (size_t i = 0; i < sizeof(bauds) / sizeof(bauds[0]); i++) {
+        double line_bytes_per_s = bauds[i] / 10.0;
+        printf("%-8d %12.0f %15.4f%%\n", bauds[i], line_bytes_per_s / em4100,
+               line_bytes_per_s / clean_bytes_per_s * 100.0);
+    }
+    rfid_stream_free(&noisy);
+    rfid_stream_free(&clean);
+    return failures ? 1 : 0;
+}
+
+// UID of credential `i`: a varying first byte, then i, so every UID is distinct
+static void cred_uid(int i, uint8_t uid[5]) {
+    uint32_t seed = (uint32_t)i;
+    uid[0] = (uint8_t)uart_rand(&seed);
+    for (int b = 0; b < 4; b++) uid[1 + b] = (uint8_t)(i >> (24 - 8 * b));
+}
+
+// Every tenth credential has expired and the next one is not valid yet
+static credential_result_t cred_expected(int i, int entries) {
+    if (i >= entries) return CREDENTIAL_UNKNOWN;
+    if (i % 10 == 0) return CREDENTIAL_EXPIRED;
+    if (i % 10 == 1) return CREDENTIAL_NOT_YET_VALID;
+    return CREDENTIAL_VALID;
+}
+
+// Credentials first..entries-1 as builder input
+static int cred_write_text(const char* path, int first, int entries, time_t now) {
+    FILE* f = fopen(path, "w");
+    if (!f) return -1;
+    fprintf(f, "# %d generated credentials\n", entries - first);
+    for (int i = first; i < entries; i++) {
+        uint8_t uid[5];
+        cred_uid(i, uid);
+        fprintf(f, "rfid %02X%02X%02X%02X%02X ", uid[0], uid[1], uid[2], uid[3], uid[4]);
+        switch (cred_expected(i, entries)) {
+        case CREDENTIAL_EXPIRED: fprintf(f, "%lld %lld", (long long)now - 7200, (long long)now - 3600); break;
+        case CREDENTIAL_NOT_YET_VALID: fprintf(f, "%lld -", (long long)now + 3600); break;
+        default: fprintf(f, "- -"); break;
+        }
+        fprintf(f, " Tag %d\n", i);
+    }
+    fprintf(f, "pin LLUD - - Resident PIN\n");
+    return fclose(f);
+}
+
+static int cmp_double(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return x < y ? -1 : x > y;
+}
+
+/**
+ * @brief Credential store at building scale. Builds a store of RFID tags
+ * (a tenth expired, a tenth not yet valid) with the offline builder, maps
+ * it, and times lookups of known and unknown UIDs, checking every answer.
+ * Then rebuilds it with half the tags removed and checks that the running
+ * store picks the new file up through its inotify watch.
+ * * Usage: --bench credentials [entries]
+ */
+static int bench_credentials(int argc, char* argv[]) {
+    int entries = argc >= 1 ? atoi(argv[0]) : CRED_DEFAULT_ENTRIES;
+    if (entries < 10) entries = 10;
+    char dir[] = "/tmp/creds-XXXXXX";
+    if (!mkdtemp(dir)) {
+        perror("mkdtemp");
+        return 1;
+    }
+    char text[64], db[64];
+    snprintf(text, sizeof(text), "%s/credentials.txt", dir);
+    snprintf(db, sizeof(db), "%s/credentials.db", dir);
+    time_t now = time(NULL);
+
+    int failures = 0;
+    double start = now_ms();
+    if (cred_write_text(text, 0, entries, now) != 0 || credential_store_build(text, db) != 0) failures++;
+    double build_ms = now_ms() - start;
+    start = now_ms();
+    if (!failures && credential_store_open(db) != 0) failures++;
+    double open_ms = now_ms() - start;
+    struct stat st;
+    if (failures || stat(db, &st) != 0) {
+        unlink(text);
+        unlink(db);
+        rmdir(dir);
+        return 1;
+    }
+    printf("%d credentials: %.1f MB store, built in %.0f ms, mapped in %.3f ms\n",
+           entries, st.st_size / 1e6, build_ms, open_ms);
+
+    // Queries: even ones known, odd ones not; UIDs made up front
+    uint8_t (*uids)[5] = malloc((size_t)CRED_LOOKUPS * sizeof(*uids));
+    int* ids = malloc((size_t)CRED_LOOKUPS * sizeof(int));
+    double* lat = malloc((size_t)CRED_TIMED * sizeof(double));
+    if (!uids || !ids || !lat) {
+        free(uids);
+        free(ids);
+        free(lat);
+        credential_store_close();
+        return 1;
+    }
+    uint32_t seed = 5;
+    for (int q = 0; q < CRED_LOOKUPS; q++) {
+        ids[q] = (int)(uart_rand(&seed) % (uint32_t)entries) + (q % 2 ? entries : 0);
+        cred_uid(ids[q], uids[q]);
+    }
+
+    int wrong = 0;
+    start = now_ms();
+    for (int q = 0; q < CRED_LOOKUPS; q++) {
+        if (credential_store_check(CREDENTIAL_RFID, uids[q], 5, now, NULL) != cred_expected(ids[q], entries)) wrong++;
+    }
+    double batch_ns = (now_ms() - start) * 1e6 / CRED_LOOKUPS;
+    for (int q = 0; q < CRED_TIMED; q++) {
+        double t0 = now_ms();
+        credential_store_check(CREDENTIAL_RFID, uids[q], 5, now, NULL);
+        lat[q] = (now_ms() - t0) * 1e6;
+    }
+    qsort(lat, CRED_TIMED, sizeof(double), cmp_double);
+    uint8_t pin[] = { 'L', 'L', 'U', 'D' };
+    if (credential_store_check(CREDENTIAL_PIN, pin, 4, now, NULL) != CREDENTIAL_VALID) wrong++;
+    printf("lookup: %.0f ns mean over %d; one at a time p50 %.0f ns, p99 %.0f ns, max %.0f ns (incl. clock reads)\n",
+           batch_ns, CRED_LOOKUPS, lat[CRED_TIMED / 2], lat[CRED_TIMED * 99 / 100], lat[CRED_TIMED - 1]);
+    printf("answers: %d wrong\n", wrong);
+    failures += wrong != 0;
+
+    // Hot reload: drop the first half, as an admin rebuilding the store would
+    int first = entries / 2;
+    if (cred_write_text(text, first, entries, now) != 0 || credential_store_build(text, db) != 0) failures++;
+    struct pollfd pfd = { .fd = credential_store_get_watch_fd(), .events = POLLIN };
+    start = now_ms();
+    if (pfd.fd < 0 || poll(&pfd, 1, 1000) != 1) {
+        fprintf(stderr, "no change notification\n");
+        failures++;
+    } else {
+        credential_store_handle_watch();
+    }
+    double reload_ms = now_ms() - start;
+    credential_stats_t cs;
+    credential_store_get_stats(&cs);
+    int stale = 0;
+    for (int q = 0; q < CRED_LOOKUPS; q += 2) {
+        credential_result_t want = ids[q] < first ? CREDENTIAL_UNKNOWN : cred_expected(ids[q], entries);
+        if (credential_store_check(CREDENTIAL_RFID, uids[q], 5, now, NULL) != want) stale++;
+    }
+    printf("reload: %lu reloads, %lu entries, picked up in %.2f ms, %d stale answers\n",
+           cs.reloads, cs.entries, reload_ms, stale);
+    failures += cs.reloads != 1 || cs.entries != (unsigned long)(entries - first + 1) || stale != 0;
+
+    credential_store_close();
+    free(uids);
+    free(ids);
+    free(lat);
+    unlink(text);
+    unlink(db);
+    rmdir(dir);
+    return failures ? 1 : 0;
+}
+
+static int dedupe_expect(long got, long expected, const char* what) {
+    if (got == expected) return 0;
+    fprintf(stderr, "%s: got %ld, expected %ld\n", what, got, expected);
+    return 1;
+}
+
+/**
+ * @brief Checks the Flipper bridge's repeat-read filter
+ * (smart_doorbell_flipper/tag_dedupe.c) on scripted reads: a held tag, a
+ * second tag, expiry and the time left to the next one, tick wrap-around and
+ * eviction of the tag seen longest ago once every slot is taken.
+ * * Usage: --bench dedupe
+ */
+static int bench_dedupe(int argc, char* argv[]) {
+    (void)argc; (void)argv;
+    TagDedupe d;
+    const uint8_t a[5] = { 1, 2, 3, 4, 5 }, b[5] = { 9, 9, 9, 9, 9 };
+    int failures = 0;
+
+    // A fob held against the reader, read every 200 ms
+    tag_dedupe_init(&d, 1500);
+    failures += dedupe_expect(tag_dedupe_check(&d, 1, a, 5, 1000), true, "first read");
+    for (uint32_t t = 1200; t < 5000; t += 200) {
+        failures += dedupe_expect(tag_dedupe_check(&d, 1, a, 5, t), false, "held");
+    }
+    failures += dedupe_expect(tag_dedupe_check(&d, 1, b, 5, 5000), true, "second tag");
+    failures += dedupe_expect(tag_dedupe_check(&d, 2, a, 5, 5000), true, "same UID, other protocol");
+    // a was last read at 4800, so it expires at 6300
+    failures += dedupe_expect(tag_dedupe_expire(&d, 5000), 1300, "time to next expiry");
+    failures += dedupe_expect(tag_dedupe_expire(&d, 6300), 200, "after the first expiry");
+    failures += dedupe_expect(tag_dedupe_check(&d, 1, a, 5, 6400), true, "presented again");
+    failures += dedupe_expect(tag_dedupe_expire(&d, 6500), 1400, "others expired");
+    failures += dedupe_expect(tag_dedupe_expire(&d, 7900), 0, "all expired");
+
+    // Tick counter wrapping while the tag is held
+    tag_dedupe_init(&d, 1500);
+    failures += dedupe_expect(tag_dedupe_check(&d, 1, a, 5, 0xFFFFFF00u), true, "before wrap");
+    failures += dedupe_expect(tag_dedupe_check(&d, 1, a, 5, 0x100u), false, "held across wrap");
+    failures += dedupe_expect(tag_dedupe_expire(&d, 0x100u), 1500, "expiry across wrap");
+    failures += dedupe_expect(tag_dedupe_expire(&d, 0x100u + 1500), 0, "expired across wrap");
+    failures += dedupe_expect(tag_dedupe_check(&d, 1, a, 5, 0x100u + 1500), true, "after wrap");
+
+    // One tag more than there are slots: the one seen longest ago is evicted
+    tag_dedupe_init(&d, 100000);
+    for (int i = 0; i <= TAG_DEDUPE_SLOTS; i++) {
+        uint8_t uid = (uint8_t)i;
+        failures += dedupe_expect(tag_dedupe_check(&d, 0, &uid, 1, (uint32_t)i * 10), true, "filling slots");
+    }
+    uint8_t first = 0, last = TAG_DEDUPE_SLOTS, second = 1;
+    failures += dedupe_expect(tag_dedupe_check(&d, 0, &first, 1, 200), true, "evicted tag");
+    failures += dedupe_expect(tag_dedupe_check(&d, 0, &last, 1, 210), false, "kept tag");
+    failures += dedupe_expect(tag_dedupe_check(&d, 0, &second, 1, 220), true, "evicted in turn");
+
+    printf("tag dedupe: %s\n", failures ? "FAIL" : "ok");
+    return failures ? 1 : 0;
+}
+
+typedef struct {
+    const char* name;
+    int (*run)(int argc, char* argv[]);
+} bench_entry;
+
+static const bench_entry benches[] = {
+    { "decode", bench_decode },
+    { "kernels", bench_kernels },
+    { "engines", bench_engines },
+    { "spi", bench_spi },
+    { "iio", bench_iio },
+    { "fft", bench_fft },
+    { "tamper", bench_tamper },
+    { "led", bench_led },
+    { "uart", bench_uart },
+    { "rfid", bench_rfid },
+    { "dedupe", bench_dedupe },
+    { "credentials", bench_credentials },
+};
+
+int bench_run(int argc, char* argv[]) {
+    size_t count = sizeof(benches) / sizeof(benches[0]);
+    if (argc >= 1) {
+        for (size_t i = 0; i < count; i++) {
+            if (strcmp(argv[0], benches[i].name) == 0) return benches[i].run(argc - 1, argv + 1);
+        }
+    }
+    fprintf(stderr, "Available benchmarks:");
+    for (size_t i = 0; i < count; i++) fprintf(stderr, " %s", benches[i].name);
+    fprintf(stderr, "\n");
+    return 1;
+}
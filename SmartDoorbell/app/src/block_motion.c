@@ -0,0 +1,33 @@
+#include "block_motion.h"
+#include <stdbool.h>
+#include <stdlib.h>
+
+#define BLEND_BIAS (1 << 15) // Lifts any blended int16 value to non-negative before the shift
+
+static inline int16_t blend_coef(int16_t bg, int16_t curr, uint8_t alpha) {
+    // Coefficients are signed, so bias into unsigned range: the shift is then a
+    // well-defined floor division by 256 and the loop stays branch-free
+    uint32_t v = (uint32_t)(bg * (256 - alpha) + curr * alpha + 128 + (BLEND_BIAS << 8));
+    return (int16_t)((int32_t)(v >> 8) - BLEND_BIAS);
+}
+
+size_t block_motion_diff_update(int16_t* bg, const int16_t* curr, size_t blocks, int coefs_per_block,
+                                int dc_thresh, int ac_thresh, uint8_t alpha) {
+    size_t count = 0;
+    int16_t* bg_h = bg + blocks;
+    int16_t* bg_v = bg + 2 * blocks;
+    const int16_t* curr_h = curr + blocks;
+    const int16_t* curr_v = curr + 2 * blocks;
+
+    for (size_t i = 0; i < blocks; i++) {
+        bool changed = abs(curr[i] - bg[i]) > dc_thresh;
+        if (coefs_per_block == 3) {
+            changed |= abs(curr_h[i] - bg_h[i]) + abs(curr_v[i] - bg_v[i]) > ac_thresh;
+            bg_h[i] = blend_coef(bg_h[i], curr_h[i], alpha);
+            bg_v[i] = blend_coef(bg_v[i], curr_v[i], alpha);
+        }
+        bg[i] = blend_coef(bg[i], curr[i], alpha);
+        count += changed;
+    }
+    return count;
+}
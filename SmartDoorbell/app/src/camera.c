@@ -1,142 +1,822 @@
 /**
  * @file camera.c
  * @brief Handles image capture and motion detection logic.
- * * This module downloads JPEG images from the ESP32-CAM via HTTP (wget),
- * decodes them into RGB buffers, and compares sequential frames to detect
- * significant changes (motion). It uses a simple background subtraction
- * algorithm with a running average update.
+ * * This module pulls JPEG images from the ESP32-CAM over a persistent HTTP/1.1
+ * connection (see http_client.c): by default it subscribes once to the
+ * multipart MJPEG stream at "/" and takes frames off the socket as the camera
+ * produces them, so no frame pays request latency or per-request sensor setup.
+ * Polling /still remains available as a fallback source. Frames are decoded
+ * in memory at reduced resolution (see jpeg_decoder.c), and sequential frames
+ * are compared to detect significant changes (motion). Only the luma channel is decoded: the
+ * background model is a single 8-bit brightness plane, updated with a running
+ * average. At the default 1/4 scale an SVGA frame's plane is 30 KB and stays
+ * resident in L2. Two compressed-domain engines skip the IDCT altogether and
+ * compare the DC (and optionally first AC) coefficient of each 8x8 luma block
+ * against a background block model instead (see block_motion.c).
+ * * Capture and analysis run on their own threads so a slow camera never stalls
+ * the control loop. The capture thread fills JPEG slots handed over through a
+ * lock-free triple buffer: the analysis thread always picks up the newest frame,
+ * and frames it was too slow for are dropped (and counted). With the
+ * CAMERA_DROP_NONE policy capture instead waits for analysis, which lets TCP
+ * flow control slow the stream down. Motion verdicts are
+ * published as an atomic event counter that camera_poll_motion() reads, and
+ * signalled on an eventfd so the control loop can sleep until one arrives.
+ * * Every frame-sized buffer (JPEG slots, decoded planes, background models)
+ * is borrowed from a size-classed pool reserved once against POOL_BUDGET_BYTES
+ * (see frame_pool.c), so the pipeline makes no heap allocations per frame once
+ * warm. camera_print_stats() reports the allocation counter that shows it.
+ * * Every captured JPEG is also copied into a fixed-size pre-event ring (see
+ * frame_ring.c), so an alert can carry the seconds leading up to it:
+ * camera_request_preroll() has the export thread freeze the ring and write
+ * that window to disk, and signals an eventfd when the files are in place, so
+ * the control loop never waits on the disk.
  */
 
+#define _GNU_SOURCE
 #include "camera.h"
+#include "http_client.h"
+#include "jpeg_decoder.h"
+#include "block_motion.h"
+#include "motion_kernels.h"
+#include "triple_buffer.h"
+#include "frame_pool.h"
+#include "frame_ring.h"
 #include <stdio.h>
 #include <stdlib.h>
-#include <jpeglib.h>
 #include <string.h>
-#include <math.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <sys/eventfd.h>
+#include <stdatomic.h>
 
 // --- Configuration ---
-#define IMG_PATH "/tmp/visitor.jpg" // File path for the downloaded image. /tmp is usually a RAM disk, reducing flash wear/latency.
+#define IMG_PATH "/tmp/visitor.jpg" // Snapshot read by server.js. /tmp is usually a RAM disk, reducing flash wear/latency.
+#define IMG_TMP_PATH IMG_PATH ".tmp" // Written first, then renamed so readers never see a partial JPEG.
+#define CAMERA_PORT 80
+#define STILL_PATH "/still"         // ESP32 still-capture endpoint (WebStreamModule.h)
+#define STREAM_PATH "/"             // ESP32 multipart MJPEG stream endpoint (WebStreamModule.h)
+#define FETCH_TIMEOUT_MS 1000       // Connect/receive timeout for one frame
+#define CAPTURE_INTERVAL_MS 100     // Minimum time between /still fetch starts (caps the ESP32 at 10 fps)
+#define RECONNECT_DELAY_MS 1000     // Wait before reopening a broken stream
+#define HANDOFF_WAIT_MS 100         // CAMERA_DROP_NONE: recheck `running` this often while waiting
 #define MOTION_THRESH 0.15          // Threshold: if >15% of pixels change, motion is detected.
-#define PIXEL_THRESH 60             // Sensitivity: Minimum RGB difference (0-255) to consider a pixel "changed".
+#define PIXEL_THRESH 60             // Sensitivity: Minimum luma difference (0-255) to consider a pixel "changed".
+#define BG_ALPHA_Q8 51              // Background update weight of the new frame, in 1/256ths (51/256 ~ 20%).
+#define DEFAULT_SCALE_DENOM 4       // Decode at 1/4 size: SVGA 800x600 becomes 200x150 (16x fewer pixels).
+#define DC_THRESH (8 * 30)          // Block engines: DC change for a mean luma shift of 30 (DC = 8 * mean).
+#define AC_THRESH 400               // Block engines: |dAC_h| + |dAC_v| for an edge moving within a block.
+
+#define NUM_SLOTS 3
+#define JPEG_SLOT_BYTES (192 * 1024)         // Initial slot size; OV2640 SVGA JPEGs are 20-100 KB
+#define POOL_BUDGET_BYTES (2 * 1024 * 1024)  // Startup memory budget for every frame buffer
+#define PREROLL_DIR "/tmp/preroll"           // Pre-event frames for server.js (index.txt + frame_NNN.jpg)
+#define DEFAULT_PREROLL_BYTES (4 * 1024 * 1024) // ~10 s of SVGA stream at 10 fps and ~40 KB per frame
+#define DEFAULT_PREROLL_MS 5000              // Window exported per event
+
+// Size classes, smallest first. A request that finds its class empty spills
+// into a larger one.
+static const frame_pool_class_t pool_classes[] = {
+    {  64 * 1024, 4 }, // Analysis planes: 1/4 SVGA luma is 30 KB, dc+ac blocks 45 KB (current + background + spares)
+    { 192 * 1024, 3 }, // One JPEG per triple-buffer slot
+    { 512 * 1024, 2 }, // 1/1 and 1/2 scale luma planes, or oversized JPEGs
+};
+
+// One JPEG frame handed from the capture thread to the analysis thread
+typedef struct {
+    unsigned char* data;
+    size_t len;
+    size_t cap;
+    struct timespec fetch_start; // For capture-to-verdict latency
+} frame_slot_t;
 
 // --- State Variables ---
-static unsigned char* bg_buffer = NULL; // Buffer holding the "background" (previous) frame for comparison.
-static int img_w = 0, img_h = 0;        // Dimensions of the current video stream.
-
-/**
- * @brief Helper function to decode a JPEG file into a raw RGB byte array.
- * * Uses libjpeg to decompress the image.
- * * @param filename Path to the JPEG file.
- * @param w Pointer to store the output width.
- * @param h Pointer to store the output height.
- * @return unsigned char* Pointer to the allocated RGB buffer (must be freed by caller), or NULL on failure.
- */
-unsigned char* load_jpeg(const char* filename, int* w, int* h) {
-    struct jpeg_decompress_struct cinfo;
-    struct jpeg_error_mgr jerr;
-    
-    // Open the image file
-    FILE* infile = fopen(filename, "rb");
-    if (!infile) return NULL;
-
-    // Initialize the JPEG decompression object with default error handling
-    cinfo.err = jpeg_std_error(&jerr);
-    jpeg_create_decompress(&cinfo);
-    jpeg_stdio_src(&cinfo, infile);
-    
-    // Read file header to get image info (width/height)
-    jpeg_read_header(&cinfo, TRUE);
-    jpeg_start_decompress(&cinfo);
-
-    *w = cinfo.output_width;
-    *h = cinfo.output_height;
-    
-    // Allocate memory for the raw RGB data (width * height * 3 bytes per pixel)
-    unsigned char* buf = malloc((*w) * (*h) * cinfo.output_components);
-    unsigned char* rowptr[1]; // Pointer array for the scanline
-
-    // Read scanlines one by one into the buffer
-    while (cinfo.output_scanline < cinfo.output_height) {
-        // Calculate the pointer to the current row in our buffer
-        rowptr[0] = &buf[cinfo.output_scanline * (*w) * cinfo.output_components];
-        jpeg_read_scanlines(&cinfo, rowptr, 1);
-    }
-    
-    // Clean up libjpeg resources and file handle
-    jpeg_finish_decompress(&cinfo);
-    jpeg_destroy_decompress(&cinfo);
-    fclose(infile);
-    return buf;
+// Owned by the analysis thread
+static unsigned char* bg_buffer = NULL; // Luma plane (1 byte per pixel) holding the "background" for comparison.
+static int16_t* bg_coefs = NULL;        // Block engines: per-block coefficient planes of the background.
+static camera_motion_engine_t bg_engine; // Engine that built the current background model.
+static size_t plane_hint = 0;           // Bytes the last decoded plane needed (sizes the next pool borrow).
+static atomic_int img_w = 0, img_h = 0; // Dimensions of the decoded frames, or of the block grid (read by camera_print_stats).
+
+// Shared between threads
+static frame_slot_t slots[NUM_SLOTS];
+static triple_buffer_t frames;
+static sem_t frame_ready;                // Posted by capture for every published frame
+static sem_t frame_taken;                // Posted by analysis when it picks up a frame capture waits on
+static atomic_bool handoff_waiting = false; // Capture is in wait_for_handoff()
+static pthread_mutex_t front_lock = PTHREAD_MUTEX_INITIALIZER; // Holds the reader's slot still while a snapshot is written
+static pthread_t capture_thread, analysis_thread;
+static atomic_bool running = false;
+static atomic_int scale_denom = DEFAULT_SCALE_DENOM;
+static camera_source_t source = CAMERA_SOURCE_STREAM; // Read by the capture thread only after camera_start()
+static atomic_int drop_policy = CAMERA_DROP_STALE;
+static atomic_int motion_engine = CAMERA_ENGINE_PIXEL;
+static atomic_uint motion_events = 0;   // Incremented per positive verdict
+static unsigned int motion_seen = 0;    // Control-loop side of motion_events
+static int event_fd = -1;               // Signalled per positive verdict, for the control loop's epoll
+static pthread_t export_thread;
+static sem_t export_wake;               // Posted per pre-event export request
+static atomic_uint export_requests = 0; // Tickets handed out by camera_request_preroll()
+static atomic_uint export_done = 0;     // Highest ticket whose export has finished
+static atomic_int export_result = -1;   // Frames written by the last export, or -1
+static int export_fd = -1;              // Signalled per finished export, for the control loop's epoll
+
+static bool pool_ready = false;
+static size_t preroll_bytes = DEFAULT_PREROLL_BYTES;
+static int preroll_ms = DEFAULT_PREROLL_MS;
+static bool ring_ready = false;
+
+static struct {
+    atomic_ulong captured, analyzed, dropped, fetch_failures;
+    atomic_ullong fetch_ns, decode_ns, analyze_ns, latency_ns;
+    atomic_ulong warm_allocs_base; // Pipeline heap allocations when the first frame was analyzed
+} stats;
+
+// Heap allocations made on behalf of the pipeline: the pool arena, HTTP body
+// buffer growth and libjpeg's working memory.
+static unsigned long pipeline_allocs(void) {
+    frame_pool_stats_t pool;
+    http_client_stats_t http;
+    frame_pool_get_stats(&pool);
+    http_client_get_stats(&http);
+    return pool.heap_allocs + http.allocs + jpeg_decoder_heap_allocs();
+}
+
+static unsigned long long elapsed_ns(const struct timespec* start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) * 1000000000ULL + (now.tv_nsec - start->tv_nsec);
 }
 
 /**
  * @brief Initialize the camera module.
- * * Clears any stale images from the temp directory to ensure a clean state start.
+ * * Clears any stale images from the temp directory to ensure a clean state start,
+ * and selects the motion kernels for this CPU.
  */
-void camera_init(void) { system("rm -f " IMG_PATH); }
+void camera_init(void) {
+    unlink(IMG_PATH);
+    if (event_fd < 0) {
+        event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (event_fd < 0) perror("Error creating camera eventfd");
+    }
+    if (export_fd < 0) {
+        export_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (export_fd < 0) perror("Error creating camera export eventfd");
+    }
+    printf("[CAMERA] Motion kernels: %s\n", motion_kernels_get()->name);
+}
 
 /**
- * @brief Capture a still image from the ESP32-CAM.
- * * Executes a shell command (wget) to download the image. 
- * Includes a timeout to prevent the main loop from hanging if the camera is offline.
- * * @param ip The IP address of the ESP32-CAM.
- * @return int Status code from system() call (0 usually means success).
+ * @brief Set the DCT-domain downscale used when decoding frames for analysis.
+ * * The background model is rebuilt automatically on the next frame because the
+ * decoded dimensions change.
+ * * @param denom 1, 2, 4 or 8.
+ * @return int 0 on success, -1 for an unsupported value.
+ */
+int camera_set_decode_scale(int denom) {
+    if (denom != 1 && denom != 2 && denom != 4 && denom != 8) return -1;
+    atomic_store(&scale_denom, denom);
+    return 0;
+}
+
+/**
+ * @brief Select the motion detection engine.
+ * * The background model is rebuilt from the next frame after a switch.
+ */
+void camera_set_motion_engine(camera_motion_engine_t engine) {
+    atomic_store(&motion_engine, engine);
+}
+
+/**
+ * @brief Select where frames come from.
+ * * CAMERA_SOURCE_STREAM reads the ESP32's continuous MJPEG stream; the frame
+ * rate is then set by the camera, not by CAPTURE_INTERVAL_MS.
+ * CAMERA_SOURCE_STILL polls /still. Only takes effect on the next camera_start().
+ */
+void camera_set_source(camera_source_t src) {
+    if (!atomic_load(&running)) source = src;
+}
+
+/**
+ * @brief Select what happens to frames when analysis is slower than capture.
+ * * CAMERA_DROP_STALE keeps only the newest frame (lowest capture-to-verdict
+ * latency). CAMERA_DROP_NONE analyzes every frame, pacing capture to analysis.
+ */
+void camera_set_drop_policy(camera_drop_policy_t policy) {
+    atomic_store(&drop_policy, policy);
+}
+
+/**
+ * @brief Configure the pre-event ring: its memory footprint and the window
+ * exported per event. Takes effect on the next camera_start().
+ * * @return int 0 on success, -1 while running or for invalid values.
+ */
+int camera_set_preroll(size_t bytes, int window_ms) {
+    if (atomic_load(&running) || bytes == 0 || window_ms <= 0) return -1;
+    preroll_bytes = bytes;
+    preroll_ms = window_ms;
+    if (ring_ready) {
+        frame_ring_cleanup();
+        ring_ready = false;
+    }
+    return 0;
+}
+
+/**
+ * @brief Ask the export thread to write the frames captured during the last
+ * pre-event window to PREROLL_DIR, oldest first, with their timestamps in
+ * index.txt.
+ * * Called for alerts so server.js can attach what happened before the event.
+ * Requests made while an export runs are served together by the next one.
+ * * @param ticket Set to the request's ticket; it is done once
+ * camera_poll_preroll() returns a ticket at least this high.
+ * @return int 0 on success, -1 if the camera or its export thread is not running.
+ */
+int camera_request_preroll(unsigned int* ticket) {
+    if (!ring_ready || export_fd < 0 || !atomic_load(&running)) return -1;
+    *ticket = atomic_fetch_add(&export_requests, 1) + 1;
+    sem_post(&export_wake);
+    return 0;
+}
+
+/**
+ * @brief File descriptor that becomes readable when a requested export has
+ * finished; then call camera_poll_preroll(). -1 if it could not be created.
  */
-int camera_capture(const char* ip) {
-    char cmd[256];
-    // Construct the command: 
-    // -q: Quiet mode (no output)
-    // -O: Output filename
-    // -T 1: 1-second timeout
-    snprintf(cmd, sizeof(cmd), "wget -q -O %s -T 1 http://%s/still", IMG_PATH, ip);
-    return system(cmd);
+int camera_get_preroll_fd(void) {
+    return export_fd;
 }
 
 /**
- * @brief Analyze the captured image for motion.
- * * Compares the latest downloaded image against a stored background buffer.
+ * @brief Check for finished exports without blocking.
+ * * @param frames Set to the frames written by the last export, or -1 if it failed.
+ * @return unsigned int The highest ticket whose export has finished.
+ */
+unsigned int camera_poll_preroll(int* frames) {
+    uint64_t count;
+    if (export_fd >= 0 && read(export_fd, &count, sizeof(count)) < 0) {
+        // EAGAIN: nothing pending
+    }
+    if (frames) *frames = atomic_load(&export_result);
+    return atomic_load(&export_done);
+}
+
+/**
+ * @brief Write the latest analyzed frame to IMG_PATH for server.js.
+ * * Frames normally stay in memory; this is only called when an alert needs an
+ * image. The file is written under a temporary name and renamed into place, so
+ * readers only ever see complete JPEGs.
+ * * @return int 0 on success, -1 if there is no frame or the write failed.
+ */
+int camera_save_snapshot(void) {
+    int ret = -1;
+    pthread_mutex_lock(&front_lock);
+    const frame_slot_t* slot = &slots[triple_buffer_read_index(&frames)];
+    if (slot->len > 0) {
+        int fd = open(IMG_TMP_PATH, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd >= 0) {
+            size_t done = 0;
+            while (done < slot->len) {
+                ssize_t n = write(fd, slot->data + done, slot->len - done);
+                if (n <= 0) break;
+                done += n;
+            }
+            close(fd);
+            if (done == slot->len) ret = rename(IMG_TMP_PATH, IMG_PATH);
+        }
+    }
+    pthread_mutex_unlock(&front_lock);
+    return ret;
+}
+
+/**
+ * @brief Capture one image from the ESP32-CAM into a frame slot.
+ * * In stream mode this reads the next multipart part from the open stream; in
+ * still mode it fetches /still over a keep-alive HTTP connection that is reused
+ * across calls. The body is copied out of the client's buffer because that
+ * buffer is reused by the next read.
+ * * @return int 0 on success, -1 on failure.
+ */
+static int capture_frame(frame_slot_t* slot) {
+    const unsigned char* jpg;
+    size_t len;
+    clock_gettime(CLOCK_MONOTONIC, &slot->fetch_start);
+    int ret = (source == CAMERA_SOURCE_STREAM) ? http_client_stream_next(&jpg, &len)
+                                               : http_client_get(STILL_PATH, &jpg, &len);
+    if (ret != 0) return -1;
+
+    if (len > slot->cap) {
+        // Move to a larger pool block; the frame is dropped if none is free
+        size_t cap;
+        unsigned char* data = frame_pool_get(len, &cap);
+        if (!data) return -1;
+        frame_pool_put(slot->data);
+        slot->data = data;
+        slot->cap = cap;
+    }
+    memcpy(slot->data, jpg, len);
+    slot->len = len;
+    return 0;
+}
+
+// Return both background models to the pool
+static void reset_background(void) {
+    frame_pool_put(bg_buffer);
+    frame_pool_put(bg_coefs);
+    bg_buffer = NULL;
+    bg_coefs = NULL;
+}
+
+/**
+ * @brief Decode a frame for `engine` into a pool block.
+ * * The block is sized from the previous frame; if this frame needs more, the
+ * decoder reports the size without decoding and one retry is made with a
+ * larger block.
+ * * @return The block (return it with frame_pool_put()), or NULL.
+ */
+static void* decode_to_pool(const frame_slot_t* slot, camera_motion_engine_t engine, int* w, int* h) {
+    int coefs = (engine == CAMERA_ENGINE_DC_AC) ? 3 : 1;
+    size_t cap;
+    void* buf = frame_pool_get(plane_hint, &cap);
+    for (int attempt = 0; buf && attempt < 2; attempt++) {
+        long needed = (engine == CAMERA_ENGINE_PIXEL)
+            ? jpeg_decode_mem_into(slot->data, slot->len, JPEG_DECODE_GRAY,
+                                   atomic_load(&scale_denom), buf, cap, w, h)
+            : jpeg_decode_luma_coefs_into(slot->data, slot->len, coefs, buf, cap, w, h);
+        if (needed < 0) break;
+        plane_hint = needed;
+        if ((size_t)needed <= cap) return buf;
+        frame_pool_put(buf);
+        buf = frame_pool_get(needed, &cap);
+    }
+    frame_pool_put(buf);
+    return NULL;
+}
+
+/**
+ * @brief Analyze a frame for motion.
+ * * Compares the luma of the frame against the stored background plane.
  * If pixels differ by more than PIXEL_THRESH, they count as "changed".
  * If the total percentage of changed pixels exceeds MOTION_THRESH, motion is reported.
  * The background is also updated using a running average to adapt to lighting changes.
- * * @return true if motion is detected, false otherwise.
+ * * @param motion Set to true if motion is detected.
+ * @return int 0 if the frame was analyzed, -1 if it could not be decoded.
  */
-bool camera_check_motion(void) {
+static int analyze_frame_pixels(const frame_slot_t* slot, bool* motion) {
     int w, h;
-    // Decode the image downloaded by camera_capture()
-    unsigned char* curr = load_jpeg(IMG_PATH, &w, &h);
-    if (!curr) return false;
+    struct timespec t0, t1;
+    *motion = false;
+
+    // Decode downscaled for analysis
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    unsigned char* curr = decode_to_pool(slot, CAMERA_ENGINE_PIXEL, &w, &h);
+    if (!curr) return -1;
+    atomic_fetch_add(&stats.decode_ns, elapsed_ns(&t0));
 
     // Initialize background if empty or if image dimensions changed
-    if (!bg_buffer || w != img_w || h != img_h) {
-        if (bg_buffer) free(bg_buffer);
+    if (!bg_buffer || bg_engine != CAMERA_ENGINE_PIXEL || w != img_w || h != img_h) {
+        reset_background();
         bg_buffer = curr;   // Set current frame as the new baseline
+        bg_engine = CAMERA_ENGINE_PIXEL;
         img_w = w; img_h = h;
-        return false;   // Cannot detect motion on the very first frame
+        return 0;       // Cannot detect motion on the very first frame
     }
 
-    long diff_count = 0;
-    long total_bytes = w * h * 3; // Total bytes (RGB)
+    size_t total_pixels = (size_t)w * h; // One luma byte per pixel
 
-    for (long i = 0; i < total_bytes; i+=3) { // Check RGB
-        int diff = abs(curr[i] - bg_buffer[i]);
-        if (diff > PIXEL_THRESH) diff_count++;
+    // Count changed pixels and update the background using a Running Average in
+    // one vectorized pass (see motion_kernels.c).
+    // This slowly blends the current frame into the background (80% old, 20% new)
+    // allowing the system to adapt to slow lighting changes (e.g., sun setting)
+    // without triggering false positives, while fast changes (people) trigger motion.
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    size_t diff_count = motion_kernels_get()->diff_update(bg_buffer, curr, total_pixels,
+                                                          PIXEL_THRESH, BG_ALPHA_Q8);
+    atomic_fetch_add(&stats.analyze_ns, elapsed_ns(&t1));
 
-        // Update background using Running Average Algorithm
-        // This slowly blends the current frame into the background (80% old, 20% new)
-        // allowing the system to adapt to slow lighting changes (e.g., sun setting)
-        // without triggering false positives, while fast changes (people) trigger motion.
-        bg_buffer[i] = (unsigned char)((bg_buffer[i]*0.8) + (curr[i]*0.2));
-    }
-    
     // Current frame is no longer needed (background buffer persists)
-    free(curr);
+    frame_pool_put(curr);
 
-    // Return true if the ratio of changed pixels exceeds the defined threshold
-    return ((float)diff_count / (float)(w*h)) > MOTION_THRESH;
+    // Motion if the ratio of changed pixels exceeds the defined threshold
+    *motion = ((float)diff_count / (float)total_pixels) > MOTION_THRESH;
+    return 0;
+}
+
+/**
+ * @brief Analyze a frame for motion in the compressed domain.
+ * * Only entropy decoding runs: the luma DC (and, for CAMERA_ENGINE_DC_AC, the
+ * first horizontal and vertical AC) coefficient of each 8x8 block is compared
+ * against a background block model. An SVGA frame becomes a 100x75 block grid,
+ * the same resolution as a 1/8 pixel decode but without any IDCT. Motion is
+ * reported when more than MOTION_THRESH of the blocks changed.
+ * * @param motion Set to true if motion is detected.
+ * @return int 0 if the frame was analyzed, -1 if it could not be decoded.
+ */
+static int analyze_frame_blocks(const frame_slot_t* slot, camera_motion_engine_t engine, bool* motion) {
+    int bw, bh;
+    int coefs = (engine == CAMERA_ENGINE_DC_AC) ? 3 : 1;
+    struct timespec t0, t1;
+    *motion = false;
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    int16_t* curr = decode_to_pool(slot, engine, &bw, &bh);
+    if (!curr) return -1;
+    atomic_fetch_add(&stats.decode_ns, elapsed_ns(&t0));
+
+    // New baseline on the first frame, after an engine switch, or if the grid changed
+    if (!bg_coefs || bg_engine != engine || bw != img_w || bh != img_h) {
+        reset_background();
+        bg_coefs = curr;
+        bg_engine = engine;
+        img_w = bw; img_h = bh;
+        return 0;
+    }
+
+    size_t total_blocks = (size_t)bw * bh;
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    size_t diff_count = block_motion_diff_update(bg_coefs, curr, total_blocks, coefs,
+                                                 DC_THRESH, AC_THRESH, BG_ALPHA_Q8);
+    atomic_fetch_add(&stats.analyze_ns, elapsed_ns(&t1));
+    frame_pool_put(curr);
+
+    *motion = ((float)diff_count / (float)total_blocks) > MOTION_THRESH;
+    return 0;
+}
+
+// Run the selected engine on one frame
+static int analyze_frame(const frame_slot_t* slot, bool* motion) {
+    camera_motion_engine_t engine = atomic_load(&motion_engine);
+    if (engine == CAMERA_ENGINE_PIXEL) return analyze_frame_pixels(slot, motion);
+    return analyze_frame_blocks(slot, engine, motion);
+}
+
+static void add_ms(struct timespec* ts, long ms) {
+    ts->tv_nsec += ms * 1000000L;
+    while (ts->tv_nsec >= 1000000000L) {
+        ts->tv_nsec -= 1000000000L;
+        ts->tv_sec++;
+    }
+}
+
+// CAMERA_DROP_NONE: block until analysis has taken the published frame.
+// Analysis only posts frame_taken while handoff_waiting is set, so the count
+// cannot build up in CAMERA_DROP_STALE mode.
+static void wait_for_handoff(void) {
+    for (;;) {
+        // Raised before the check, so a pick-up after it always posts
+        atomic_store(&handoff_waiting, true);
+        if (!atomic_load(&running) || atomic_load(&drop_policy) != CAMERA_DROP_NONE ||
+            !triple_buffer_pending(&frames)) {
+            break;
+        }
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        add_ms(&deadline, HANDOFF_WAIT_MS);
+        sem_timedwait(&frame_taken, &deadline);
+    }
+    atomic_store(&handoff_waiting, false);
+}
+
+static void publish_frame(const frame_slot_t* slot) {
+    atomic_fetch_add(&stats.fetch_ns, elapsed_ns(&slot->fetch_start));
+    atomic_fetch_add(&stats.captured, 1);
+    frame_ring_push(slot->data, slot->len);
+    wait_for_handoff();
+    // Overwriting a frame the analysis thread never picked up is a drop
+    if (triple_buffer_publish(&frames)) atomic_fetch_add(&stats.dropped, 1);
+    sem_post(&frame_ready);
+}
+
+// Sleep until `deadline`, waking early if the camera is stopped
+static void sleep_until(const struct timespec* deadline) {
+    for (;;) {
+        struct timespec now, next;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        if (!atomic_load(&running) || now.tv_sec > deadline->tv_sec ||
+            (now.tv_sec == deadline->tv_sec && now.tv_nsec >= deadline->tv_nsec)) {
+            return;
+        }
+        next = now;
+        add_ms(&next, HANDOFF_WAIT_MS);
+        if (next.tv_sec > deadline->tv_sec ||
+            (next.tv_sec == deadline->tv_sec && next.tv_nsec > deadline->tv_nsec)) {
+            next = *deadline;
+        }
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+    }
+}
+
+// Capture thread (stream source): subscribe once, publish frames as they arrive
+static void stream_capture_loop(void) {
+    bool open = false;
+    while (atomic_load(&running)) {
+        if (!open && http_client_stream_open(STREAM_PATH) == 0) open = true;
+
+        frame_slot_t* slot = &slots[triple_buffer_write_index(&frames)];
+        if (open && capture_frame(slot) == 0) {
+            publish_frame(slot);
+            continue;
+        }
+
+        // Connect failed or the stream broke (the client has closed it):
+        // back off, then resubscribe
+        atomic_fetch_add(&stats.fetch_failures, 1);
+        open = false;
+        struct timespec retry;
+        clock_gettime(CLOCK_MONOTONIC, &retry);
+        add_ms(&retry, RECONNECT_DELAY_MS);
+        sleep_until(&retry);
+    }
+}
+
+// Capture thread (still source): fetch at most every CAPTURE_INTERVAL_MS
+static void still_capture_loop(void) {
+    struct timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+
+    while (atomic_load(&running)) {
+        frame_slot_t* slot = &slots[triple_buffer_write_index(&frames)];
+        if (capture_frame(slot) == 0) {
+            publish_frame(slot);
+        } else {
+            atomic_fetch_add(&stats.fetch_failures, 1);
+        }
+
+        // Fixed-rate schedule; after a slow fetch, restart from now instead of bursting
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        add_ms(&next, CAPTURE_INTERVAL_MS);
+        if (next.tv_sec < now.tv_sec || (next.tv_sec == now.tv_sec && next.tv_nsec < now.tv_nsec)) {
+            next = now;
+        }
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+    }
+}
+
+// Capture thread: publish the newest frame for analysis
+static void* capture_thread_func(void* args) {
+    (void)args;
+    if (source == CAMERA_SOURCE_STREAM) {
+        stream_capture_loop();
+    } else {
+        still_capture_loop();
+    }
+    return NULL;
+}
+
+// Analysis thread: decode + analyze the newest frame, publish the verdict
+static void* analysis_thread_func(void* args) {
+    (void)args;
+    while (atomic_load(&running)) {
+        if (sem_wait(&frame_ready) != 0) continue; // EINTR
+        if (!atomic_load(&running)) break;
+
+        pthread_mutex_lock(&front_lock);
+        bool fresh = triple_buffer_acquire(&frames);
+        pthread_mutex_unlock(&front_lock);
+        if (!fresh) continue; // Several posts can cover one frame
+        if (atomic_exchange(&handoff_waiting, false)) sem_post(&frame_taken);
+
+        const frame_slot_t* slot = &slots[triple_buffer_read_index(&frames)];
+        bool motion;
+        if (analyze_frame(slot, &motion) != 0) continue;
+
+        atomic_fetch_add(&stats.latency_ns, elapsed_ns(&slot->fetch_start));
+        // The pipeline counts as warm once the first frame has been analyzed
+        if (atomic_load(&stats.analyzed) == 0) {
+            atomic_store(&stats.warm_allocs_base, pipeline_allocs());
+        }
+        atomic_fetch_add(&stats.analyzed, 1);
+        if (motion) {
+            atomic_fetch_add(&motion_events, 1);
+            uint64_t one = 1;
+            if (event_fd >= 0 && write(event_fd, &one, sizeof(one)) < 0) {
+                // Counter saturated; the reader is already due to wake up
+            }
+        }
+    }
+    jpeg_decoder_release();
+    return NULL;
+}
+
+// Export thread: writes the pre-event window whenever an alert asks for it
+static void* export_thread_func(void* args) {
+    (void)args;
+    while (atomic_load(&running)) {
+        if (sem_wait(&export_wake) != 0) continue; // EINTR
+        if (!atomic_load(&running)) break;
+        // One export serves every request made so far
+        while (sem_trywait(&export_wake) == 0) {}
+        unsigned int served = atomic_load(&export_requests);
+        atomic_store(&export_result, frame_ring_export(PREROLL_DIR));
+        atomic_store(&export_done, served);
+        uint64_t one = 1;
+        if (export_fd >= 0 && write(export_fd, &one, sizeof(one)) < 0) {
+            // Counter saturated; the reader is already due to wake up
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Start the capture, analysis and pre-event export threads.
+ * * @param ip The IP address of the ESP32-CAM.
+ * @return int 0 on success, -1 on failure.
+ */
+int camera_start(const char* ip) {
+    if (atomic_load(&running)) return 0;
+    if (http_client_init(ip, CAMERA_PORT, FETCH_TIMEOUT_MS) != 0) return -1;
+
+    // Reserve every frame buffer up front
+    if (!pool_ready) {
+        if (frame_pool_init(pool_classes, sizeof(pool_classes) / sizeof(pool_classes[0]),
+                            POOL_BUDGET_BYTES) != 0) {
+            return -1;
+        }
+        pool_ready = true;
+        for (int i = 0; i < NUM_SLOTS; i++) {
+            slots[i].data = frame_pool_get(JPEG_SLOT_BYTES, &slots[i].cap);
+        }
+    }
+    if (!ring_ready) {
+        if (frame_ring_init(preroll_bytes, preroll_ms) != 0) return -1;
+        ring_ready = true;
+    }
+
+    triple_buffer_init(&frames);
+    sem_init(&frame_ready, 0, 0);
+    sem_init(&frame_taken, 0, 0);
+    sem_init(&export_wake, 0, 0);
+    motion_seen = atomic_load(&motion_events);
+
+    atomic_store(&running, true);
+    if (pthread_create(&export_thread, NULL, export_thread_func, NULL) != 0) {
+        atomic_store(&running, false);
+        sem_destroy(&frame_ready);
+        sem_destroy(&frame_taken);
+        sem_destroy(&export_wake);
+        return -1;
+    }
+    if (pthread_create(&analysis_thread, NULL, analysis_thread_func, NULL) != 0) {
+        atomic_store(&running, false);
+        sem_post(&export_wake);
+        pthread_join(export_thread, NULL);
+        sem_destroy(&frame_ready);
+        sem_destroy(&frame_taken);
+        sem_destroy(&export_wake);
+        return -1;
+    }
+    if (pthread_create(&capture_thread, NULL, capture_thread_func, NULL) != 0) {
+        atomic_store(&running, false);
+        sem_post(&frame_ready);
+        sem_post(&export_wake);
+        pthread_join(analysis_thread, NULL);
+        pthread_join(export_thread, NULL);
+        sem_destroy(&frame_ready);
+        sem_destroy(&frame_taken);
+        sem_destroy(&export_wake);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Stop the threads. Blocks for at most one fetch timeout, or until a
+ * running export has finished.
+ */
+void camera_stop(void) {
+    if (!atomic_load(&running)) return;
+    atomic_store(&running, false);
+    sem_post(&frame_ready);
+    sem_post(&export_wake);
+    pthread_join(capture_thread, NULL);
+    pthread_join(analysis_thread, NULL);
+    pthread_join(export_thread, NULL);
+    sem_destroy(&frame_ready);
+    sem_destroy(&frame_taken);
+    sem_destroy(&export_wake);
+}
+
+/**
+ * @brief File descriptor that becomes readable when motion is detected.
+ * * Lets an epoll loop sleep until there is a verdict to act on; call
+ * camera_poll_motion() when it fires. -1 if the eventfd could not be created.
+ */
+int camera_get_event_fd(void) {
+    return event_fd;
+}
+
+/**
+ * @brief Check for new motion verdicts without blocking.
+ * * @return true if motion was detected since the previous call.
+ */
+bool camera_poll_motion(void) {
+    // Clear the eventfd so a level-triggered epoll stops reporting it
+    uint64_t count;
+    if (event_fd >= 0 && read(event_fd, &count, sizeof(count)) < 0) {
+        // EAGAIN: nothing pending
+    }
+    unsigned int events = atomic_load(&motion_events);
+    bool motion = (events != motion_seen);
+    motion_seen = events;
+    return motion;
+}
+
+/**
+ * @brief Snapshot of the pipeline counters, with per-stage averages.
+ */
+void camera_get_stats(camera_stats_t* out) {
+    unsigned long captured = atomic_load(&stats.captured);
+    unsigned long analyzed = atomic_load(&stats.analyzed);
+    out->captured = captured;
+    out->analyzed = analyzed;
+    out->dropped = atomic_load(&stats.dropped);
+    out->fetch_failures = atomic_load(&stats.fetch_failures);
+    out->fetch_ms = captured ? atomic_load(&stats.fetch_ns) / 1e6 / captured : 0;
+    out->decode_ms = analyzed ? atomic_load(&stats.decode_ns) / 1e6 / analyzed : 0;
+    out->analyze_ms = analyzed ? atomic_load(&stats.analyze_ns) / 1e6 / analyzed : 0;
+    out->latency_ms = analyzed ? atomic_load(&stats.latency_ns) / 1e6 / analyzed : 0;
+
+    frame_pool_stats_t pool;
+    frame_pool_get_stats(&pool);
+    out->pool_failures = pool.failures;
+    out->warm_allocs = analyzed ? pipeline_allocs() - atomic_load(&stats.warm_allocs_base) : 0;
+}
+
+/**
+ * @brief Print pipeline statistics: frame rate since the previous call,
+ * drops, per-stage latencies, the HTTP connection counters and frame pool use.
+ */
+void camera_print_stats(void) {
+    static unsigned long prev_analyzed = 0;
+    static struct timespec prev_time = {0, 0};
+
+    camera_stats_t st;
+    camera_get_stats(&st);
+    double fps = 0;
+    if (prev_time.tv_sec != 0) {
+        double secs = elapsed_ns(&prev_time) / 1e9;
+        if (secs > 0) fps = (st.analyzed - prev_analyzed) / secs;
+    }
+    prev_analyzed = st.analyzed;
+    clock_gettime(CLOCK_MONOTONIC, &prev_time);
+
+    printf("[CAMERA] %s source, %s policy\n",
+           source == CAMERA_SOURCE_STREAM ? "stream" : "still",
+           atomic_load(&drop_policy) == CAMERA_DROP_NONE ? "no-drop" : "drop-stale");
+    printf("[CAMERA] %.1f fps, %lu captured, %lu analyzed, %lu dropped, %lu failed\n",
+           fps, st.captured, st.analyzed, st.dropped, st.fetch_failures);
+    char engine[16];
+    switch (atomic_load(&motion_engine)) {
+        case CAMERA_ENGINE_DC:    snprintf(engine, sizeof(engine), "dc"); break;
+        case CAMERA_ENGINE_DC_AC: snprintf(engine, sizeof(engine), "dc+ac"); break;
+        default:                  snprintf(engine, sizeof(engine), "1/%d", atomic_load(&scale_denom)); break;
+    }
+    printf("[CAMERA] avg fetch %.1f ms, decode %s %dx%d %.2f ms, analyze %.3f ms, capture-to-verdict %.1f ms\n",
+           st.fetch_ms, engine, atomic_load(&img_w), atomic_load(&img_h),
+           st.decode_ms, st.analyze_ms, st.latency_ms);
+
+    http_client_stats_t http;
+    http_client_get_stats(&http);
+    printf("[CAMERA] http: %lu connects, fetch last %.1f ms max %.1f ms\n",
+           http.connects, http.last_ms, http.max_ms);
+
+    frame_pool_stats_t pool;
+    frame_pool_get_stats(&pool);
+    printf("[CAMERA] pool: %zu/%zu KB in use (peak %zu KB, budget %zu KB), %lu borrows, %lu failed, "
+           "%lu heap allocs since warm-up\n",
+           pool.in_use / 1024, pool.arena_bytes / 1024, pool.peak_in_use / 1024, pool.budget / 1024,
+           pool.borrows, pool.failures, st.warm_allocs);
+
+    frame_ring_stats_t ring;
+    frame_ring_get_stats(&ring);
+    printf("[CAMERA] pre-event: %d frames / %.1f s in %zu/%zu KB, %lu evicted, %lu skipped, %lu exports\n",
+           ring.frames, ring.span_ms / 1000.0, ring.bytes / 1024, ring.capacity / 1024,
+           ring.evicted, ring.skipped, ring.exports);
 }
 
 /**
  * @brief Cleanup camera resources.
- * Frees the persistent background buffer used for motion detection.
+ * Stops the threads, returns the frame slots and the background models used
+ * for motion detection to the pool, releases the pool and the pre-event ring,
+ * and closes the camera connection.
  */
-void camera_cleanup(void) { if(bg_buffer) free(bg_buffer); }
\ No newline at end of file
+void camera_cleanup(void) {
+    camera_stop();
+    reset_background();
+    for (int i = 0; i < NUM_SLOTS; i++) {
+        frame_pool_put(slots[i].data);
+        memset(&slots[i], 0, sizeof(slots[i]));
+    }
+    if (pool_ready) frame_pool_cleanup();
+    pool_ready = false;
+    if (ring_ready) frame_ring_cleanup();
+    ring_ready = false;
+    http_client_cleanup();
+    if (event_fd >= 0) close(event_fd);
+    event_fd = -1;
+    if (export_fd >= 0) close(export_fd);
+    export_fd = -1;
+}
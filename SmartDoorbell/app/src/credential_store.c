@@ -0,0 +1,419 @@
+#define _GNU_SOURCE
+#include "credential_store.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <libgen.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/inotify.h>
+
+// File layout, native byte order: header, buckets, records.
+// A bucket holds the record index + 1 (0 = empty) and the top half of the
+// key's hash, so probing rarely touches a record that does not match.
+#define DB_MAGIC "DBC1"
+#define DB_SEED 0x9E3779B97F4A7C15ULL
+#define PATH_LEN 256
+
+typedef struct {
+    char magic[4];
+    uint32_t record_count;
+    uint32_t bucket_count;     // Power of two, more than record_count
+    uint32_t reserved;
+    uint64_t seed;
+} db_header_t;
+
+typedef struct {
+    uint32_t record;
+    uint32_t tag;
+} db_bucket_t;
+
+typedef struct {
+    uint8_t kind;
+    uint8_t key_len;
+    uint8_t reserved[6];
+    uint8_t key[CREDENTIAL_MAX_KEY]; // Zero-padded
+    int64_t valid_from;        // Unix seconds; 0 = no bound
+    int64_t valid_until;
+    char label[CREDENTIAL_MAX_LABEL];
+} db_record_t;
+
+typedef struct {
+    void* map;
+    size_t size;
+    const db_header_t* header;
+    const db_bucket_t* buckets;
+    const db_record_t* records;
+} db_t;
+
+static db_t* current = NULL;
+static char db_path[PATH_LEN];
+static char db_name[PATH_LEN];   // Last path component, as inotify reports it
+static int watch_fd = -1;
+static credential_stats_t stats;
+
+static uint64_t mix64(uint64_t x)
+{
+    x ^= x >> 33;
+    x *= 0xFF51AFD7ED558CCDULL;
+    x ^= x >> 33;
+    x *= 0xC4CEB9FE1A85EC53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
+static uint64_t key_hash(uint64_t seed, uint8_t kind, uint8_t len, const uint8_t key[CREDENTIAL_MAX_KEY])
+{
+    uint64_t a, b;
+    memcpy(&a, key, 8);
+    memcpy(&b, key + 8, 8);
+    return mix64(mix64(seed ^ a ^ ((uint64_t)kind << 8 | len)) ^ b);
+}
+
+// Every byte is compared whatever the first difference, so the time taken
+// says nothing about how close a presented key came
+static bool key_equal(const db_record_t* r, uint8_t kind, uint8_t len, const uint8_t key[CREDENTIAL_MAX_KEY])
+{
+    uint8_t diff = (uint8_t)((r->kind ^ kind) | (r->key_len ^ len));
+    for (int i = 0; i < CREDENTIAL_MAX_KEY; i++) diff |= r->key[i] ^ key[i];
+    return diff == 0;
+}
+
+static db_t* db_map(const char* path)
+{
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        perror(path);
+        return NULL;
+    }
+    struct stat st;
+    void* map = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(db_header_t)) {
+        map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+    if (map == MAP_FAILED) {
+        fprintf(stderr, "[CREDENTIALS] Cannot map %s\n", path);
+        return NULL;
+    }
+
+    size_t size = (size_t)st.st_size;
+    const db_header_t* h = map;
+    uint32_t n = h->record_count, buckets = h->bucket_count;
+    bool ok = memcmp(h->magic, DB_MAGIC, 4) == 0 && buckets > n && (buckets & (buckets - 1)) == 0 &&
+              size == sizeof(db_header_t) + (size_t)buckets * sizeof(db_bucket_t) + (size_t)n * sizeof(db_record_t);
+    db_t* db = ok ? malloc(sizeof(*db)) : NULL;
+    if (!db) {
+        fprintf(stderr, "[CREDENTIALS] %s is not a credential store\n", path);
+        munmap(map, size);
+        return NULL;
+    }
+    // Lookups go through random buckets
+    madvise(map, size, MADV_RANDOM);
+    db->map = map;
+    db->size = size;
+    db->header = h;
+    db->buckets = (const db_bucket_t*)(h + 1);
+    db->records = (const db_record_t*)(db->buckets + buckets);
+    return db;
+}
+
+static void db_unmap(db_t* db)
+{
+    if (!db) return;
+    munmap(db->map, db->size);
+    free(db);
+}
+
+int credential_store_open(const char* path)
+{
+    credential_store_close();
+    db_t* db = db_map(path);
+    if (!db) return -1;
+    current = db;
+    snprintf(db_path, sizeof(db_path), "%s", path);
+    stats.entries = db->header->record_count;
+
+    // The builder renames a new file over the old one, so watch the directory
+    char dir[PATH_LEN], name[PATH_LEN];
+    snprintf(dir, sizeof(dir), "%s", path);
+    snprintf(name, sizeof(name), "%s", path);
+    snprintf(db_name, sizeof(db_name), "%s", basename(name));
+    watch_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (watch_fd >= 0 && inotify_add_watch(watch_fd, dirname(dir), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+        perror("[CREDENTIALS] inotify_add_watch");
+        close(watch_fd);
+        watch_fd = -1;
+    }
+    printf("[CREDENTIALS] Loaded %lu credentials from %s\n", stats.entries, path);
+    return 0;
+}
+
+int credential_store_reload(void)
+{
+    if (!current) return -1;
+    db_t* db = db_map(db_path);
+    if (!db) {
+        stats.reload_failures++;
+        return -1;
+    }
+    db_t* old = current;
+    current = db;
+    db_unmap(old);
+    stats.entries = db->header->record_count;
+    stats.reloads++;
+    printf("[CREDENTIALS] Reloaded %lu credentials\n", stats.entries);
+    return 0;
+}
+
+int credential_store_get_watch_fd(void)
+{
+    return watch_fd;
+}
+
+void credential_store_handle_watch(void)
+{
+    char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    bool changed = false;
+    ssize_t n;
+    while ((n = read(watch_fd, buf, sizeof(buf))) > 0) {
+        for (char* p = buf; p < buf + n;) {
+            const struct inotify_event* ev = (const struct inotify_event*)p;
+            if (ev->len > 0 && strcmp(ev->name, db_name) == 0) changed = true;
+            p += sizeof(*ev) + ev->len;
+        }
+    }
+    if (changed) credential_store_reload();
+}
+
+credential_result_t credential_store_check(credential_kind_t kind, const uint8_t* key, int key_len,
+                                           time_t now, const char** label)
+{
+    stats.lookups++;
+    if (!current || key_len < 1 || key_len > CREDENTIAL_MAX_KEY) return CREDENTIAL_UNKNOWN;
+    uint8_t padded[CREDENTIAL_MAX_KEY] = {0};
+    memcpy(padded, key, (size_t)key_len);
+
+    const db_t* db = current;
+    uint32_t mask = db->header->bucket_count - 1;
+    uint64_t h = key_hash(db->header->seed, (uint8_t)kind, (uint8_t)key_len, padded);
+    uint32_t tag = (uint32_t)(h >> 32);
+    // Buckets always outnumber records, so an empty one ends the probe
+    for (uint32_t i = (uint32_t)h & mask, probes = 0; probes <= mask; i = (i + 1) & mask, probes++) {
+        const db_bucket_t* b = &db->buckets[i];
+        if (b->record == 0) break;
+        if (b->tag != tag || b->record > db->header->record_count) continue;
+        const db_record_t* r = &db->records[b->record - 1];
+        if (!key_equal(r, (uint8_t)kind, (uint8_t)key_len, padded)) continue;
+
+        if (label) *label = r->label;
+        if (r->valid_from != 0 && now < r->valid_from) return CREDENTIAL_NOT_YET_VALID;
+        if (r->valid_until != 0 && now >= r->valid_until) return CREDENTIAL_EXPIRED;
+        stats.granted++;
+        return CREDENTIAL_VALID;
+    }
+    return CREDENTIAL_UNKNOWN;
+}
+
+// ---------------------------------------------------------------------------
+// Offline builder
+// ---------------------------------------------------------------------------
+
+static int hex_digit(int c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    c = toupper(c);
+    return c >= 'A' && c <= 'F' ? c - 'A' + 10 : -1;
+}
+
+static int parse_key(db_record_t* r, const char* kind, const char* key)
+{
+    size_t len = strlen(key);
+    if (strcmp(kind, "rfid") == 0) {
+        if (len == 0 || len % 2 != 0 || len / 2 > CREDENTIAL_MAX_KEY) return -1;
+        r->kind = CREDENTIAL_RFID;
+        r->key_len = (uint8_t)(len / 2);
+        for (size_t i = 0; i < len / 2; i++) {
+            int hi = hex_digit(key[2 * i]), lo = hex_digit(key[2 * i + 1]);
+            if (hi < 0 || lo < 0) return -1;
+            r->key[i] = (uint8_t)(hi << 4 | lo);
+        }
+        return 0;
+    }
+    if (strcmp(kind, "pin") == 0) {
+        if (len == 0 || len > CREDENTIAL_MAX_KEY) return -1;
+        r->kind = CREDENTIAL_PIN;
+        r->key_len = (uint8_t)len;
+        for (size_t i = 0; i < len; i++) {
+            int c = toupper((unsigned char)key[i]);
+            if (!strchr("UDLR", c)) return -1;
+            r->key[i] = (uint8_t)c;
+        }
+        return 0;
+    }
+    return -1;
+}
+
+static int parse_time(const char* s, int64_t* out)
+{
+    if (strcmp(s, "-") == 0) {
+        *out = 0;
+        return 0;
+    }
+    char* end;
+    errno = 0;
+    long long v = strtoll(s, &end, 10);
+    if (errno != 0 || *end != '\0' || v <= 0) return -1;
+    *out = v;
+    return 0;
+}
+
+static int parse_line(db_record_t* r, char* line)
+{
+    char* save = NULL;
+    char* kind = strtok_r(line, " \t", &save);
+    char* key = strtok_r(NULL, " \t", &save);
+    char* from = strtok_r(NULL, " \t", &save);
+    char* until = strtok_r(NULL, " \t", &save);
+    char* label = strtok_r(NULL, "", &save);
+    memset(r, 0, sizeof(*r));
+    if (!kind || !key || !from || !until) return -1;
+    if (parse_key(r, kind, key) != 0) return -1;
+    if (parse_time(from, &r->valid_from) != 0 || parse_time(until, &r->valid_until) != 0) return -1;
+    if (label) {
+        label += strspn(label, " \t");
+        snprintf(r->label, sizeof(r->label), "%s", label);
+    }
+    return 0;
+}
+
+static int read_records(const char* text_path, db_record_t** out, uint32_t* count)
+{
+    FILE* f = fopen(text_path, "r");
+    if (!f) {
+        perror(text_path);
+        return -1;
+    }
+    db_record_t* records = NULL;
+    size_t n = 0, cap = 0;
+    char line[256];
+    int line_no = 0, ret = 0;
+    while (fgets(line, sizeof(line), f)) {
+        line_no++;
+        line[strcspn(line, "\r\n")] = '\0';
+        char* p = line + strspn(line, " \t");
+        if (*p == '\0' || *p == '#') continue;
+        if (n == cap) {
+            cap = cap ? cap * 2 : 1024;
+            db_record_t* grown = realloc(records, cap * sizeof(*records));
+            if (!grown) {
+                ret = -1;
+                break;
+            }
+            records = grown;
+        }
+        if (parse_line(&records[n], p) != 0) {
+            fprintf(stderr, "[CREDENTIALS] %s:%d: expected <rfid|pin> <key> <from|-> <until|-> [label]\n",
+                    text_path, line_no);
+            ret = -1;
+            break;
+        }
+        n++;
+    }
+    fclose(f);
+    if (ret == 0 && n >= UINT32_MAX / 4) ret = -1;
+    if (ret != 0) {
+        free(records);
+        return -1;
+    }
+    *out = records;
+    *count = (uint32_t)n;
+    return 0;
+}
+
+int credential_store_build(const char* text_path, const char* out_path)
+{
+    db_record_t* records;
+    uint32_t count;
+    if (read_records(text_path, &records, &count) != 0) return -1;
+
+    // At most half full: an unsuccessful lookup then probes about 2.5 buckets
+    uint32_t bucket_count = 8;
+    while (bucket_count < 2 * count) bucket_count <<= 1;
+    db_bucket_t* buckets = calloc(bucket_count, sizeof(*buckets));
+    if (!buckets) {
+        free(records);
+        return -1;
+    }
+    int ret = 0;
+    uint32_t mask = bucket_count - 1;
+    for (uint32_t r = 0; r < count && ret == 0; r++) {
+        const db_record_t* rec = &records[r];
+        uint64_t h = key_hash(DB_SEED, rec->kind, rec->key_len, rec->key);
+        uint32_t i = (uint32_t)h & mask;
+        for (; buckets[i].record != 0; i = (i + 1) & mask) {
+            const db_record_t* other = &records[buckets[i].record - 1];
+            if (key_equal(other, rec->kind, rec->key_len, rec->key)) {
+                fprintf(stderr, "[CREDENTIALS] %s: credential %u repeats credential %u\n",
+                        text_path, r + 1, buckets[i].record);
+                ret = -1;
+                break;
+            }
+        }
+        buckets[i].record = r + 1;
+        buckets[i].tag = (uint32_t)(h >> 32);
+    }
+
+    // Write beside the target and rename over it, so a running doorbell
+    // never maps a half-written file
+    char tmp_path[PATH_LEN + 8];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", out_path);
+    FILE* f = ret == 0 ? fopen(tmp_path, "wb") : NULL;
+    if (ret == 0 && !f) {
+        perror(tmp_path);
+        ret = -1;
+    }
+    if (f) {
+        db_header_t header = { .record_count = count, .bucket_count = bucket_count, .seed = DB_SEED };
+        memcpy(header.magic, DB_MAGIC, 4);
+        bool ok = fwrite(&header, sizeof(header), 1, f) == 1 &&
+                  fwrite(buckets, sizeof(*buckets), bucket_count, f) == bucket_count &&
+                  fwrite(records, sizeof(*records), count, f) == count &&
+                  fflush(f) == 0 && fsync(fileno(f)) == 0;
+        if (fclose(f) != 0) ok = false;
+        if (!ok || rename(tmp_path, out_path) != 0) {
+            perror(out_path);
+            unlink(tmp_path);
+            ret = -1;
+        }
+    }
+    if (ret == 0) printf("[CREDENTIALS] Wrote %u credentials to %s\n", count, out_path);
+    free(buckets);
+    free(records);
+    return ret;
+}
+
+void credential_store_get_stats(credential_stats_t* out)
+{
+    *out = stats;
+}
+
+void credential_store_print_stats(void)
+{
+    printf("[CREDENTIALS] %lu entries; %lu lookups, %lu granted; %lu reloads (%lu failed)\n",
+           stats.entries, stats.lookups, stats.granted, stats.reloads, stats.reload_failures);
+}
+
+void credential_store_close(void)
+{
+    db_unmap(current);
+    current = NULL;
+    if (watch_fd >= 0) close(watch_fd);
+    watch_fd = -1;
+    memset(&stats, 0, sizeof(stats));
+}
@@ -0,0 +1,221 @@
+/**
+ * @file fft_q15.c
+ * @brief Fixed-point radix-2 FFT for the vibration classifier.
+ * * Decimation in time: a bit-reversal permutation followed by log2(n)
+ * butterfly stages. Each butterfly multiplies by a Q15 twiddle with rounding
+ * and halves its sum and difference, which keeps the data in 16 bits.
+ * * The twiddles of each stage are stored contiguously (stage with half-size h
+ * at offset h), so the NEON version runs 8 butterflies per instruction on
+ * every stage with h >= 8 and shares the short first stages with the scalar
+ * code. It mirrors the scalar arithmetic exactly: vqrdmulh is the same
+ * rounding Q15 multiply and vhadd/vhsub the same flooring halve.
+ */
+
+#define _GNU_SOURCE
+#include "fft_q15.h"
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define HAVE_NEON_FFT 1
+#include <arm_neon.h>
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+
+#define MAX_POINTS (1 << FFT_Q15_MAX_LOG2)
+
+// exp(-i*pi*k/h) for stage half-size h at index h + k, k < h
+static int16_t tw_re[MAX_POINTS];
+static int16_t tw_im[MAX_POINTS];
+static pthread_once_t tables_once = PTHREAD_ONCE_INIT;
+
+static void build_tables(void) {
+    for (int h = 1; h < MAX_POINTS; h <<= 1) {
+        for (int k = 0; k < h; k++) {
+            double a = M_PI * k / h;
+            // 32767, not 32768: the rounding multiply saturates on -1 * -1
+            tw_re[h + k] = (int16_t)lrint(32767.0 * cos(a));
+            tw_im[h + k] = (int16_t)lrint(-32767.0 * sin(a));
+        }
+    }
+}
+
+static void bit_reverse(int16_t* re, int16_t* im, int log2n) {
+    int n = 1 << log2n;
+    for (int i = 1, j = 0; i < n; i++) {
+        int bit = n >> 1;
+        for (; j & bit; bit >>= 1) j ^= bit;
+        j |= bit;
+        if (i < j) {
+            int16_t t = re[i]; re[i] = re[j]; re[j] = t;
+            t = im[i]; im[i] = im[j]; im[j] = t;
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Scalar reference
+// ---------------------------------------------------------------------------
+
+// Rounding Q15 multiply; >> is an arithmetic shift on every compiler we build with
+static inline int32_t q15_mul(int32_t a, int32_t b) {
+    return (a * b + (1 << 14)) >> 15;
+}
+
+static void scalar_stage(int16_t* re, int16_t* im, int n, int h) {
+    for (int g = 0; g < n; g += 2 * h) {
+        for (int k = 0; k < h; k++) {
+            int a = g + k, b = a + h;
+            int32_t wr = tw_re[h + k], wi = tw_im[h + k];
+            int32_t tr = q15_mul(re[b], wr) - q15_mul(im[b], wi);
+            int32_t ti = q15_mul(re[b], wi) + q15_mul(im[b], wr);
+            int32_t ar = re[a], ai = im[a];
+            re[a] = (int16_t)((ar + tr) >> 1);
+            im[a] = (int16_t)((ai + ti) >> 1);
+            re[b] = (int16_t)((ar - tr) >> 1);
+            im[b] = (int16_t)((ai - ti) >> 1);
+        }
+    }
+}
+
+static void scalar_fft(int16_t* re, int16_t* im, int log2n) {
+    pthread_once(&tables_once, build_tables);
+    bit_reverse(re, im, log2n);
+    int n = 1 << log2n;
+    for (int h = 1; h < n; h <<= 1) scalar_stage(re, im, n, h);
+}
+
+static const fft_q15_t scalar_impl = { "scalar", scalar_fft };
+
+// ---------------------------------------------------------------------------
+// ARM NEON (8 butterflies)
+// ---------------------------------------------------------------------------
+
+#ifdef HAVE_NEON_FFT
+
+static void neon_stage(int16_t* re, int16_t* im, int n, int h) {
+    for (int g = 0; g < n; g += 2 * h) {
+        for (int k = 0; k < h; k += 8) {
+            int16_t* ar = re + g + k;
+            int16_t* ai = im + g + k;
+            int16x8_t wr = vld1q_s16(tw_re + h + k);
+            int16x8_t wi = vld1q_s16(tw_im + h + k);
+            int16x8_t br = vld1q_s16(ar + h);
+            int16x8_t bi = vld1q_s16(ai + h);
+            int16x8_t tr = vsubq_s16(vqrdmulhq_s16(br, wr), vqrdmulhq_s16(bi, wi));
+            int16x8_t ti = vaddq_s16(vqrdmulhq_s16(br, wi), vqrdmulhq_s16(bi, wr));
+            int16x8_t xr = vld1q_s16(ar);
+            int16x8_t xi = vld1q_s16(ai);
+            vst1q_s16(ar, vhaddq_s16(xr, tr));
+            vst1q_s16(ai, vhaddq_s16(xi, ti));
+            vst1q_s16(ar + h, vhsubq_s16(xr, tr));
+            vst1q_s16(ai + h, vhsubq_s16(xi, ti));
+        }
+    }
+}
+
+static void neon_fft(int16_t* re, int16_t* im, int log2n) {
+    pthread_once(&tables_once, build_tables);
+    bit_reverse(re, im, log2n);
+    int n = 1 << log2n;
+    for (int h = 1; h < n; h <<= 1) {
+        if (h < 8) scalar_stage(re, im, n, h);
+        else neon_stage(re, im, n, h);
+    }
+}
+
+static const fft_q15_t neon_impl = { "neon", neon_fft };
+
+static bool neon_supported(void) {
+#if defined(__aarch64__)
+    return (getauxval(AT_HWCAP) & HWCAP_ASIMD) != 0;
+#else
+    return (getauxval(AT_HWCAP) & HWCAP_NEON) != 0;
+#endif
+}
+
+#endif // HAVE_NEON_FFT
+
+// ---------------------------------------------------------------------------
+// Runtime dispatch
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    const fft_q15_t* impl;
+    bool (*supported)(void);
+} candidate_t;
+
+// Preferred first
+static const candidate_t candidates[] = {
+#ifdef HAVE_NEON_FFT
+    { &neon_impl, neon_supported },
+#endif
+    { &scalar_impl, NULL },
+};
+#define NUM_CANDIDATES (sizeof(candidates) / sizeof(candidates[0]))
+
+static const fft_q15_t* selected = &scalar_impl;
+static pthread_once_t select_once = PTHREAD_ONCE_INIT;
+
+static void select_impl(void) {
+    for (size_t i = 0; i < NUM_CANDIDATES; i++) {
+        const candidate_t* c = &candidates[i];
+        if (c->supported && !c->supported()) continue;
+        if (c->impl != &scalar_impl && fft_q15_verify(c->impl) != 0) continue;
+        selected = c->impl;
+        return;
+    }
+}
+
+const fft_q15_t* fft_q15_get(void) {
+    pthread_once(&select_once, select_impl);
+    return selected;
+}
+
+const fft_q15_t* fft_q15_scalar(void) {
+    return &scalar_impl;
+}
+
+int fft_q15_list(const fft_q15_t** out, int max) {
+    int count = 0;
+    if (count < max) out[count++] = &scalar_impl;
+    for (size_t i = 0; i < NUM_CANDIDATES && count < max; i++) {
+        const candidate_t* c = &candidates[i];
+        if (c->impl == &scalar_impl) continue;
+        if (c->supported && !c->supported()) continue;
+        out[count++] = c->impl;
+    }
+    return count;
+}
+
+// ---------------------------------------------------------------------------
+// Self-test against the scalar reference
+// ---------------------------------------------------------------------------
+
+int fft_q15_verify(const fft_q15_t* f) {
+    static int16_t ref_re[MAX_POINTS], ref_im[MAX_POINTS];
+    static int16_t test_re[MAX_POINTS], test_im[MAX_POINTS];
+
+    uint32_t seed = 0x2545F491u;
+    for (int log2n = 1; log2n <= FFT_Q15_MAX_LOG2; log2n++) {
+        int n = 1 << log2n;
+        // Full-scale noise, plus an impulse at the input limit
+        for (int i = 0; i < n; i++) {
+            seed = seed * 1664525u + 1013904223u;
+            ref_re[i] = (int16_t)((int32_t)(seed >> 16) % 32769 - 16384);
+            ref_im[i] = (int16_t)((int32_t)(seed >> 8 & 0xFFFF) % 32769 - 16384);
+        }
+        ref_re[n / 2] = -16384;
+        memcpy(test_re, ref_re, n * sizeof(int16_t));
+        memcpy(test_im, ref_im, n * sizeof(int16_t));
+
+        scalar_fft(ref_re, ref_im, log2n);
+        f->fft(test_re, test_im, log2n);
+        if (memcmp(ref_re, test_re, n * sizeof(int16_t)) != 0 ||
+            memcmp(ref_im, test_im, n * sizeof(int16_t)) != 0) return -1;
+    }
+    return 0;
+}
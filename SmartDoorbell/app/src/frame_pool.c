@@ -0,0 +1,123 @@
+#include "frame_pool.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#define MAX_CLASSES 8
+#define MAX_BLOCKS_PER_CLASS 16
+#define BLOCK_ALIGN 64 // Cache line; also satisfies the SIMD motion kernels
+
+typedef struct {
+    size_t size;
+    int count;
+    unsigned char* base;                 // First block of this class in the arena
+    int free_list[MAX_BLOCKS_PER_CLASS]; // Stack of free block indices
+    int free_count;
+} pool_class_t;
+
+static pool_class_t classes[MAX_CLASSES];
+static int num_classes = 0;
+static unsigned char* arena = NULL;
+static frame_pool_stats_t stats;
+static pthread_mutex_t pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+int frame_pool_init(const frame_pool_class_t* config, int n, size_t budget)
+{
+    if (arena || n <= 0 || n > MAX_CLASSES) return -1;
+
+    size_t total = 0;
+    for (int i = 0; i < n; i++) {
+        if (config[i].count <= 0 || config[i].count > MAX_BLOCKS_PER_CLASS) return -1;
+        if (i > 0 && config[i].size <= config[i - 1].size) return -1;
+        size_t size = (config[i].size + BLOCK_ALIGN - 1) & ~(size_t)(BLOCK_ALIGN - 1);
+        total += size * config[i].count;
+    }
+    if (total > budget) {
+        fprintf(stderr, "[POOL] Classes need %zu KB, budget is %zu KB\n", total / 1024, budget / 1024);
+        return -1;
+    }
+
+    void* mem;
+    if (posix_memalign(&mem, BLOCK_ALIGN, total) != 0) {
+        perror("Error allocating frame pool");
+        return -1;
+    }
+    // Touch every page now so frames never take a page fault on first use
+    memset(mem, 0, total);
+
+    pthread_mutex_lock(&pool_mutex);
+    arena = mem;
+    memset(&stats, 0, sizeof(stats));
+    stats.budget = budget;
+    stats.arena_bytes = total;
+    stats.heap_allocs = 1;
+
+    unsigned char* p = arena;
+    for (int i = 0; i < n; i++) {
+        pool_class_t* c = &classes[i];
+        c->size = (config[i].size + BLOCK_ALIGN - 1) & ~(size_t)(BLOCK_ALIGN - 1);
+        c->count = config[i].count;
+        c->base = p;
+        c->free_count = c->count;
+        for (int b = 0; b < c->count; b++) c->free_list[b] = c->count - 1 - b;
+        p += c->size * c->count;
+    }
+    num_classes = n;
+    pthread_mutex_unlock(&pool_mutex);
+    return 0;
+}
+
+void* frame_pool_get(size_t size, size_t* cap)
+{
+    void* block = NULL;
+    pthread_mutex_lock(&pool_mutex);
+    for (int i = 0; i < num_classes; i++) {
+        pool_class_t* c = &classes[i];
+        if (c->size < size || c->free_count == 0) continue;
+        int index = c->free_list[--c->free_count];
+        block = c->base + (size_t)index * c->size;
+        if (cap) *cap = c->size;
+        stats.borrows++;
+        stats.in_use += c->size;
+        if (stats.in_use > stats.peak_in_use) stats.peak_in_use = stats.in_use;
+        break;
+    }
+    if (!block) stats.failures++;
+    pthread_mutex_unlock(&pool_mutex);
+    return block;
+}
+
+void frame_pool_put(void* block)
+{
+    if (!block) return;
+    unsigned char* p = block;
+    pthread_mutex_lock(&pool_mutex);
+    for (int i = 0; i < num_classes; i++) {
+        pool_class_t* c = &classes[i];
+        if (p < c->base || p >= c->base + c->size * c->count) continue;
+        c->free_list[c->free_count++] = (int)((size_t)(p - c->base) / c->size);
+        stats.in_use -= c->size;
+        break;
+    }
+    pthread_mutex_unlock(&pool_mutex);
+}
+
+void frame_pool_get_stats(frame_pool_stats_t* out)
+{
+    pthread_mutex_lock(&pool_mutex);
+    *out = stats;
+    pthread_mutex_unlock(&pool_mutex);
+}
+
+void frame_pool_cleanup(void)
+{
+    pthread_mutex_lock(&pool_mutex);
+    if (stats.in_use != 0) {
+        fprintf(stderr, "[POOL] %zu bytes still borrowed at cleanup\n", stats.in_use);
+    }
+    free(arena);
+    arena = NULL;
+    num_classes = 0;
+    pthread_mutex_unlock(&pool_mutex);
+}
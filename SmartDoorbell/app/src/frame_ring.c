@@ -0,0 +1,215 @@
+#include "frame_ring.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <pthread.h>
+
+#define MAX_RECORDS 512 // Frame headers; 20 s at 25 fps
+#define PATH_LEN 256
+
+// One buffered frame
+typedef struct {
+    size_t offset;       // Start of the JPEG in `ring`
+    size_t len;
+    long long mono_ms;   // CLOCK_MONOTONIC, for the export window
+    long long wall_ms;   // CLOCK_REALTIME, written to index.txt
+} ring_record_t;
+
+static unsigned char* ring = NULL;
+static size_t capacity = 0;
+static size_t write_pos = 0;
+
+// FIFO of records, oldest at `head`
+static ring_record_t records[MAX_RECORDS];
+static int head = 0, count = 0;
+
+static int window = 0;
+static bool frozen = false;
+static frame_ring_stats_t stats;
+static pthread_mutex_t ring_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+// Export works from this copy so the ring lock is not held during file I/O
+static ring_record_t export_list[MAX_RECORDS];
+
+static long long clock_ms(clockid_t clock)
+{
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return ts.tv_sec * 1000LL + ts.tv_nsec / 1000000LL;
+}
+
+static void evict_oldest(void)
+{
+    stats.bytes -= records[head].len;
+    head = (head + 1) % MAX_RECORDS;
+    count--;
+    stats.evicted++;
+}
+
+int frame_ring_init(size_t bytes, int window_ms)
+{
+    if (ring || bytes == 0 || window_ms <= 0) return -1;
+    unsigned char* mem = malloc(bytes);
+    if (!mem) {
+        perror("Error allocating frame ring");
+        return -1;
+    }
+    // Fault every page in now rather than on the capture thread
+    memset(mem, 0, bytes);
+
+    pthread_mutex_lock(&ring_mutex);
+    ring = mem;
+    capacity = bytes;
+    window = window_ms;
+    write_pos = 0;
+    head = count = 0;
+    frozen = false;
+    memset(&stats, 0, sizeof(stats));
+    stats.capacity = bytes;
+    pthread_mutex_unlock(&ring_mutex);
+    return 0;
+}
+
+void frame_ring_push(const unsigned char* jpg, size_t len)
+{
+    pthread_mutex_lock(&ring_mutex);
+    if (!ring || frozen || len == 0 || len > capacity) {
+        stats.skipped++;
+        pthread_mutex_unlock(&ring_mutex);
+        return;
+    }
+
+    // Frames are stored contiguously. If this one does not fit before the end,
+    // the tail is abandoned: the frames stored there are the oldest, so they go.
+    if (len > capacity - write_pos) {
+        while (count > 0 && records[head].offset >= write_pos) evict_oldest();
+        write_pos = 0;
+    }
+    // Evict the oldest frames the new one overlaps (they lie just ahead of write_pos)
+    while (count > 0 && records[head].offset >= write_pos && records[head].offset < write_pos + len) {
+        evict_oldest();
+    }
+    if (count == MAX_RECORDS) evict_oldest();
+
+    memcpy(ring + write_pos, jpg, len);
+    ring_record_t* r = &records[(head + count) % MAX_RECORDS];
+    r->offset = write_pos;
+    r->len = len;
+    r->mono_ms = clock_ms(CLOCK_MONOTONIC);
+    r->wall_ms = clock_ms(CLOCK_REALTIME);
+    count++;
+    write_pos += len;
+    stats.bytes += len;
+    stats.pushed++;
+    pthread_mutex_unlock(&ring_mutex);
+}
+
+static int write_file(const char* path, const unsigned char* data, size_t len)
+{
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) return -1;
+    size_t done = 0;
+    while (done < len) {
+        ssize_t n = write(fd, data + done, len - done);
+        if (n <= 0) break;
+        done += n;
+    }
+    close(fd);
+    return done == len ? 0 : -1;
+}
+
+// A failed export must not leave an older index behind for server.js to
+// attach to the new alert
+static int export_failed(const char* dir)
+{
+    char path[PATH_LEN];
+    snprintf(path, sizeof(path), "%s/index.txt", dir);
+    unlink(path);
+    fprintf(stderr, "[RING] Export to %s failed\n", dir);
+    return -1;
+}
+
+int frame_ring_export(const char* dir)
+{
+    if (mkdir(dir, 0755) != 0 && access(dir, W_OK) != 0) {
+        perror("Error creating pre-event directory");
+        return export_failed(dir);
+    }
+
+    // Freeze: until thawed, pushes are skipped, so the listed bytes stay put
+    long long now = clock_ms(CLOCK_MONOTONIC);
+    int n = 0;
+    pthread_mutex_lock(&ring_mutex);
+    if (!ring || frozen) {
+        pthread_mutex_unlock(&ring_mutex);
+        return export_failed(dir);
+    }
+    frozen = true;
+    for (int i = 0; i < count; i++) {
+        const ring_record_t* r = &records[(head + i) % MAX_RECORDS];
+        if (now - r->mono_ms <= window) export_list[n++] = *r;
+    }
+    pthread_mutex_unlock(&ring_mutex);
+
+    char path[PATH_LEN], tmp[PATH_LEN];
+    snprintf(tmp, sizeof(tmp), "%s/index.txt.tmp", dir);
+    FILE* index = fopen(tmp, "w");
+    int written = index ? 0 : -1;
+    for (int i = 0; index && i < n; i++) {
+        const ring_record_t* r = &export_list[i];
+        snprintf(path, sizeof(path), "%s/frame_%03d.jpg", dir, i);
+        if (write_file(path, ring + r->offset, r->len) != 0) {
+            written = -1;
+            break;
+        }
+        fprintf(index, "frame_%03d.jpg %lld %lld\n", i, r->wall_ms, now - r->mono_ms);
+        written++;
+    }
+
+    pthread_mutex_lock(&ring_mutex);
+    frozen = false;
+    pthread_mutex_unlock(&ring_mutex);
+
+    if (index) {
+        if (fclose(index) != 0) written = -1;
+        snprintf(path, sizeof(path), "%s/index.txt", dir);
+        if (written >= 0 && rename(tmp, path) != 0) written = -1;
+        if (written < 0) unlink(tmp);
+    }
+    if (written < 0) return export_failed(dir);
+
+    // Remove frames left over from a longer previous export
+    for (int i = n; ; i++) {
+        snprintf(path, sizeof(path), "%s/frame_%03d.jpg", dir, i);
+        if (unlink(path) != 0) break;
+    }
+
+    pthread_mutex_lock(&ring_mutex);
+    stats.exports++;
+    pthread_mutex_unlock(&ring_mutex);
+    return written;
+}
+
+void frame_ring_get_stats(frame_ring_stats_t* out)
+{
+    pthread_mutex_lock(&ring_mutex);
+    *out = stats;
+    out->frames = count;
+    out->span_ms = count > 1 ? records[(head + count - 1) % MAX_RECORDS].mono_ms - records[head].mono_ms : 0;
+    pthread_mutex_unlock(&ring_mutex);
+}
+
+void frame_ring_cleanup(void)
+{
+    pthread_mutex_lock(&ring_mutex);
+    free(ring);
+    ring = NULL;
+    capacity = 0;
+    count = 0;
+    pthread_mutex_unlock(&ring_mutex);
+}
@@ -0,0 +1,509 @@
+#define _GNU_SOURCE
+#include "http_client.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+#define RX_BUF_SIZE    4096
+#define LINE_MAX_LEN   512
+#define BODY_INIT_SIZE (64 * 1024)
+#define BODY_MAX_SIZE  (4 * 1024 * 1024) // Refuse anything bigger than a UXGA JPEG could be
+
+static struct sockaddr_storage server_addr;
+static socklen_t server_addr_len = 0;
+static char host_name[64];
+static int timeout = 1000;
+static int sockfd = -1;
+
+// Buffered reader over the socket (headers are parsed line by line)
+static unsigned char rx_buf[RX_BUF_SIZE];
+static size_t rx_start = 0, rx_end = 0;
+static bool rx_closed = false; // The last refill hit EOF or a reset (not a timeout)
+
+// Chunked transfer decoding state (the ESP32 streams with httpd_resp_send_chunk)
+static bool chunked = false;
+static size_t chunk_left = 0;  // Bytes remaining in the current chunk
+static bool chunk_eof = false; // Saw the terminating zero-length chunk
+
+// Reusable body buffer: grows to the largest frame seen, never shrinks
+static unsigned char* body_buf = NULL;
+static size_t body_cap = 0;
+
+// Stats are read from other threads (camera_print_stats), so guard them
+static http_client_stats_t stats;
+static pthread_mutex_t stats_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static double elapsed_ms(const struct timespec* start)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) * 1000.0 + (now.tv_nsec - start->tv_nsec) / 1e6;
+}
+
+static void close_connection(void)
+{
+    if (sockfd >= 0) close(sockfd);
+    sockfd = -1;
+    rx_start = rx_end = 0;
+    chunked = false;
+    chunk_left = 0;
+    chunk_eof = false;
+}
+
+// Non-blocking connect bounded by `timeout`, then switch back to blocking I/O
+// with send/receive timeouts so a stalled camera can never hang the caller.
+static int open_connection(void)
+{
+    int fd = socket(server_addr.ss_family, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        perror("[HTTP] socket");
+        return -1;
+    }
+
+    int flags = fcntl(fd, F_GETFL, 0);
+    fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+    if (connect(fd, (struct sockaddr*)&server_addr, server_addr_len) < 0) {
+        if (errno != EINPROGRESS) {
+            close(fd);
+            return -1;
+        }
+        struct pollfd pfd = { .fd = fd, .events = POLLOUT };
+        int err = 0;
+        socklen_t err_len = sizeof(err);
+        if (poll(&pfd, 1, timeout) <= 0 ||
+            getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &err_len) < 0 || err != 0) {
+            close(fd);
+            return -1;
+        }
+    }
+    fcntl(fd, F_SETFL, flags);
+
+    struct timeval tv = { .tv_sec = timeout / 1000, .tv_usec = (timeout % 1000) * 1000 };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    sockfd = fd;
+    rx_start = rx_end = 0;
+    pthread_mutex_lock(&stats_mutex);
+    stats.connects++;
+    pthread_mutex_unlock(&stats_mutex);
+    return 0;
+}
+
+static int send_all(const char* data, size_t len)
+{
+    while (len > 0) {
+        ssize_t n = send(sockfd, data, len, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return -1;
+        data += n;
+        len -= n;
+    }
+    return 0;
+}
+
+// Refill rx_buf from the socket. Returns bytes read, 0 on EOF, -1 on error/timeout.
+static ssize_t fill_rx(void)
+{
+    rx_start = rx_end = 0;
+    ssize_t n;
+    do {
+        n = recv(sockfd, rx_buf, sizeof(rx_buf), 0);
+    } while (n < 0 && errno == EINTR);
+    if (n > 0) rx_end = n;
+    rx_closed = n == 0 || (n < 0 && errno == ECONNRESET);
+    return n;
+}
+
+// Read one CRLF-terminated line (terminator stripped). Returns length or -1.
+static int read_line(char* line, size_t max)
+{
+    size_t len = 0;
+    for (;;) {
+        if (rx_start == rx_end && fill_rx() <= 0) return -1;
+        unsigned char c = rx_buf[rx_start++];
+        if (c == '\n') break;
+        if (len + 1 >= max) return -1;
+        line[len++] = (char)c;
+    }
+    if (len > 0 && line[len - 1] == '\r') len--;
+    line[len] = '\0';
+    return (int)len;
+}
+
+// Copy exactly `len` bytes into dst: drain buffered bytes first, then recv()
+// straight into the destination so the JPEG payload is never copied twice.
+static int read_exact(unsigned char* dst, size_t len)
+{
+    size_t buffered = rx_end - rx_start;
+    size_t n = buffered < len ? buffered : len;
+    memcpy(dst, rx_buf + rx_start, n);
+    rx_start += n;
+    dst += n;
+    len -= n;
+
+    while (len > 0) {
+        ssize_t r = recv(sockfd, dst, len, 0);
+        if (r < 0 && errno == EINTR) continue;
+        if (r <= 0) return -1;
+        dst += r;
+        len -= r;
+    }
+    return 0;
+}
+
+// Start the next chunk: "<hex size>[;ext]\r\n". The CRLF that ends the previous
+// chunk's data shows up here as an empty line and is skipped.
+static int next_chunk(void)
+{
+    char line[64];
+    int l;
+    do {
+        l = read_line(line, sizeof(line));
+        if (l < 0) return -1;
+    } while (l == 0);
+
+    char* end;
+    unsigned long size = strtoul(line, &end, 16);
+    if (end == line) return -1;
+    if (size == 0) {
+        chunk_eof = true;
+        return -1;
+    }
+    chunk_left = size;
+    return 0;
+}
+
+// Read `len` body bytes, de-chunking if needed
+static int body_read(unsigned char* dst, size_t len)
+{
+    if (!chunked) return read_exact(dst, len);
+    while (len > 0) {
+        if (chunk_left == 0 && next_chunk() != 0) return -1;
+        size_t n = len < chunk_left ? len : chunk_left;
+        if (read_exact(dst, n) != 0) return -1;
+        chunk_left -= n;
+        dst += n;
+        len -= n;
+    }
+    return 0;
+}
+
+// Read one CRLF-terminated line from the (possibly chunked) body
+static int body_read_line(char* line, size_t max)
+{
+    if (!chunked) return read_line(line, max);
+    size_t len = 0;
+    for (;;) {
+        unsigned char c;
+        if (body_read(&c, 1) != 0) return -1;
+        if (c == '\n') break;
+        if (len + 1 >= max) return -1;
+        line[len++] = (char)c;
+    }
+    if (len > 0 && line[len - 1] == '\r') len--;
+    line[len] = '\0';
+    return (int)len;
+}
+
+static int reserve_body(size_t len)
+{
+    if (len <= body_cap) return 0;
+    size_t cap = body_cap ? body_cap : BODY_INIT_SIZE;
+    while (cap < len) cap *= 2;
+    unsigned char* buf = realloc(body_buf, cap);
+    if (!buf) return -1;
+    body_buf = buf;
+    body_cap = cap;
+    pthread_mutex_lock(&stats_mutex);
+    stats.allocs++;
+    pthread_mutex_unlock(&stats_mutex);
+    return 0;
+}
+
+// Read until the server closes the connection (responses without Content-Length)
+static int read_until_close(size_t* len)
+{
+    size_t total = 0;
+    for (;;) {
+        if (reserve_body(total + RX_BUF_SIZE) != 0) return -1;
+        size_t buffered = rx_end - rx_start;
+        if (buffered > 0) {
+            memcpy(body_buf + total, rx_buf + rx_start, buffered);
+            total += buffered;
+            rx_start = rx_end;
+        }
+        if (total > BODY_MAX_SIZE) return -1;
+        ssize_t n = fill_rx();
+        if (n == 0) break;
+        if (n < 0) return -1;
+    }
+    *len = total;
+    return 0;
+}
+
+// Read a chunked body to its terminating chunk
+static int read_chunked_body(size_t* len)
+{
+    size_t total = 0;
+    while (next_chunk() == 0) {
+        if (total + chunk_left > BODY_MAX_SIZE || reserve_body(total + chunk_left) != 0) return -1;
+        size_t n = chunk_left;
+        if (body_read(body_buf + total, n) != 0) return -1;
+        total += n;
+    }
+    if (!chunk_eof) return -1;
+    // Trailer section ends with an empty line
+    char line[LINE_MAX_LEN];
+    int l;
+    do {
+        l = read_line(line, sizeof(line));
+        if (l < 0) return -1;
+    } while (l > 0);
+    *len = total;
+    return 0;
+}
+
+// Send a GET and parse the status line and headers.
+// `*stale` is set when the peer closed or reset the connection before any
+// response byte arrived, which is how an idle keep-alive connection closed by
+// the server looks. A timeout is not stale: the server is just slow.
+static int send_request(const char* path, long* content_length, bool* keep_alive, bool* stale)
+{
+    char line[LINE_MAX_LEN];
+    int n = snprintf(line, sizeof(line),
+                     "GET %s HTTP/1.1\r\nHost: %s\r\nConnection: keep-alive\r\n\r\n",
+                     path, host_name);
+    if (n < 0 || (size_t)n >= sizeof(line)) return -1;
+
+    *stale = false;
+    if (send_all(line, n) != 0) {
+        *stale = errno == EPIPE || errno == ECONNRESET;
+        return -1;
+    }
+
+    // Status line: "HTTP/1.1 200 OK"
+    rx_closed = false;
+    if (read_line(line, sizeof(line)) < 0) {
+        *stale = rx_closed;
+        return -1;
+    }
+    int status = 0;
+    if (sscanf(line, "HTTP/1.%*d %d", &status) != 1 || status != 200) {
+        fprintf(stderr, "[HTTP] Unexpected response: %s\n", line);
+        return -1;
+    }
+
+    // Headers
+    *content_length = -1;
+    *keep_alive = true;
+    chunked = false;
+    chunk_left = 0;
+    chunk_eof = false;
+    for (;;) {
+        int l = read_line(line, sizeof(line));
+        if (l < 0) return -1;
+        if (l == 0) break;
+        if (strncasecmp(line, "Content-Length:", 15) == 0) {
+            *content_length = strtol(line + 15, NULL, 10);
+        } else if (strncasecmp(line, "Connection:", 11) == 0 && strcasestr(line + 11, "close")) {
+            *keep_alive = false;
+        } else if (strncasecmp(line, "Transfer-Encoding:", 18) == 0) {
+            if (!strcasestr(line + 18, "chunked")) {
+                fprintf(stderr, "[HTTP] Unsupported transfer encoding\n");
+                return -1;
+            }
+            chunked = true;
+        }
+    }
+    return 0;
+}
+
+// Send one request and read the response. Returns 0 on success, -1 on failure.
+static int do_get(const char* path, size_t* len, bool* stale)
+{
+    long content_length;
+    bool keep_alive;
+    if (send_request(path, &content_length, &keep_alive, stale) != 0) return -1;
+
+    // Body
+    if (chunked) {
+        if (read_chunked_body(len) != 0) return -1;
+    } else if (content_length >= 0) {
+        if (content_length > BODY_MAX_SIZE || reserve_body(content_length) != 0) return -1;
+        if (content_length > 0 && read_exact(body_buf, content_length) != 0) return -1;
+        *len = content_length;
+    } else {
+        keep_alive = false;
+        if (read_until_close(len) != 0) return -1;
+    }
+
+    if (!keep_alive) close_connection();
+    return 0;
+}
+
+static void record_fetch(bool ok, const struct timespec* start)
+{
+    pthread_mutex_lock(&stats_mutex);
+    if (!ok) {
+        stats.failures++;
+    } else {
+        double ms = elapsed_ms(start);
+        stats.fetches++;
+        stats.last_ms = ms;
+        stats.avg_ms += (ms - stats.avg_ms) / stats.fetches;
+        if (ms > stats.max_ms) stats.max_ms = ms;
+    }
+    pthread_mutex_unlock(&stats_mutex);
+}
+
+int http_client_init(const char* host, int port, int timeout_ms)
+{
+    close_connection();
+    pthread_mutex_lock(&stats_mutex);
+    memset(&stats, 0, sizeof(stats));
+    pthread_mutex_unlock(&stats_mutex);
+
+    char port_str[8];
+    snprintf(port_str, sizeof(port_str), "%d", port);
+    struct addrinfo hints = { .ai_family = AF_UNSPEC, .ai_socktype = SOCK_STREAM };
+    struct addrinfo* res = NULL;
+    if (getaddrinfo(host, port_str, &hints, &res) != 0 || !res) {
+        fprintf(stderr, "[HTTP] Cannot resolve %s\n", host);
+        return -1;
+    }
+    memcpy(&server_addr, res->ai_addr, res->ai_addrlen);
+    server_addr_len = res->ai_addrlen;
+    freeaddrinfo(res);
+
+    snprintf(host_name, sizeof(host_name), "%s", host);
+    timeout = timeout_ms;
+    return 0;
+}
+
+int http_client_get(const char* path, const unsigned char** body, size_t* len)
+{
+    if (server_addr_len == 0) return -1;
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    // Reuse the open connection. If the server dropped it while idle, retry
+    // once on a fresh connection before counting a failure. A timeout is not
+    // retried, so a slow server does not cost two timeouts per fetch.
+    bool was_open = (sockfd >= 0);
+    int ret = -1;
+    for (int attempt = 0; attempt < 2 && ret != 0; attempt++) {
+        if (sockfd < 0 && open_connection() != 0) break;
+        bool stale = false;
+        ret = do_get(path, len, &stale);
+        if (ret != 0) {
+            close_connection();
+            if (!(stale && was_open)) break;
+            was_open = false;
+        }
+    }
+
+    record_fetch(ret == 0, &start);
+    if (ret != 0) return -1;
+    *body = body_buf;
+    return 0;
+}
+
+int http_client_stream_open(const char* path)
+{
+    if (server_addr_len == 0) return -1;
+    close_connection();
+    if (open_connection() != 0) return -1;
+
+    long content_length;
+    bool keep_alive, stale;
+    if (send_request(path, &content_length, &keep_alive, &stale) != 0) {
+        close_connection();
+        return -1;
+    }
+    return 0;
+}
+
+// Multipart body as sent by WebStream::stream_handler:
+//   Content-Type: image/jpeg\r\nContent-Length: N\r\n\r\n<N bytes>\r\n--frame\r\n
+// Boundary lines and blank separators are skipped; a part ends at the blank
+// line after its headers, and its size comes from Content-Length, so the
+// JPEG bytes themselves are never scanned.
+int http_client_stream_next(const unsigned char** body, size_t* len)
+{
+    if (sockfd < 0) return -1;
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    char line[LINE_MAX_LEN];
+    long part_len = -1;
+    bool in_headers = false;
+    int ret = -1;
+    for (;;) {
+        int l = body_read_line(line, sizeof(line));
+        if (l < 0) break;
+        if (l == 0) {
+            if (in_headers && part_len >= 0) {
+                ret = 0;
+                break;
+            }
+            continue;
+        }
+        if (line[0] == '-' && line[1] == '-') {
+            in_headers = false; // Boundary: a new part follows
+            part_len = -1;
+            continue;
+        }
+        in_headers = true;
+        if (strncasecmp(line, "Content-Length:", 15) == 0) {
+            part_len = strtol(line + 15, NULL, 10);
+        }
+    }
+
+    if (ret == 0) {
+        if ((size_t)part_len > BODY_MAX_SIZE || reserve_body(part_len) != 0 ||
+            (part_len > 0 && body_read(body_buf, part_len) != 0)) {
+            ret = -1;
+        }
+    }
+    if (ret != 0) close_connection();
+
+    record_fetch(ret == 0, &start);
+    if (ret != 0) return -1;
+    *body = body_buf;
+    *len = part_len;
+    return 0;
+}
+
+void http_client_get_stats(http_client_stats_t* out)
+{
+    if (!out) return;
+    pthread_mutex_lock(&stats_mutex);
+    *out = stats;
+    pthread_mutex_unlock(&stats_mutex);
+}
+
+void http_client_cleanup(void)
+{
+    close_connection();
+    free(body_buf);
+    body_buf = NULL;
+    body_cap = 0;
+    server_addr_len = 0;
+}
@@ -0,0 +1,473 @@
+/**
+ * @file jpeg_decoder.c
+ * @brief In-memory JPEG decoding for motion analysis.
+ * * Frames arrive from the camera as JPEG bytes in memory, so they are fed to
+ * libjpeg with jpeg_mem_src() instead of going through a file. The decoder can
+ * scale the image down during the IDCT (scale_num/scale_denom), which is far
+ * cheaper than decoding at full size and shrinking afterwards. Requesting
+ * grayscale output skips the chroma components and colour conversion entirely.
+ * * For block-level motion detection the pixels are not needed at all:
+ * jpeg_decode_luma_coefs() stops after entropy decoding and hands back the
+ * low-frequency coefficients of each luma block.
+ * * Each thread keeps one decompress object across frames. libjpeg's per-image
+ * working memory (row buffers, and the whole-image coefficient arrays of
+ * jpeg_read_coefficients()) is served from an arena owned by that object and
+ * reset after every image, so once the arena has grown to fit the frame size
+ * in use, decoding makes no heap allocations.
+ */
+
+#include "jpeg_decoder.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <setjmp.h>
+#include <jpeglib.h>
+#include <jerror.h>
+
+// libjpeg-turbo's SIMD routines expect 32-byte aligned buffers and sample rows
+// padded to 64 bytes (they may read or write past the end of a row)
+#define ARENA_ALIGN 32
+#define ROW_ALIGN (2 * ARENA_ALIGN)
+
+// Heap allocations made for libjpeg by every thread. Permanent requests are
+// all counted, although libjpeg carves small ones from a pool it already has.
+static atomic_ulong heap_allocs;
+
+/**
+ * @brief libjpeg error manager that jumps back to the caller.
+ * * The default manager calls exit() on any error, which would take down the
+ * whole doorbell on a single truncated network frame.
+ */
+typedef struct {
+    struct jpeg_error_mgr pub;
+    jmp_buf escape;
+} decode_error_mgr;
+
+static void on_decode_error(j_common_ptr cinfo) {
+    decode_error_mgr* err = (decode_error_mgr*)cinfo->err;
+    longjmp(err->escape, 1);
+}
+
+// Warnings (e.g. "premature end of data") are expected on partial frames; stay quiet.
+static void on_decode_message(j_common_ptr cinfo) { (void)cinfo; }
+
+// Virtual arrays are always held whole in the arena; there is no backing store
+struct jvirt_sarray_control {
+    JSAMPARRAY mem_buffer; // NULL until realized
+    JDIMENSION rows;
+    JDIMENSION samplesperrow;
+    boolean pre_zero;
+    struct jvirt_sarray_control* next;
+};
+
+struct jvirt_barray_control {
+    JBLOCKARRAY mem_buffer;
+    JDIMENSION rows;
+    JDIMENSION blocksperrow;
+    boolean pre_zero;
+    struct jvirt_barray_control* next;
+};
+
+/**
+ * @brief libjpeg memory manager with an arena for JPOOL_IMAGE.
+ * * JPOOL_PERMANENT requests (the source manager, quantization and Huffman
+ * tables, made once per decompress object) go to libjpeg's own manager.
+ * Image requests that do not fit the arena are spilled to the heap, and the
+ * arena is regrown to the image's total demand when the pool is freed.
+ */
+typedef struct {
+    struct jpeg_memory_mgr pub;
+    struct jpeg_memory_mgr* base; // libjpeg's manager
+    unsigned char* arena;
+    size_t cap;
+    size_t used;
+    size_t demand;                // Bytes requested for the current image
+    void* spill;                  // Heap blocks of this image, linked through their first word
+    struct jvirt_sarray_control* sarrays;
+    struct jvirt_barray_control* barrays;
+} arena_mem_mgr;
+
+static size_t align_up(size_t n, size_t align) { return (n + align - 1) & ~(align - 1); }
+
+static void* arena_alloc(j_common_ptr cinfo, size_t size) {
+    arena_mem_mgr* m = (arena_mem_mgr*)cinfo->mem;
+    size = align_up(size, ARENA_ALIGN);
+    m->demand += size;
+    if (m->used + size <= m->cap) {
+        void* p = m->arena + m->used;
+        m->used += size;
+        return p;
+    }
+    // The block header keeps the payload aligned
+    void** block = aligned_alloc(ARENA_ALIGN, ARENA_ALIGN + size);
+    if (!block) ERREXIT1(cinfo, JERR_OUT_OF_MEMORY, 0);
+    atomic_fetch_add(&heap_allocs, 1);
+    *block = m->spill;
+    m->spill = block;
+    return (unsigned char*)block + ARENA_ALIGN;
+}
+
+/*
+ * Permanent requests run libjpeg's own method, which expects cinfo->mem to be
+ * its private struct for the duration of the call.
+ */
+static void* mem_alloc_small(j_common_ptr cinfo, int pool_id, size_t size) {
+    arena_mem_mgr* m = (arena_mem_mgr*)cinfo->mem;
+    if (pool_id == JPOOL_IMAGE) return arena_alloc(cinfo, size);
+    cinfo->mem = m->base;
+    void* p = (*m->base->alloc_small)(cinfo, pool_id, size);
+    cinfo->mem = &m->pub;
+    atomic_fetch_add(&heap_allocs, 1);
+    return p;
+}
+
+static void* mem_alloc_large(j_common_ptr cinfo, int pool_id, size_t size) {
+    arena_mem_mgr* m = (arena_mem_mgr*)cinfo->mem;
+    if (pool_id == JPOOL_IMAGE) return arena_alloc(cinfo, size);
+    cinfo->mem = m->base;
+    void* p = (*m->base->alloc_large)(cinfo, pool_id, size);
+    cinfo->mem = &m->pub;
+    atomic_fetch_add(&heap_allocs, 1);
+    return p;
+}
+
+static JSAMPARRAY mem_alloc_sarray(j_common_ptr cinfo, int pool_id, JDIMENSION samplesperrow,
+                                   JDIMENSION numrows) {
+    size_t row = align_up((size_t)samplesperrow * sizeof(JSAMPLE), ROW_ALIGN);
+    JSAMPARRAY rows = mem_alloc_small(cinfo, pool_id, numrows * sizeof(JSAMPROW));
+    JSAMPLE* data = mem_alloc_large(cinfo, pool_id, row * numrows);
+    for (JDIMENSION r = 0; r < numrows; r++) rows[r] = (JSAMPROW)((unsigned char*)data + r * row);
+    return rows;
+}
+
+static JBLOCKARRAY mem_alloc_barray(j_common_ptr cinfo, int pool_id, JDIMENSION blocksperrow,
+                                    JDIMENSION numrows) {
+    JBLOCKARRAY rows = mem_alloc_small(cinfo, pool_id, numrows * sizeof(JBLOCKROW));
+    JBLOCKROW data = mem_alloc_large(cinfo, pool_id, (size_t)blocksperrow * numrows * sizeof(JBLOCK));
+    for (JDIMENSION r = 0; r < numrows; r++) rows[r] = data + (size_t)r * blocksperrow;
+    return rows;
+}
+
+static jvirt_sarray_ptr mem_request_virt_sarray(j_common_ptr cinfo, int pool_id, boolean pre_zero,
+                                                JDIMENSION samplesperrow, JDIMENSION numrows,
+                                                JDIMENSION maxaccess) {
+    (void)maxaccess;
+    arena_mem_mgr* m = (arena_mem_mgr*)cinfo->mem;
+    if (pool_id != JPOOL_IMAGE) ERREXIT1(cinfo, JERR_BAD_POOL_ID, pool_id);
+    jvirt_sarray_ptr v = arena_alloc(cinfo, sizeof(*v));
+    *v = (struct jvirt_sarray_control){ NULL, numrows, samplesperrow, pre_zero, m->sarrays };
+    m->sarrays = v;
+    return v;
+}
+
+static jvirt_barray_ptr mem_request_virt_barray(j_common_ptr cinfo, int pool_id, boolean pre_zero,
+                                                JDIMENSION blocksperrow, JDIMENSION numrows,
+                                                JDIMENSION maxaccess) {
+    (void)maxaccess;
+    arena_mem_mgr* m = (arena_mem_mgr*)cinfo->mem;
+    if (pool_id != JPOOL_IMAGE) ERREXIT1(cinfo, JERR_BAD_POOL_ID, pool_id);
+    jvirt_barray_ptr v = arena_alloc(cinfo, sizeof(*v));
+    *v = (struct jvirt_barray_control){ NULL, numrows, blocksperrow, pre_zero, m->barrays };
+    m->barrays = v;
+    return v;
+}
+
+static void mem_realize_virt_arrays(j_common_ptr cinfo) {
+    arena_mem_mgr* m = (arena_mem_mgr*)cinfo->mem;
+    for (jvirt_sarray_ptr v = m->sarrays; v; v = v->next) {
+        if (v->mem_buffer) continue;
+        v->mem_buffer = mem_alloc_sarray(cinfo, JPOOL_IMAGE, v->samplesperrow, v->rows);
+        if (v->pre_zero && v->rows > 0) {
+            memset(v->mem_buffer[0], 0, align_up(v->samplesperrow * sizeof(JSAMPLE), ROW_ALIGN) * v->rows);
+        }
+    }
+    for (jvirt_barray_ptr v = m->barrays; v; v = v->next) {
+        if (v->mem_buffer) continue;
+        v->mem_buffer = mem_alloc_barray(cinfo, JPOOL_IMAGE, v->blocksperrow, v->rows);
+        if (v->pre_zero && v->rows > 0) {
+            memset(v->mem_buffer[0], 0, (size_t)v->blocksperrow * v->rows * sizeof(JBLOCK));
+        }
+    }
+}
+
+static JSAMPARRAY mem_access_virt_sarray(j_common_ptr cinfo, jvirt_sarray_ptr v, JDIMENSION start_row,
+                                         JDIMENSION num_rows, boolean writable) {
+    (void)writable;
+    if (!v->mem_buffer || start_row + num_rows > v->rows) ERREXIT(cinfo, JERR_BAD_VIRTUAL_ACCESS);
+    return v->mem_buffer + start_row;
+}
+
+static JBLOCKARRAY mem_access_virt_barray(j_common_ptr cinfo, jvirt_barray_ptr v, JDIMENSION start_row,
+                                          JDIMENSION num_rows, boolean writable) {
+    (void)writable;
+    if (!v->mem_buffer || start_row + num_rows > v->rows) ERREXIT(cinfo, JERR_BAD_VIRTUAL_ACCESS);
+    return v->mem_buffer + start_row;
+}
+
+// Drop the image's spill blocks and empty the arena
+static void release_image(arena_mem_mgr* m) {
+    while (m->spill) {
+        void* next = *(void**)m->spill;
+        free(m->spill);
+        m->spill = next;
+    }
+    m->used = 0;
+    m->demand = 0;
+    m->sarrays = NULL;
+    m->barrays = NULL;
+}
+
+static void mem_free_pool(j_common_ptr cinfo, int pool_id) {
+    arena_mem_mgr* m = (arena_mem_mgr*)cinfo->mem;
+    if (pool_id != JPOOL_IMAGE) {
+        cinfo->mem = m->base;
+        (*m->base->free_pool)(cinfo, pool_id);
+        cinfo->mem = &m->pub;
+        return;
+    }
+    if (m->demand > m->cap) {
+        // Grow so the next image of this size fits; on failure keep spilling
+        size_t cap = align_up(m->demand, 4096);
+        unsigned char* arena = aligned_alloc(ARENA_ALIGN, cap);
+        if (arena) {
+            atomic_fetch_add(&heap_allocs, 1);
+            free(m->arena);
+            m->arena = arena;
+            m->cap = cap;
+        }
+    }
+    release_image(m);
+}
+
+static void mem_self_destruct(j_common_ptr cinfo) {
+    arena_mem_mgr* m = (arena_mem_mgr*)cinfo->mem;
+    release_image(m);
+    free(m->arena);
+    m->arena = NULL;
+    m->cap = 0;
+    cinfo->mem = m->base;
+    (*m->base->self_destruct)(cinfo);
+}
+
+static void install_arena(j_common_ptr cinfo, arena_mem_mgr* m) {
+    *m = (arena_mem_mgr){
+        .pub = {
+            .alloc_small = mem_alloc_small,
+            .alloc_large = mem_alloc_large,
+            .alloc_sarray = mem_alloc_sarray,
+            .alloc_barray = mem_alloc_barray,
+            .request_virt_sarray = mem_request_virt_sarray,
+            .request_virt_barray = mem_request_virt_barray,
+            .realize_virt_arrays = mem_realize_virt_arrays,
+            .access_virt_sarray = mem_access_virt_sarray,
+            .access_virt_barray = mem_access_virt_barray,
+            .free_pool = mem_free_pool,
+            .self_destruct = mem_self_destruct,
+            .max_memory_to_use = cinfo->mem->max_memory_to_use,
+            .max_alloc_chunk = cinfo->mem->max_alloc_chunk,
+        },
+        .base = cinfo->mem,
+    };
+    cinfo->mem = &m->pub;
+}
+
+// One decompress object per thread, reused for every frame it decodes
+typedef struct {
+    struct jpeg_decompress_struct cinfo;
+    decode_error_mgr jerr;
+    arena_mem_mgr mem;
+    bool ready;
+} decoder_t;
+
+static _Thread_local decoder_t decoder;
+
+// Returns the calling thread's decompress object, creating it on first use
+static j_decompress_ptr decoder_get(void) {
+    decoder_t* d = &decoder;
+    if (d->ready) return &d->cinfo;
+
+    d->cinfo.err = jpeg_std_error(&d->jerr.pub);
+    d->jerr.pub.error_exit = on_decode_error;
+    d->jerr.pub.output_message = on_decode_message;
+    if (setjmp(d->jerr.escape)) {
+        jpeg_destroy_decompress(&d->cinfo);
+        return NULL;
+    }
+    jpeg_create_decompress(&d->cinfo);
+    atomic_fetch_add(&heap_allocs, 1); // libjpeg's manager and its first pool
+    install_arena((j_common_ptr)&d->cinfo, &d->mem);
+    d->ready = true;
+    return &d->cinfo;
+}
+
+// Error path: drop the image but keep the object (and its arena) for the next frame
+static void decoder_abort(void) {
+    // An error inside a permanent allocation leaves libjpeg's manager installed
+    decoder.cinfo.mem = &decoder.mem.pub;
+    jpeg_abort_decompress(&decoder.cinfo);
+}
+
+void jpeg_decoder_release(void) {
+    if (!decoder.ready) return;
+    jpeg_destroy_decompress(&decoder.cinfo);
+    decoder.ready = false;
+}
+
+unsigned long jpeg_decoder_heap_allocs(void) {
+    return atomic_load(&heap_allocs);
+}
+
+// Shared by the allocating and caller-buffer variants. With `dst` set, decodes
+// into it if the image fits in `cap` bytes; otherwise mallocs into *alloc.
+// Returns the bytes the image needs (nothing decoded if > cap), or -1.
+static long decode_pixels(const unsigned char* jpg, size_t len, jpeg_decode_format_t format,
+                          int scale_denom, unsigned char* dst, size_t cap,
+                          unsigned char** alloc, int* w, int* h) {
+    if (!jpg || len == 0) return -1;
+    if (scale_denom != 1 && scale_denom != 2 && scale_denom != 4 && scale_denom != 8) return -1;
+
+    j_decompress_ptr cinfo = decoder_get();
+    if (!cinfo) return -1;
+    // Must survive the longjmp, so it cannot live in a register
+    unsigned char* volatile buf = NULL;
+
+    if (setjmp(decoder.jerr.escape)) {
+        decoder_abort();
+        if (!dst) free(buf);
+        return -1;
+    }
+
+    jpeg_mem_src(cinfo, jpg, len);
+    jpeg_read_header(cinfo, TRUE);
+
+    // Analysis settings: DCT-domain downscale, fast IDCT, plain replication upsampling
+    cinfo->out_color_space = (format == JPEG_DECODE_GRAY) ? JCS_GRAYSCALE : JCS_RGB;
+    cinfo->scale_num = 1;
+    cinfo->scale_denom = scale_denom;
+    cinfo->dct_method = JDCT_IFAST;
+    cinfo->do_fancy_upsampling = FALSE;
+    cinfo->do_block_smoothing = FALSE;
+
+    // Size check before jpeg_start_decompress() allocates the decode buffers
+    jpeg_calc_output_dimensions(cinfo);
+    size_t stride = (size_t)cinfo->output_width * cinfo->output_components;
+    size_t needed = stride * cinfo->output_height;
+    *w = cinfo->output_width;
+    *h = cinfo->output_height;
+    if (dst && needed > cap) {
+        jpeg_abort_decompress(cinfo);
+        return (long)needed;
+    }
+
+    buf = dst ? dst : malloc(needed);
+    if (!buf) {
+        jpeg_abort_decompress(cinfo);
+        return -1;
+    }
+
+    jpeg_start_decompress(cinfo);
+
+    // Read scanlines straight into the output buffer
+    while (cinfo->output_scanline < cinfo->output_height) {
+        JSAMPROW rowptr = &buf[cinfo->output_scanline * stride];
+        jpeg_read_scanlines(cinfo, &rowptr, 1);
+    }
+
+    jpeg_finish_decompress(cinfo);
+    if (alloc) *alloc = buf;
+    return (long)needed;
+}
+
+unsigned char* jpeg_decode_mem(const unsigned char* jpg, size_t len, jpeg_decode_format_t format,
+                               int scale_denom, int* w, int* h) {
+    unsigned char* buf = NULL;
+    if (decode_pixels(jpg, len, format, scale_denom, NULL, 0, &buf, w, h) < 0) return NULL;
+    return buf;
+}
+
+long jpeg_decode_mem_into(const unsigned char* jpg, size_t len, jpeg_decode_format_t format,
+                          int scale_denom, unsigned char* dst, size_t cap, int* w, int* h) {
+    if (!dst) return -1;
+    return decode_pixels(jpg, len, format, scale_denom, dst, cap, NULL, w, h);
+}
+
+// Natural-order coefficient indices: DC, first horizontal AC, first vertical AC
+static const int coef_index[3] = { 0, 1, DCTSIZE };
+
+// Coefficient counterpart of decode_pixels(); sizes are in bytes
+static long decode_coefs(const unsigned char* jpg, size_t len, int coefs_per_block,
+                         int16_t* dst, size_t cap, int16_t** alloc, int* blocks_w, int* blocks_h) {
+    if (!jpg || len == 0) return -1;
+    if (coefs_per_block != 1 && coefs_per_block != 3) return -1;
+
+    j_decompress_ptr cinfo = decoder_get();
+    if (!cinfo) return -1;
+    int16_t* volatile out = NULL;
+
+    if (setjmp(decoder.jerr.escape)) {
+        decoder_abort();
+        if (!dst) free(out);
+        return -1;
+    }
+
+    jpeg_mem_src(cinfo, jpg, len);
+    jpeg_read_header(cinfo, TRUE);
+
+    // Component 0 is luma (Y) for both YCbCr and grayscale JPEGs. Block counts
+    // are set up by jpeg_read_header(), before any coefficient is decoded.
+    jpeg_component_info* luma = &cinfo->comp_info[0];
+    JDIMENSION bw = luma->width_in_blocks;
+    JDIMENSION bh = luma->height_in_blocks;
+    size_t plane = (size_t)bw * bh;
+    size_t needed = plane * coefs_per_block * sizeof(int16_t);
+    *blocks_w = bw;
+    *blocks_h = bh;
+    if (dst && needed > cap) {
+        jpeg_abort_decompress(cinfo);
+        return (long)needed;
+    }
+
+    out = dst ? dst : malloc(needed);
+    if (!out) {
+        jpeg_abort_decompress(cinfo);
+        return -1;
+    }
+
+    jvirt_barray_ptr* coefs = jpeg_read_coefficients(cinfo);
+    int quant[3];
+    for (int c = 0; c < coefs_per_block; c++) {
+        quant[c] = luma->quant_table ? luma->quant_table->quantval[coef_index[c]] : 1;
+    }
+
+    for (JDIMENSION by = 0; by < bh; by++) {
+        JBLOCKARRAY row = (*cinfo->mem->access_virt_barray)((j_common_ptr)cinfo, coefs[0], by, 1, FALSE);
+        int16_t* plane_row = out + (size_t)by * bw;
+        for (int c = 0; c < coefs_per_block; c++) {
+            int k = coef_index[c];
+            int q = quant[c];
+            for (JDIMENSION bx = 0; bx < bw; bx++) {
+                plane_row[bx] = (int16_t)(row[0][bx][k] * q);
+            }
+            plane_row += plane;
+        }
+    }
+
+    jpeg_finish_decompress(cinfo);
+    if (alloc) *alloc = out;
+    return (long)needed;
+}
+
+int16_t* jpeg_decode_luma_coefs(const unsigned char* jpg, size_t len, int coefs_per_block,
+                                int* blocks_w, int* blocks_h) {
+    int16_t* out = NULL;
+    if (decode_coefs(jpg, len, coefs_per_block, NULL, 0, &out, blocks_w, blocks_h) < 0) return NULL;
+    return out;
+}
+
+long jpeg_decode_luma_coefs_into(const unsigned char* jpg, size_t len, int coefs_per_block,
+                                 int16_t* dst, size_t cap, int* blocks_w, int* blocks_h) {
+    if (!dst) return -1;
+    return decode_coefs(jpg, len, coefs_per_block, dst, cap, NULL, blocks_w, blocks_h);
+}
@@ -0,0 +1,92 @@
+#include "led_pattern.h"
+#include "timer_wheel.h"
+#include "hal/led.h"
+
+typedef struct {
+    wheel_timer_t timer;
+    bool rest;        // Level between patterns
+    bool level;       // Level currently driven
+    int steps_left;   // Level changes still to make before returning to rest
+    int on_ms, off_ms;
+} led_player_t;
+
+static led_player_t players[LED_PATTERN_COUNT];
+
+static hal_led_t hal_led_of(led_pattern_led_t led)
+{
+    return led == LED_PATTERN_GREEN ? HAL_LED_GREEN : HAL_LED_RED;
+}
+
+static void drive(led_pattern_led_t led, bool on)
+{
+    hal_led_set(hal_led_of(led), on);
+    players[led].level = on;
+}
+
+static void on_step(void* ctx)
+{
+    led_pattern_led_t led = (led_pattern_led_t)(long)ctx;
+    led_player_t* p = &players[led];
+    if (p->steps_left <= 0) {
+        drive(led, p->rest);
+        return;
+    }
+    p->steps_left--;
+    bool on = !p->level;
+    drive(led, on);
+    timer_wheel_schedule(&p->timer, on ? p->on_ms : p->off_ms);
+}
+
+void led_pattern_init(void)
+{
+    for (int i = 0; i < LED_PATTERN_COUNT; i++) {
+        timer_wheel_timer_init(&players[i].timer, on_step, (void*)(long)i);
+        players[i].rest = false;
+        drive(i, false);
+    }
+}
+
+void led_pattern_set_rest(led_pattern_led_t led, bool on)
+{
+    led_player_t* p = &players[led];
+    p->rest = on;
+    if (!timer_wheel_pending(&p->timer)) drive(led, on);
+}
+
+void led_pattern_hold(led_pattern_led_t led, bool on, int ms)
+{
+    led_player_t* p = &players[led];
+    p->steps_left = 0;
+    drive(led, on);
+    timer_wheel_schedule(&p->timer, ms);
+}
+
+void led_pattern_flash(led_pattern_led_t led, int n, int total_ms)
+{
+    if (n <= 0 || total_ms <= 0) return;
+    led_player_t* p = &players[led];
+    int period_ms = total_ms / n;
+    p->on_ms = period_ms / 2;
+    p->off_ms = period_ms - p->on_ms;
+    // The kernel's pattern trigger plays it when it can; one wakeup at the
+    // end puts the LED back to rest
+    if (hal_led_flash(hal_led_of(led), n, p->on_ms, p->off_ms) == 0) {
+        p->steps_left = 0;
+        p->level = false;
+        timer_wheel_schedule(&p->timer, n * period_ms);
+        return;
+    }
+    // Same timing as hal_led_flash_*_n_times(): on for half a period, then off
+    p->steps_left = 2 * n - 1;
+    drive(led, true);
+    timer_wheel_schedule(&p->timer, p->on_ms);
+}
+
+void led_pattern_cleanup(void)
+{
+    for (int i = 0; i < LED_PATTERN_COUNT; i++) {
+        timer_wheel_cancel(&players[i].timer);
+        players[i].rest = false;
+    }
+    hal_led_all_off();
+}
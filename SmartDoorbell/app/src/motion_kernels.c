@@ -0,0 +1,417 @@
+/**
+ * @file motion_kernels.c
+ * @brief Vectorized frame-difference and background-update kernels.
+ * * Each implementation works on 16 (or 32) pixels at a time with saturating
+ * absolute difference, a compare against the threshold, and a Q8 fixed-point
+ * blend computed in 16-bit lanes. Changed pixels are counted in 8-bit lane
+ * accumulators that are flushed to wide counters before they can overflow,
+ * so the inner loop has no branches.
+ * * NEON targets the Cortex-A53 on the BeagleY-AI; SSE2/AVX2 exist so the same
+ * code can be profiled on x86 dev hosts. The best supported version is picked
+ * at runtime and checked against the scalar reference before it is used.
+ */
+
+#define _GNU_SOURCE
+#include "motion_kernels.h"
+#include <stdbool.h>
+#include <string.h>
+#include <pthread.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define HAVE_X86_KERNELS 1
+#include <immintrin.h>
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define HAVE_NEON_KERNELS 1
+#include <arm_neon.h>
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+
+#define LANE_FLUSH 255 // 8-bit lane counters are flushed every 255 vectors
+
+// ---------------------------------------------------------------------------
+// Scalar reference
+// ---------------------------------------------------------------------------
+
+static inline uint8_t blend_px(uint8_t bg, uint8_t curr, uint8_t alpha) {
+    return (uint8_t)((bg * (256 - alpha) + curr * alpha + 128) >> 8);
+}
+
+static size_t scalar_diff_count(const uint8_t* bg, const uint8_t* curr, size_t n, uint8_t thresh) {
+    size_t count = 0;
+    for (size_t i = 0; i < n; i++) {
+        int diff = curr[i] > bg[i] ? curr[i] - bg[i] : bg[i] - curr[i];
+        count += (diff > thresh);
+    }
+    return count;
+}
+
+static void scalar_bg_update(uint8_t* bg, const uint8_t* curr, size_t n, uint8_t alpha) {
+    for (size_t i = 0; i < n; i++) {
+        bg[i] = blend_px(bg[i], curr[i], alpha);
+    }
+}
+
+static size_t scalar_diff_update(uint8_t* bg, const uint8_t* curr, size_t n, uint8_t thresh, uint8_t alpha) {
+    size_t count = 0;
+    for (size_t i = 0; i < n; i++) {
+        int diff = curr[i] > bg[i] ? curr[i] - bg[i] : bg[i] - curr[i];
+        count += (diff > thresh);
+        bg[i] = blend_px(bg[i], curr[i], alpha);
+    }
+    return count;
+}
+
+static const motion_kernels_t scalar_kernels = {
+    "scalar", scalar_diff_count, scalar_bg_update, scalar_diff_update
+};
+
+// ---------------------------------------------------------------------------
+// x86: SSE2 (16 pixels) and AVX2 (32 pixels)
+// ---------------------------------------------------------------------------
+
+#ifdef HAVE_X86_KERNELS
+
+// Sum the two 64-bit lanes of a _mm_sad_epu8 accumulator
+__attribute__((target("sse2")))
+static size_t sse2_hsum64(__m128i v) {
+    uint64_t lanes[2];
+    _mm_storeu_si128((__m128i*)lanes, v);
+    return (size_t)(lanes[0] + lanes[1]);
+}
+
+// 0xFF in every lane where |a - b| <= thresh
+__attribute__((target("sse2")))
+static inline __m128i sse2_unchanged(__m128i a, __m128i b, __m128i th) {
+    __m128i diff = _mm_or_si128(_mm_subs_epu8(a, b), _mm_subs_epu8(b, a));
+    return _mm_cmpeq_epi8(_mm_subs_epu8(diff, th), _mm_setzero_si128());
+}
+
+__attribute__((target("sse2")))
+static inline __m128i sse2_blend(__m128i b, __m128i c, __m128i wb, __m128i wc) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i round = _mm_set1_epi16(128);
+    __m128i lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(b, zero), wb),
+                               _mm_mullo_epi16(_mm_unpacklo_epi8(c, zero), wc));
+    __m128i hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(b, zero), wb),
+                               _mm_mullo_epi16(_mm_unpackhi_epi8(c, zero), wc));
+    lo = _mm_srli_epi16(_mm_add_epi16(lo, round), 8);
+    hi = _mm_srli_epi16(_mm_add_epi16(hi, round), 8);
+    return _mm_packus_epi16(lo, hi);
+}
+
+__attribute__((target("sse2")))
+static size_t sse2_diff_update_impl(uint8_t* bg, const uint8_t* curr, size_t n,
+                                    uint8_t thresh, uint8_t alpha, bool count, bool update) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i th = _mm_set1_epi8((char)thresh);
+    const __m128i wb = _mm_set1_epi16((short)(256 - alpha));
+    const __m128i wc = _mm_set1_epi16(alpha);
+    __m128i total = zero, acc = zero;
+    int pending = 0;
+
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i b = _mm_loadu_si128((const __m128i*)(bg + i));
+        __m128i c = _mm_loadu_si128((const __m128i*)(curr + i));
+        if (count) {
+            acc = _mm_sub_epi8(acc, sse2_unchanged(b, c, th));
+            if (++pending == LANE_FLUSH) {
+                total = _mm_add_epi64(total, _mm_sad_epu8(acc, zero));
+                acc = zero;
+                pending = 0;
+            }
+        }
+        if (update) _mm_storeu_si128((__m128i*)(bg + i), sse2_blend(b, c, wb, wc));
+    }
+    total = _mm_add_epi64(total, _mm_sad_epu8(acc, zero));
+
+    size_t changed = count ? i - sse2_hsum64(total) : 0;
+    if (count && update) return changed + scalar_diff_update(bg + i, curr + i, n - i, thresh, alpha);
+    if (count) return changed + scalar_diff_count(bg + i, curr + i, n - i, thresh);
+    scalar_bg_update(bg + i, curr + i, n - i, alpha);
+    return 0;
+}
+
+static size_t sse2_diff_count(const uint8_t* bg, const uint8_t* curr, size_t n, uint8_t thresh) {
+    return sse2_diff_update_impl((uint8_t*)bg, curr, n, thresh, 0, true, false);
+}
+
+static void sse2_bg_update(uint8_t* bg, const uint8_t* curr, size_t n, uint8_t alpha) {
+    sse2_diff_update_impl(bg, curr, n, 0, alpha, false, true);
+}
+
+static size_t sse2_diff_update(uint8_t* bg, const uint8_t* curr, size_t n, uint8_t thresh, uint8_t alpha) {
+    return sse2_diff_update_impl(bg, curr, n, thresh, alpha, true, true);
+}
+
+static const motion_kernels_t sse2_kernels = {
+    "sse2", sse2_diff_count, sse2_bg_update, sse2_diff_update
+};
+
+__attribute__((target("avx2")))
+static size_t avx2_hsum64(__m256i v) {
+    uint64_t lanes[4];
+    _mm256_storeu_si256((__m256i*)lanes, v);
+    return (size_t)(lanes[0] + lanes[1] + lanes[2] + lanes[3]);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i avx2_unchanged(__m256i a, __m256i b, __m256i th) {
+    __m256i diff = _mm256_or_si256(_mm256_subs_epu8(a, b), _mm256_subs_epu8(b, a));
+    return _mm256_cmpeq_epi8(_mm256_subs_epu8(diff, th), _mm256_setzero_si256());
+}
+
+// Unpack/pack work within 128-bit lanes, so the byte order round-trips
+__attribute__((target("avx2")))
+static inline __m256i avx2_blend(__m256i b, __m256i c, __m256i wb, __m256i wc) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i round = _mm256_set1_epi16(128);
+    __m256i lo = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpacklo_epi8(b, zero), wb),
+                                  _mm256_mullo_epi16(_mm256_unpacklo_epi8(c, zero), wc));
+    __m256i hi = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpackhi_epi8(b, zero), wb),
+                                  _mm256_mullo_epi16(_mm256_unpackhi_epi8(c, zero), wc));
+    lo = _mm256_srli_epi16(_mm256_add_epi16(lo, round), 8);
+    hi = _mm256_srli_epi16(_mm256_add_epi16(hi, round), 8);
+    return _mm256_packus_epi16(lo, hi);
+}
+
+__attribute__((target("avx2")))
+static size_t avx2_diff_update_impl(uint8_t* bg, const uint8_t* curr, size_t n,
+                                    uint8_t thresh, uint8_t alpha, bool count, bool update) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i th = _mm256_set1_epi8((char)thresh);
+    const __m256i wb = _mm256_set1_epi16((short)(256 - alpha));
+    const __m256i wc = _mm256_set1_epi16(alpha);
+    __m256i total = zero, acc = zero;
+    int pending = 0;
+
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i b = _mm256_loadu_si256((const __m256i*)(bg + i));
+        __m256i c = _mm256_loadu_si256((const __m256i*)(curr + i));
+        if (count) {
+            acc = _mm256_sub_epi8(acc, avx2_unchanged(b, c, th));
+            if (++pending == LANE_FLUSH) {
+                total = _mm256_add_epi64(total, _mm256_sad_epu8(acc, zero));
+                acc = zero;
+                pending = 0;
+            }
+        }
+        if (update) _mm256_storeu_si256((__m256i*)(bg + i), avx2_blend(b, c, wb, wc));
+    }
+    total = _mm256_add_epi64(total, _mm256_sad_epu8(acc, zero));
+
+    // The SSE2 path handles the remaining < 32 pixels
+    size_t changed = count ? i - avx2_hsum64(total) : 0;
+    return changed + sse2_diff_update_impl(bg + i, curr + i, n - i, thresh, alpha, count, update);
+}
+
+static size_t avx2_diff_count(const uint8_t* bg, const uint8_t* curr, size_t n, uint8_t thresh) {
+    return avx2_diff_update_impl((uint8_t*)bg, curr, n, thresh, 0, true, false);
+}
+
+static void avx2_bg_update(uint8_t* bg, const uint8_t* curr, size_t n, uint8_t alpha) {
+    avx2_diff_update_impl(bg, curr, n, 0, alpha, false, true);
+}
+
+static size_t avx2_diff_update(uint8_t* bg, const uint8_t* curr, size_t n, uint8_t thresh, uint8_t alpha) {
+    return avx2_diff_update_impl(bg, curr, n, thresh, alpha, true, true);
+}
+
+static const motion_kernels_t avx2_kernels = {
+    "avx2", avx2_diff_count, avx2_bg_update, avx2_diff_update
+};
+
+static bool sse2_supported(void) { return __builtin_cpu_supports("sse2"); }
+static bool avx2_supported(void) { return __builtin_cpu_supports("avx2"); }
+
+#endif // HAVE_X86_KERNELS
+
+// ---------------------------------------------------------------------------
+// ARM NEON (16 pixels)
+// ---------------------------------------------------------------------------
+
+#ifdef HAVE_NEON_KERNELS
+
+static inline size_t neon_hsum_u8(uint8x16_t v) {
+    uint64x2_t sum = vpaddlq_u32(vpaddlq_u16(vpaddlq_u8(v)));
+    return (size_t)(vgetq_lane_u64(sum, 0) + vgetq_lane_u64(sum, 1));
+}
+
+static size_t neon_diff_update_impl(uint8_t* bg, const uint8_t* curr, size_t n,
+                                    uint8_t thresh, uint8_t alpha, bool count, bool update) {
+    // A weight of 256 does not fit in a u8 lane; alpha == 0 leaves bg unchanged anyway
+    if (alpha == 0) update = false;
+    const uint8x16_t th = vdupq_n_u8(thresh);
+    const uint8x8_t wb = vdup_n_u8((uint8_t)(256 - alpha));
+    const uint8x8_t wc = vdup_n_u8(alpha);
+    uint8x16_t acc = vdupq_n_u8(0);
+    size_t changed = 0;
+    int pending = 0;
+
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        uint8x16_t b = vld1q_u8(bg + i);
+        uint8x16_t c = vld1q_u8(curr + i);
+        if (count) {
+            // vcgtq gives 0xFF (-1) per changed lane; subtracting it adds 1
+            acc = vsubq_u8(acc, vcgtq_u8(vabdq_u8(b, c), th));
+            if (++pending == LANE_FLUSH) {
+                changed += neon_hsum_u8(acc);
+                acc = vdupq_n_u8(0);
+                pending = 0;
+            }
+        }
+        if (update) {
+            uint16x8_t lo = vmlal_u8(vmull_u8(vget_low_u8(b), wb), vget_low_u8(c), wc);
+            uint16x8_t hi = vmlal_u8(vmull_u8(vget_high_u8(b), wb), vget_high_u8(c), wc);
+            // Rounding narrow: (x + 128) >> 8, same as the scalar blend
+            vst1q_u8(bg + i, vcombine_u8(vrshrn_n_u16(lo, 8), vrshrn_n_u16(hi, 8)));
+        }
+    }
+    changed += neon_hsum_u8(acc);
+
+    if (count && update) return changed + scalar_diff_update(bg + i, curr + i, n - i, thresh, alpha);
+    if (count) return changed + scalar_diff_count(bg + i, curr + i, n - i, thresh);
+    if (update) scalar_bg_update(bg + i, curr + i, n - i, alpha);
+    return 0;
+}
+
+static size_t neon_diff_count(const uint8_t* bg, const uint8_t* curr, size_t n, uint8_t thresh) {
+    return neon_diff_update_impl((uint8_t*)bg, curr, n, thresh, 0, true, false);
+}
+
+static void neon_bg_update(uint8_t* bg, const uint8_t* curr, size_t n, uint8_t alpha) {
+    neon_diff_update_impl(bg, curr, n, 0, alpha, false, true);
+}
+
+static size_t neon_diff_update(uint8_t* bg, const uint8_t* curr, size_t n, uint8_t thresh, uint8_t alpha) {
+    // Counting needs the original bg, so count before the blend overwrites it
+    if (alpha == 0) return neon_diff_count(bg, curr, n, thresh);
+    return neon_diff_update_impl(bg, curr, n, thresh, alpha, true, true);
+}
+
+static const motion_kernels_t neon_kernels = {
+    "neon", neon_diff_count, neon_bg_update, neon_diff_update
+};
+
+static bool neon_supported(void) {
+#if defined(__aarch64__)
+    return (getauxval(AT_HWCAP) & HWCAP_ASIMD) != 0;
+#else
+    return (getauxval(AT_HWCAP) & HWCAP_NEON) != 0;
+#endif
+}
+
+#endif // HAVE_NEON_KERNELS
+
+// ---------------------------------------------------------------------------
+// Runtime dispatch
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    const motion_kernels_t* kernels;
+    bool (*supported)(void);
+} candidate_t;
+
+// Preferred first
+static const candidate_t candidates[] = {
+#ifdef HAVE_NEON_KERNELS
+    { &neon_kernels, neon_supported },
+#endif
+#ifdef HAVE_X86_KERNELS
+    { &avx2_kernels, avx2_supported },
+    { &sse2_kernels, sse2_supported },
+#endif
+    { &scalar_kernels, NULL },
+};
+#define NUM_CANDIDATES (sizeof(candidates) / sizeof(candidates[0]))
+
+static const motion_kernels_t* selected = &scalar_kernels;
+static pthread_once_t select_once = PTHREAD_ONCE_INIT;
+
+static void select_kernels(void) {
+    for (size_t i = 0; i < NUM_CANDIDATES; i++) {
+        const candidate_t* c = &candidates[i];
+        if (c->supported && !c->supported()) continue;
+        if (c->kernels != &scalar_kernels && motion_kernels_verify(c->kernels) != 0) continue;
+        selected = c->kernels;
+        return;
+    }
+}
+
+const motion_kernels_t* motion_kernels_get(void) {
+    pthread_once(&select_once, select_kernels);
+    return selected;
+}
+
+const motion_kernels_t* motion_kernels_scalar(void) {
+    return &scalar_kernels;
+}
+
+int motion_kernels_list(const motion_kernels_t** out, int max) {
+    int count = 0;
+    if (count < max) out[count++] = &scalar_kernels;
+    for (size_t i = 0; i < NUM_CANDIDATES && count < max; i++) {
+        const candidate_t* c = &candidates[i];
+        if (c->kernels == &scalar_kernels) continue;
+        if (c->supported && !c->supported()) continue;
+        out[count++] = c->kernels;
+    }
+    return count;
+}
+
+// ---------------------------------------------------------------------------
+// Self-test against the scalar reference
+// ---------------------------------------------------------------------------
+
+// Long enough for two lane-counter flushes at the widest (32-byte AVX2)
+// vector, and not a multiple of any vector width, so tails get exercised
+#define VERIFY_LEN (2 * LANE_FLUSH * 32 + 37)
+
+int motion_kernels_verify(const motion_kernels_t* k) {
+    static const size_t lengths[] = { 0, 1, 15, 16, 17, 31, 32, 33, LANE_FLUSH * 16 + 7,
+                                      LANE_FLUSH * 32, LANE_FLUSH * 32 + 7, VERIFY_LEN - 1 };
+    static const uint8_t thresholds[] = { 0, 1, 60, 128, 254, 255 };
+    static const uint8_t alphas[] = { 0, 1, 51, 128, 255 };
+
+    static uint8_t curr[VERIFY_LEN], bg_init[VERIFY_LEN];
+    static uint8_t bg_ref[VERIFY_LEN], bg_test[VERIFY_LEN];
+
+    // Deterministic pseudo-random frames, with some exact matches and extremes
+    uint32_t seed = 0x2545F491u;
+    for (size_t i = 0; i < VERIFY_LEN; i++) {
+        seed = seed * 1664525u + 1013904223u;
+        bg_init[i] = (uint8_t)(seed >> 24);
+        curr[i] = (i % 7 == 0) ? bg_init[i] : (uint8_t)(seed >> 16);
+        if (i % 97 == 0) curr[i] = 255;
+        if (i % 89 == 0) bg_init[i] = 0;
+    }
+
+    for (size_t l = 0; l < sizeof(lengths) / sizeof(lengths[0]); l++) {
+        for (size_t offset = 0; offset <= 1; offset++) { // Aligned and misaligned starts
+            size_t n = lengths[l];
+            const uint8_t* c = curr + offset;
+            for (size_t t = 0; t < sizeof(thresholds); t++) {
+                if (scalar_diff_count(bg_init + offset, c, n, thresholds[t]) !=
+                    k->diff_count(bg_init + offset, c, n, thresholds[t])) return -1;
+
+                for (size_t a = 0; a < sizeof(alphas); a++) {
+                    memcpy(bg_ref, bg_init, sizeof(bg_ref));
+                    memcpy(bg_test, bg_init, sizeof(bg_test));
+                    size_t ref = scalar_diff_update(bg_ref + offset, c, n, thresholds[t], alphas[a]);
+                    size_t got = k->diff_update(bg_test + offset, c, n, thresholds[t], alphas[a]);
+                    if (ref != got || memcmp(bg_ref, bg_test, sizeof(bg_ref)) != 0) return -1;
+
+                    memcpy(bg_test, bg_init, sizeof(bg_test));
+                    k->bg_update(bg_test + offset, c, n, alphas[a]);
+                    if (memcmp(bg_ref, bg_test, sizeof(bg_ref)) != 0) return -1;
+                }
+            }
+        }
+    }
+    return 0;
+}
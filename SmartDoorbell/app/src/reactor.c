@@ -0,0 +1,186 @@
+#define _GNU_SOURCE
+#include "reactor.h"
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <sys/resource.h>
+
+#define MAX_HANDLERS 16
+#define MAX_EVENTS 8
+
+typedef struct {
+    int fd;                 // -1 when the slot is free
+    bool is_timer;          // Owned by the reactor, drained before dispatch
+    reactor_handler_t handler;
+    void* ctx;
+} handler_entry_t;
+
+static int epoll_fd = -1;
+static handler_entry_t handlers[MAX_HANDLERS];
+static volatile bool running = false;
+static reactor_stats_t stats;
+static struct timespec start_time;
+
+static double elapsed_ms(const struct timespec* since)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - since->tv_sec) * 1000.0 + (now.tv_nsec - since->tv_nsec) / 1e6;
+}
+
+static double process_cpu_ms(void)
+{
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return (ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * 1000.0 +
+           (ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) / 1000.0;
+}
+
+int reactor_init(void)
+{
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd < 0) {
+        perror("Error creating epoll instance");
+        return -1;
+    }
+    for (int i = 0; i < MAX_HANDLERS; i++) handlers[i].fd = -1;
+    memset(&stats, 0, sizeof(stats));
+    clock_gettime(CLOCK_MONOTONIC, &start_time);
+    return 0;
+}
+
+static handler_entry_t* add_entry(int fd, uint32_t events, bool is_timer,
+                                  reactor_handler_t handler, void* ctx)
+{
+    if (epoll_fd < 0 || fd < 0 || !handler) return NULL;
+    for (int i = 0; i < MAX_HANDLERS; i++) {
+        handler_entry_t* h = &handlers[i];
+        if (h->fd >= 0) continue;
+
+        struct epoll_event ev = { .events = events, .data.ptr = h };
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+            perror("Error adding fd to epoll");
+            return NULL;
+        }
+        h->fd = fd;
+        h->is_timer = is_timer;
+        h->handler = handler;
+        h->ctx = ctx;
+        return h;
+    }
+    fprintf(stderr, "[REACTOR] Too many handlers\n");
+    return NULL;
+}
+
+int reactor_add(int fd, uint32_t events, reactor_handler_t handler, void* ctx)
+{
+    return add_entry(fd, events, false, handler, ctx) ? 0 : -1;
+}
+
+void reactor_remove(int fd)
+{
+    for (int i = 0; i < MAX_HANDLERS; i++) {
+        if (handlers[i].fd != fd) continue;
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+        if (handlers[i].is_timer) close(fd);
+        handlers[i].fd = -1;
+        return;
+    }
+}
+
+int reactor_add_timer(reactor_handler_t handler, void* ctx)
+{
+    int tfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (tfd < 0) {
+        perror("Error creating timerfd");
+        return -1;
+    }
+    if (!add_entry(tfd, EPOLLIN, true, handler, ctx)) {
+        close(tfd);
+        return -1;
+    }
+    return tfd;
+}
+
+int reactor_timer_set(int timer_fd, int initial_ms, int period_ms)
+{
+    struct itimerspec its = {
+        .it_value = { initial_ms / 1000, (initial_ms % 1000) * 1000000L },
+        .it_interval = { period_ms / 1000, (period_ms % 1000) * 1000000L },
+    };
+    return timerfd_settime(timer_fd, 0, &its, NULL);
+}
+
+int reactor_run(void)
+{
+    struct epoll_event events[MAX_EVENTS];
+    running = true;
+    while (running) {
+        int n = epoll_wait(epoll_fd, events, MAX_EVENTS, -1);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            perror("epoll_wait");
+            return -1;
+        }
+        stats.wakeups++;
+
+        for (int i = 0; i < n && running; i++) {
+            handler_entry_t* h = events[i].data.ptr;
+            if (h->fd < 0) continue; // Removed by an earlier handler in this batch
+
+            uint32_t arg = events[i].events;
+            if (h->is_timer) {
+                uint64_t expirations = 0;
+                if (read(h->fd, &expirations, sizeof(expirations)) != sizeof(expirations)) continue;
+                if (expirations > 1) stats.timer_overruns += expirations - 1;
+                arg = (uint32_t)expirations;
+            }
+            stats.dispatches++;
+            h->handler(h->fd, arg, h->ctx);
+        }
+    }
+    return 0;
+}
+
+void reactor_stop(void)
+{
+    running = false;
+}
+
+void reactor_get_stats(reactor_stats_t* out)
+{
+    *out = stats;
+    out->cpu_ms = process_cpu_ms();
+    out->uptime_ms = elapsed_ms(&start_time);
+}
+
+void reactor_print_stats(void)
+{
+    static reactor_stats_t prev;
+
+    reactor_stats_t now;
+    reactor_get_stats(&now);
+    double window_ms = now.uptime_ms - prev.uptime_ms;
+    if (window_ms <= 0) return;
+    printf("[REACTOR] %.1f wakeups/s, %.1f dispatches/s, %lu timer overruns, CPU %.2f%% (all threads)\n",
+           (now.wakeups - prev.wakeups) * 1000.0 / window_ms,
+           (now.dispatches - prev.dispatches) * 1000.0 / window_ms,
+           now.timer_overruns,
+           (now.cpu_ms - prev.cpu_ms) * 100.0 / window_ms);
+    prev = now;
+}
+
+void reactor_cleanup(void)
+{
+    for (int i = 0; i < MAX_HANDLERS; i++) {
+        if (handlers[i].fd >= 0 && handlers[i].is_timer) close(handlers[i].fd);
+        handlers[i].fd = -1;
+    }
+    if (epoll_fd >= 0) close(epoll_fd);
+    epoll_fd = -1;
+}
@@ -6,30 +6,149 @@
 #include <stdlib.h>
 #include <math.h> 
 #include <string.h> 
+#include <limits.h>
+#include <signal.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
 
 #include "hal/led.h"
 #include "hal/joystick.h"
 #include "hal/accelerometer.h" 
 #include "hal/uart.h" 
+#include "hal/rfid_frame.h"
+#include "hal/spi_bus.h"
+#include "hal/adc_sampler.h"
 #include "sound.h"
 #include "camera.h"
 #include "udp_client.h"
+#include "bench.h"
+#include "reactor.h"
+#include "timer_wheel.h"
+#include "led_pattern.h"
+#include "tamper_detector.h"
+#include "vibration_classifier.h"
+#include "credential_store.h"
 
 // --- CONFIG ---
 #define ESP32_IP "192.168.4.1" 
 #define PIN_LENGTH 4
-static const joystick_dir_t SECRET_PIN[PIN_LENGTH] = { JOY_LEFT, JOY_LEFT, JOY_UP, JOY_DOWN };
+// Stick directions as PINs are written in the credential store
+static const uint8_t PIN_LETTERS[] = { [JOY_UP] = 'U', [JOY_DOWN] = 'D', [JOY_LEFT] = 'L', [JOY_RIGHT] = 'R' };
 
-#define TAMPER_THRESHOLD 1000
+// --- ACCESS CONFIG ---
+// Tags and PINs allowed in; built from CREDENTIALS_TXT at startup if missing,
+// and picked up again whenever it is rebuilt. Both live next to the
+// executable (see app_file_path()), where CMake copies credentials.txt.
+#define CREDENTIALS_DB "credentials.db"
+#define CREDENTIALS_TXT "credentials.txt"
+
+// Stick gestures: ADC counts from the calibrated center. A digit is entered
+// on each press; holding the stick for JOY_LONG_PRESS_MS clears the entry.
+#define JOY_ENTER_THRESHOLD 1500
+#define JOY_EXIT_THRESHOLD 900
+#define JOY_DEBOUNCE_MS 20
+#define JOY_HOLD_MS 500
+#define JOY_LONG_PRESS_MS 1500
+
+// Vibration RMS in ADC counts after removing gravity; an alarm needs
+// TAMPER_ENTER_RMS sustained for TAMPER_MIN_MS. Used when the ADC sampler is
+// not running and the accelerometer is only read every SAMPLE_PERIOD_MS.
+#define TAMPER_HPF_MS 250
+#define TAMPER_WINDOW_MS 100
+#define TAMPER_ENTER_RMS 150
+#define TAMPER_EXIT_RMS 80
+#define TAMPER_MIN_MS 150
+// Knock/tamper classification of the sampled accelerometer stream: knocks are
+// impulses with most of their energy above VIB_KNOCK_HZ, tampering is
+// vibration without a dominant impulse for VIB_TAMPER_MS
+#define VIB_MIN_RMS 50
+#define VIB_KNOCK_HZ 60
+#define VIB_KNOCK_BAND_PCT 50
+#define VIB_IMPULSE_PCT 50
+#define VIB_TAMPER_MS 400
+#define STATS_PERIOD_MS 60000
+#define SAMPLE_PERIOD_MS 20        // Joystick/accelerometer ADC sampling period
+#define MOTION_COOLDOWN_MS 5000    // Ignore further motion for this long after an alert
+#define TAMPER_COOLDOWN_MS 2000    // Minimum gap between tamper alarms
+#define KNOCK_COOLDOWN_MS 5000     // One knock alert per bout of knocking
+#define RELOCK_DELAY_MS 3000       // How long the door stays unlocked
+#define WHEEL_TICK_MS 10           // Resolution of deferred actions (LED steps, cooldowns)
+
+// --- ADC CONFIG ---
+#define ADC_DEVICE "/dev/spidev0.0"
+#define SAMPLER_RATE_HZ 1000       // Accelerometer/joystick sampling rate
+#define SAMPLER_SPI_SPEED 1000000
+#define SAMPLER_BATCH 32           // Frames drained from the ring per read
 
 // --- RFID CONFIG ---
 #define UART_DEVICE "/dev/ttyAMA0" 
-#define RFID_SECRET_KEY "5A5992"
+#define UART_BAUD 9600             // Must match BAUDRATE in smart_doorbell_flipper/rfid_uart.c
 
-long long current_ms() {
-    struct timespec ts;
-    clock_gettime(CLOCK_REALTIME, &ts);
-    return (ts.tv_sec * 1000LL) + (ts.tv_nsec / 1000000LL);
+#define MAX_PENDING_ALERTS 8        // Alerts waiting for their pre-event frames
+#define ALERT_MSG_LEN 128
+
+// Alerts held back until the camera's export thread has written the frames
+// from before them (only touched from reactor handlers)
+static struct {
+    unsigned int ticket;
+    char message[ALERT_MSG_LEN];
+} pending_alerts[MAX_PENDING_ALERTS];
+static int pending_alert_count = 0;
+
+// Send an alert to server.js along with the latest camera frame. With
+// `preroll`, the frames from the seconds before it are exported first and the
+// message goes out from on_preroll_exported() once they are on disk.
+static void send_alert(const char* message, bool preroll) {
+    camera_save_snapshot();
+    unsigned int ticket;
+    if (!preroll || pending_alert_count == MAX_PENDING_ALERTS || camera_request_preroll(&ticket) != 0) {
+        udp_send(message);
+        return;
+    }
+    pending_alerts[pending_alert_count].ticket = ticket;
+    snprintf(pending_alerts[pending_alert_count].message, ALERT_MSG_LEN, "%s", message);
+    pending_alert_count++;
+}
+
+// Runs when the camera's export thread has finished writing /tmp/preroll
+static void on_preroll_exported(int fd, uint32_t events, void* ctx) {
+    (void)fd; (void)events; (void)ctx;
+    int frames;
+    unsigned int done = camera_poll_preroll(&frames);
+    if (frames < 0) printf("[ALERT] Pre-event frames unavailable\n");
+    int kept = 0;
+    for (int i = 0; i < pending_alert_count; i++) {
+        // Tickets only grow; the difference is wrap-safe
+        if ((int)(done - pending_alerts[i].ticket) >= 0) udp_send(pending_alerts[i].message);
+        else pending_alerts[kept++] = pending_alerts[i];
+    }
+    pending_alert_count = kept;
+}
+
+// --- Control state (only touched from reactor handlers) ---
+static uint8_t input_buffer[PIN_LENGTH];   // PIN_LETTERS
+static int input_count = 0;
+static bool button_was_pressed = false;
+static bool sampler_running = false;
+static bool tamper_latched = false;        // Alarm started during the cooldown, raised when it ends
+static bool rfid_have_seq = false;
+static uint16_t rfid_last_seq = 0;
+
+// Deferred actions; each is pending while its delay runs
+static wheel_timer_t relock_timer;
+static wheel_timer_t motion_cooldown_timer;
+static wheel_timer_t tamper_cooldown_timer;
+static wheel_timer_t knock_cooldown_timer;
+
+// Door state is shown on the LEDs: green while unlocked, red while locked
+static void set_door_leds(bool unlocked) {
+    led_pattern_set_rest(LED_PATTERN_GREEN, unlocked);
+    led_pattern_set_rest(LED_PATTERN_RED, !unlocked);
+}
+
+static void relock(void* ctx) {
+    (void)ctx;
+    set_door_leds(false);
 }
 
 // Helper to handle unlocking logic (shared by PIN and RFID)
@@ -39,17 +158,272 @@ void perform_unlock(const char* method) {
     
     char udp_msg[64];
     snprintf(udp_msg, sizeof(udp_msg), "Door Unlocked by %s", method);
-    udp_send(udp_msg);
+    send_alert(udp_msg, false);
     
-    // Visual feedback: Green LED on
-    hal_led_red_off(); 
-    hal_led_green_on();
-    sleep(3); 
-    hal_led_green_off(); 
-    hal_led_red_on();
+    // Visual feedback: Green LED on until the relock; another unlock restarts the delay
+    set_door_leds(true);
+    timer_wheel_schedule(&relock_timer, RELOCK_DELAY_MS);
+}
+
+// Unlock if the credential store says so. Returns false if access is denied.
+static bool check_access(const char* method, credential_kind_t kind, const uint8_t* key, int key_len) {
+    const char* label = NULL;
+    credential_result_t result = credential_store_check(kind, key, key_len, time(NULL), &label);
+    if (result == CREDENTIAL_VALID) {
+        char who[64];
+        if (label && label[0]) snprintf(who, sizeof(who), "%s (%s)", method, label);
+        else snprintf(who, sizeof(who), "%s", method);
+        perform_unlock(who);
+        return true;
+    }
+    const char* why = result == CREDENTIAL_EXPIRED ? "expired" :
+                      result == CREDENTIAL_NOT_YET_VALID ? "not yet valid" : "unknown";
+    printf("[ACCESS] DENIED (%s %s%s%s)\n", method, why, label ? ": " : "", label ? label : "");
+    return false;
+}
+
+static long long monotonic_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000LL + ts.tv_nsec / 1000LL;
+}
+
+// edge_us: kernel timestamp of the press (CLOCK_MONOTONIC), or 0 if polled
+static void ring_doorbell(long long edge_us) {
+    printf("[DOORBELL] Button Pressed! Ding Dong!\n");
+    sound_play_doorbell(); 
+    if (edge_us > 0) {
+        printf("[DOORBELL] Edge-to-chime latency: %lld us\n", monotonic_us() - edge_us);
+    }
+    send_alert("Doorbell Button Pressed", true);
+}
+
+// --- A. DOORBELL BUTTON: runs when the kernel queues debounced edges ---
+static void on_button_event(int fd, uint32_t events, void* ctx) {
+    (void)fd; (void)events; (void)ctx;
+    joystick_button_event_t edges[8];
+    int n;
+    while ((n = hal_joystick_read_button_events(edges, 8)) > 0) {
+        for (int i = 0; i < n; i++) {
+            if (edges[i].pressed && !button_was_pressed) {
+                ring_doorbell((long long)(edges[i].timestamp_ns / 1000));
+            }
+            button_was_pressed = edges[i].pressed;
+        }
+    }
+}
+
+// --- B. PIN CODE: one digit per stick press ---
+static void on_gesture(const joystick_gesture_t* g) {
+    if (g->type == JOY_GESTURE_LONG_PRESS && input_count > 0) {
+        printf("[INPUT] PIN entry cleared\n");
+        input_count = 0;
+        led_pattern_flash(LED_PATTERN_RED, 1, 300);
+        return;
+    }
+    if (g->type != JOY_GESTURE_PRESS) return;
+
+    printf("[INPUT] Direction: %d\n", g->dir);
+    input_buffer[input_count++] = PIN_LETTERS[g->dir];
+
+    // Visual feedback
+    led_pattern_hold(LED_PATTERN_RED, false, 100);
+    led_pattern_hold(LED_PATTERN_GREEN, true, 100);
+
+    if (input_count >= PIN_LENGTH) {
+        if (!check_access("PIN", CREDENTIAL_PIN, input_buffer, PIN_LENGTH)) {
+            sound_play_incorrect(); 
+            led_pattern_flash(LED_PATTERN_RED, 3, 500);
+        }
+        input_count = 0; 
+    }
+}
+
+static void feed_joystick(int xv, int yv, uint64_t timestamp_ns) {
+    joystick_gesture_t gestures[2];
+    int n = hal_joystick_gesture_feed(xv, yv, timestamp_ns, gestures, 2);
+    for (int i = 0; i < n; i++) on_gesture(&gestures[i]);
+}
+
+// Empty the sampler ring, feeding every frame to the gesture decoder and the
+// vibration classifier. *tamper / *knock are set if the new frames completed
+// either event.
+static void drain_samples(bool* tamper, bool* knock) {
+    hal_adc_frame_t frames[SAMPLER_BATCH];
+    int n;
+    *tamper = false;
+    *knock = false;
+    while ((n = hal_adc_sampler_read(frames, SAMPLER_BATCH)) > 0) {
+        for (int i = 0; i < n; i++) {
+            const hal_adc_frame_t* f = &frames[i];
+            feed_joystick(f->ch[JOYSTICK_X_CH], f->ch[JOYSTICK_Y_CH], f->timestamp_ns);
+            vibration_event_t ev = vibration_classifier_push(f->ch[ACCEL_X_CH], f->ch[ACCEL_Y_CH], f->ch[ACCEL_Z_CH]);
+            if (ev == VIB_TAMPER) *tamper = true;
+            if (ev == VIB_KNOCK) *knock = true;
+        }
+    }
+}
+
+// --- D. TAMPER, F. KNOCK and the stick: sampled on a timer ---
+// The joystick and accelerometer sit behind SPI ADCs with no interrupt line.
+// The ADC sampler thread reads them at SAMPLER_RATE_HZ; every
+// SAMPLE_PERIOD_MS the frames collected so far are processed here. Without
+// the sampler they are read directly instead.
+static void on_sample_timer(int fd, uint32_t expirations, void* ctx) {
+    (void)fd; (void)expirations; (void)ctx;
+
+    // A. Doorbell button, when edge events are unavailable
+    if (hal_joystick_get_button_fd() < 0) {
+        bool button_is_pressed = hal_joystick_is_pressed();
+        if (button_is_pressed && !button_was_pressed) ring_doorbell(0);
+        button_was_pressed = button_is_pressed;
+    }
+
+    // B. PIN code, D. tamper, F. knock
+    bool tamper, knock = false;
+    if (sampler_running) {
+        drain_samples(&tamper, &knock);
+    } else {
+        int xv, yv;
+        if (hal_joystick_read_raw(&xv, &yv) == 0) feed_joystick(xv, yv, (uint64_t)monotonic_us() * 1000);
+        int x, y, z;
+        Accel_readXYZ(&x, &y, &z);
+        tamper = tamper_detector_push(x, y, z) == TAMPER_START;
+    }
+
+    // D. Tamper detection (alarms no closer than the cooldown). The detectors
+    // only report the start of a bout, so one that starts during the cooldown
+    // is held until the cooldown expires rather than dropped.
+    if (tamper) tamper_latched = true;
+    if (tamper_latched && !timer_wheel_pending(&tamper_cooldown_timer)) {
+        tamper_latched = false;
+        int rms;
+        if (sampler_running) {
+            vibration_stats_t vs;
+            vibration_classifier_get_stats(&vs);
+            rms = vs.rms;
+        } else {
+            tamper_stats_t ts;
+            tamper_detector_get_stats(&ts);
+            rms = ts.rms;
+        }
+        printf("[ALARM] TAMPER DETECTED! Vibration RMS: %d\n", rms);
+        sound_play_alarm();
+        send_alert("TAMPER DETECTED: Device Shaken!", true);
+
+        led_pattern_flash(LED_PATTERN_RED, 5, 500);
+        timer_wheel_schedule(&tamper_cooldown_timer, TAMPER_COOLDOWN_MS);
+    }
+
+    // F. Knocking (sampler only: the direct reads are too slow to see a knock)
+    if (knock && !timer_wheel_pending(&knock_cooldown_timer)) {
+        printf("[KNOCK] Someone is knocking\n");
+        send_alert("Knock Detected at Front Door", false);
+        timer_wheel_schedule(&knock_cooldown_timer, KNOCK_COOLDOWN_MS);
+    }
+}
+
+// --- C. RFID UART LOGIC: runs when the UART has data ---
+static void on_uart_readable(int fd, uint32_t events, void* ctx) {
+    (void)fd; (void)events; (void)ctx;
+    // Frames may arrive split over several reads; only whole, CRC-checked ones come out
+    hal_rfid_frame_t frame;
+    while (hal_rfid_frame_read(&frame) > 0) {
+        if (rfid_have_seq && frame.seq != (uint16_t)(rfid_last_seq + 1)) {
+            printf("[RFID] Sequence jumped %u -> %u (frames lost or bridge restarted)\n", rfid_last_seq, frame.seq);
+        }
+        rfid_have_seq = true;
+        rfid_last_seq = frame.seq;
+
+        if (!check_access("RFID", CREDENTIAL_RFID, frame.uid, frame.uid_len)) {
+            // The UID as credentials.txt wants it, for enrolling the tag
+            char tag[2 * HAL_RFID_MAX_UID + 1];
+            for (int i = 0; i < frame.uid_len; i++) snprintf(tag + 2 * i, 3, "%02X", frame.uid[i]);
+            printf("[ACCESS] Tag: %s\n", tag);
+            sound_play_incorrect();
+            led_pattern_flash(LED_PATTERN_RED, 2, 200);
+        }
+    }
+}
+
+// --- E. MOTION LOGIC: runs when the camera threads report a verdict ---
+static void on_camera_event(int fd, uint32_t events, void* ctx) {
+    (void)fd; (void)events; (void)ctx;
+    // Only report motion if user isn't busy entering a PIN
+    if (camera_poll_motion() && input_count == 0 && !timer_wheel_pending(&motion_cooldown_timer)) {
+        printf("[MOTION] Movement detected!\n");
+        send_alert("Motion Detected at Front Door", true);
+        timer_wheel_schedule(&motion_cooldown_timer, MOTION_COOLDOWN_MS);
+    }
+}
+
+static void on_stats_timer(int fd, uint32_t expirations, void* ctx) {
+    (void)fd; (void)expirations; (void)ctx;
+    camera_print_stats();
+    reactor_print_stats();
+    timer_wheel_print_stats();
+    hal_spi_bus_print_stats();
+    hal_adc_sampler_print_stats();
+    if (hal_uart_get_fd() >= 0) hal_rfid_frame_print_stats();
+    credential_store_print_stats();
+    if (sampler_running) vibration_classifier_print_stats();
+    else tamper_detector_print_stats();
+    unsigned long lost = hal_joystick_get_lost_button_events();
+    if (lost > 0) printf("[DOORBELL] %lu button edges lost to queue overflow\n", lost);
+}
+
+// SIGINT/SIGTERM: the handler only pokes an eventfd (async-signal-safe); the
+// reactor then leaves the loop so everything is cleaned up. A signalfd would
+// need the signals blocked in every thread, and that mask would be inherited
+// by the aplay children that sound_stop() terminates.
+static int shutdown_fd = -1;
+
+static void handle_shutdown_signal(int sig) {
+    (void)sig;
+    uint64_t one = 1;
+    if (write(shutdown_fd, &one, sizeof(one)) < 0) {
+        // Already pending
+    }
+}
+
+static void on_credentials_changed(int fd, uint32_t events, void* ctx) {
+    (void)fd; (void)events; (void)ctx;
+    credential_store_handle_watch();
 }
 
-int main(void) {
+static void on_shutdown(int fd, uint32_t events, void* ctx) {
+    (void)fd; (void)events; (void)ctx;
+    printf("[MAIN] Shutting down\n");
+    reactor_stop();
+}
+
+// Path of `name` in the executable's directory, so files deployed alongside
+// the doorbell are found whichever directory it is started from. Falls back
+// to the working directory if /proc/self/exe cannot be read.
+static void app_file_path(const char* name, char* path, size_t len) {
+    char exe[PATH_MAX];
+    ssize_t n = readlink("/proc/self/exe", exe, sizeof(exe) - 1);
+    char* slash = n > 0 ? memrchr(exe, '/', (size_t)n) : NULL;
+    if (slash) {
+        *slash = '\0';
+        int written = snprintf(path, len, "%s/%s", exe, name);
+        if (written > 0 && (size_t)written < len) return;
+    }
+    snprintf(path, len, "%s", name);
+}
+
+int main(int argc, char* argv[]) {
+    if (argc > 1 && strcmp(argv[1], "--bench") == 0) {
+        return bench_run(argc - 2, argv + 2);
+    }
+    if (argc > 1 && strcmp(argv[1], "--build-credentials") == 0) {
+        if (argc != 4) {
+            fprintf(stderr, "Usage: %s --build-credentials <credentials.txt> <credentials.db>\n", argv[0]);
+            return 1;
+        }
+        return credential_store_build(argv[2], argv[3]) == 0 ? 0 : 1;
+    }
+
     // 1. Initialize HAL and Modules
     hal_led_init();
     camera_init();
@@ -57,142 +431,126 @@ int main(void) {
     sound_init(); 
     Accel_init(); 
 
-    if (hal_joystick_init("/dev/spidev0.0", 250000) != 0) {
+    if (hal_joystick_init(ADC_DEVICE, 250000) != 0) {
         printf("Joystick Init Failed! (Continuing anyway...)\n");
     }
+    joystick_gesture_config_t gesture_config = {
+        .enter_threshold = JOY_ENTER_THRESHOLD,
+        .exit_threshold = JOY_EXIT_THRESHOLD,
+        .debounce_ms = JOY_DEBOUNCE_MS,
+        .hold_ms = JOY_HOLD_MS,
+        .long_press_ms = JOY_LONG_PRESS_MS,
+    };
+    hal_joystick_gesture_init(&gesture_config);
 
     // Initialize UART for RFID
-    if (hal_uart_init(UART_DEVICE, 9600) != 0) {
+    if (hal_uart_init(UART_DEVICE, UART_BAUD) != 0) {
         printf("UART Init Failed! RFID will not work. Check %s permissions/existence.\n", UART_DEVICE);
     }
 
-    // 2. Variables
-    joystick_dir_t input_buffer[PIN_LENGTH];
-    int input_count = 0;
-    long long last_motion_check = 0;
-    bool button_was_pressed = false;
-
-    // Buffer for RFID data
-    char rfid_buffer[64];
-
-    // Accelerometer baseline
-    int last_x = 0, last_y = 0, last_z = 0;
-    Accel_readXYZ(&last_x, &last_y, &last_z); 
-
-    printf("=== BEAGLEY-AI SMART DOORBELL STARTED ===\n");
-    hal_led_red_on(); // Default locked state
+    char credentials_db[PATH_MAX], credentials_txt[PATH_MAX];
+    app_file_path(CREDENTIALS_DB, credentials_db, sizeof(credentials_db));
+    app_file_path(CREDENTIALS_TXT, credentials_txt, sizeof(credentials_txt));
+    if (access(credentials_db, F_OK) != 0 && access(credentials_txt, F_OK) == 0) {
+        credential_store_build(credentials_txt, credentials_db);
+    }
+    if (credential_store_open(credentials_db) != 0) {
+        printf("No credential store! RFID and PIN access disabled until %s is built.\n", credentials_db);
+    }
 
-    // 3. Main Loop
-    while (1) {
-        // --- A. DOORBELL BUTTON ---
-        bool button_is_pressed = hal_joystick_is_pressed();
-        
-        if (button_is_pressed && !button_was_pressed) {
-            printf("[DOORBELL] Button Pressed! Ding Dong!\n");
-            sound_play_doorbell(); 
-            udp_send("Doorbell Button Pressed");
+    // Accelerometer + joystick sampling at a fixed rate on its own thread
+    static const int sampler_channels[] = { ACCEL_X_CH, ACCEL_Y_CH, ACCEL_Z_CH, JOYSTICK_X_CH, JOYSTICK_Y_CH };
+    sampler_running = hal_adc_sampler_start(ADC_DEVICE, SAMPLER_SPI_SPEED, sampler_channels,
+                                            sizeof(sampler_channels) / sizeof(sampler_channels[0]),
+                                            SAMPLER_RATE_HZ) == 0;
+    if (!sampler_running) {
+        printf("ADC Sampler Start Failed! Reading the joystick and accelerometer directly.\n");
+    }
+    if (sampler_running) {
+        vibration_config_t vib_config = {
+            .sample_rate_hz = SAMPLER_RATE_HZ,
+            .min_rms = VIB_MIN_RMS,
+            .knock_hz = VIB_KNOCK_HZ,
+            .knock_band_pct = VIB_KNOCK_BAND_PCT,
+            .impulse_pct = VIB_IMPULSE_PCT,
+            .tamper_ms = VIB_TAMPER_MS,
+        };
+        if (vibration_classifier_init(&vib_config) != 0) {
+            printf("Vibration Classifier Init Failed! Tamper and knock detection disabled.\n");
         }
-        button_was_pressed = button_is_pressed;
-
-        // --- B. PIN CODE LOGIC ---
-        joystick_dir_t dir = hal_joystick_read_direction();
-        
-        if (dir != JOY_NONE && dir != JOY_CENTER) {
-            printf("[INPUT] Direction: %d\n", dir);
-            
-            input_buffer[input_count++] = dir;
-            
-            // Visual feedback
-            hal_led_red_off(); hal_led_green_on();
-            usleep(100000); 
-            hal_led_green_off(); hal_led_red_on();
-
-            hal_joystick_wait_until_released();
-
-            if (input_count >= PIN_LENGTH) {
-                bool correct = true;
-                for(int i=0; i<PIN_LENGTH; i++) {
-                    if(input_buffer[i] != SECRET_PIN[i]) correct = false;
-                }
-
-                if (correct) {
-                    perform_unlock("PIN");
-                } else {
-                    printf("[ACCESS] DENIED (Wrong PIN)\n");
-                    sound_play_incorrect(); 
-                    hal_led_flash_red_n_times(3, 500);
-                }
-                input_count = 0; 
-            }
+    } else {
+        tamper_config_t tamper_config = {
+            .sample_rate_hz = 1000 / SAMPLE_PERIOD_MS,
+            .hpf_ms = TAMPER_HPF_MS,
+            .window_ms = TAMPER_WINDOW_MS,
+            .enter_rms = TAMPER_ENTER_RMS,
+            .exit_rms = TAMPER_EXIT_RMS,
+            .min_duration_ms = TAMPER_MIN_MS,
+        };
+        if (tamper_detector_init(&tamper_config) != 0) {
+            printf("Tamper Detector Init Failed! Tamper detection disabled.\n");
         }
+    }
 
-        // --- C. RFID UART LOGIC ---
-        int bytes_read = hal_uart_read(rfid_buffer, sizeof(rfid_buffer) - 1);
-        if (bytes_read > 0) {
-            rfid_buffer[bytes_read] = '\0'; // Null-terminate
-            
-            // Remove newline characters (\r or \n) sent by Flipper
-            rfid_buffer[strcspn(rfid_buffer, "\r\n")] = 0;
-
-            if (strlen(rfid_buffer) > 0) {
-
-                if (strcmp(rfid_buffer, RFID_SECRET_KEY) == 0) {
-                    perform_unlock("RFID");
-                } else {
-                    printf("[ACCESS] DENIED (Unknown Tag)\n");
-                    sound_play_incorrect();
-                    hal_led_flash_red_n_times(2, 200);
-                }
-            }
-        }
+    // Camera capture + motion analysis run on their own threads
+    if (camera_start(ESP32_IP) != 0) {
+        printf("Camera Start Failed! Motion detection disabled.\n");
+    }
 
-        // --- D. TAMPER DETECTION ---
-        int x, y, z;
-        Accel_readXYZ(&x, &y, &z);
-        int delta = abs(x - last_x) + abs(y - last_y) + abs(z - last_z);
-        
-        if (delta > TAMPER_THRESHOLD) {
-            printf("[ALARM] TAMPER DETECTED! Delta: %d\n", delta);
-            sound_play_alarm();
-            udp_send("TAMPER DETECTED: Device Shaken!");
-            
-            for(int i=0; i<5; i++) {
-                hal_led_red_on(); usleep(50000);
-                hal_led_red_off(); usleep(50000);
-            }
-            hal_led_red_on();
-            
-            sleep(2); 
-            Accel_readXYZ(&last_x, &last_y, &last_z);
-        } else {
-            last_x = x; last_y = y; last_z = z;
-        }
+    // 2. Event sources: the loop sleeps in epoll_wait() until one fires
+    if (reactor_init() != 0) return 1;
 
-        // --- E. MOTION LOGIC ---
-        long long now = current_ms();
-        if (now - last_motion_check > 200) {
-            // Only check motion if user isn't busy entering a PIN
-            if (input_count == 0) {
-                if (camera_capture(ESP32_IP) == 0) {
-                    if (camera_check_motion()) {
-                        printf("[MOTION] Movement detected!\n");
-                        udp_send("Motion Detected at Front Door");
-                        sleep(5); 
-                    }
-                }
-            }
-            last_motion_check = now;
-        }
+    int sample_timer = reactor_add_timer(on_sample_timer, NULL);
+    int stats_timer = reactor_add_timer(on_stats_timer, NULL);
+    if (sample_timer < 0 || stats_timer < 0 || timer_wheel_init(WHEEL_TICK_MS) != 0) return 1;
+    timer_wheel_timer_init(&relock_timer, relock, NULL);
+    timer_wheel_timer_init(&motion_cooldown_timer, NULL, NULL);
+    timer_wheel_timer_init(&tamper_cooldown_timer, NULL, NULL);
+    timer_wheel_timer_init(&knock_cooldown_timer, NULL, NULL);
+    led_pattern_init();
+    reactor_timer_set(sample_timer, SAMPLE_PERIOD_MS, SAMPLE_PERIOD_MS);
+    reactor_timer_set(stats_timer, STATS_PERIOD_MS, STATS_PERIOD_MS);
+
+    if (hal_uart_get_fd() >= 0) reactor_add(hal_uart_get_fd(), EPOLLIN, on_uart_readable, NULL);
+    if (hal_joystick_get_button_fd() >= 0) {
+        reactor_add(hal_joystick_get_button_fd(), EPOLLIN, on_button_event, NULL);
+    }
+    if (camera_get_event_fd() >= 0) reactor_add(camera_get_event_fd(), EPOLLIN, on_camera_event, NULL);
+    if (camera_get_preroll_fd() >= 0) reactor_add(camera_get_preroll_fd(), EPOLLIN, on_preroll_exported, NULL);
+    if (credential_store_get_watch_fd() >= 0) {
+        reactor_add(credential_store_get_watch_fd(), EPOLLIN, on_credentials_changed, NULL);
+    }
 
-        usleep(10000); 
+    shutdown_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (shutdown_fd >= 0 && reactor_add(shutdown_fd, EPOLLIN, on_shutdown, NULL) == 0) {
+        struct sigaction sa = { .sa_handler = handle_shutdown_signal };
+        sigemptyset(&sa.sa_mask);
+        sigaction(SIGINT, &sa, NULL);
+        sigaction(SIGTERM, &sa, NULL);
     }
 
+    printf("=== BEAGLEY-AI SMART DOORBELL STARTED ===\n");
+    set_door_leds(false); // Default locked state
+
+    // 3. Main Loop
+    reactor_run();
+
     // 4. Cleanup
+    led_pattern_cleanup();
+    timer_wheel_cleanup();
+    reactor_cleanup();
+    if (shutdown_fd >= 0) close(shutdown_fd);
+    camera_cleanup();
+    // Alerts still waiting on an export go out with whatever it wrote
+    for (int i = 0; i < pending_alert_count; i++) udp_send(pending_alerts[i].message);
+    pending_alert_count = 0;
+    hal_adc_sampler_stop();
     sound_cleanup();
     Accel_cleanup();
     hal_joystick_cleanup();
     hal_led_cleanup();
     hal_uart_cleanup(); 
+    credential_store_close();
     udp_cleanup();
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,131 @@
+#include "tamper_detector.h"
+#include "isqrt.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#define MAX_WINDOW 2048 // Samples; 1 s at 2 kHz
+#define MAX_HPF_SHIFT 14
+#define FRAC_BITS 16    // Filter state is Q16 ADC counts (12-bit samples fit in int32)
+
+typedef enum { STATE_IDLE, STATE_ACTIVE } detector_state_t;
+
+static uint32_t energy[MAX_WINDOW]; // Per-sample vibration energy, ring
+static int window = 0;
+static int pos = 0;
+static int filled = 0;
+static uint64_t energy_sum = 0;
+
+static int hpf_shift = 0;
+static int32_t gravity[3];          // Low-passed axes, Q16
+static bool primed = false;
+
+static uint64_t enter_sum = 0;      // enter_rms^2 * window
+static uint64_t exit_sum = 0;
+static int min_samples = 0;
+static int above = 0;               // Consecutive samples above enter level
+static detector_state_t state = STATE_IDLE;
+
+static tamper_stats_t stats;
+static uint64_t peak_sum = 0;
+
+static int ms_to_samples(int ms, int rate_hz)
+{
+    long n = (long)ms * rate_hz / 1000;
+    return n > 0 ? (int)n : 1;
+}
+
+int tamper_detector_init(const tamper_config_t* config)
+{
+    if (config->sample_rate_hz <= 0 || config->enter_rms <= 0 ||
+        config->exit_rms < 0 || config->exit_rms >= config->enter_rms) {
+        return -1;
+    }
+    int w = ms_to_samples(config->window_ms, config->sample_rate_hz);
+    if (w > MAX_WINDOW) return -1;
+
+    // Smallest shift whose time constant (2^shift samples) covers hpf_ms
+    int tau = ms_to_samples(config->hpf_ms, config->sample_rate_hz);
+    int shift = 1;
+    while (shift < MAX_HPF_SHIFT && (1 << shift) < tau) shift++;
+
+    memset(energy, 0, sizeof(energy));
+    window = w;
+    pos = filled = 0;
+    energy_sum = 0;
+    hpf_shift = shift;
+    primed = false;
+    enter_sum = (uint64_t)config->enter_rms * config->enter_rms * w;
+    exit_sum = (uint64_t)config->exit_rms * config->exit_rms * w;
+    min_samples = ms_to_samples(config->min_duration_ms, config->sample_rate_hz);
+    above = 0;
+    state = STATE_IDLE;
+    memset(&stats, 0, sizeof(stats));
+    peak_sum = 0;
+    return 0;
+}
+
+// One high-pass step: returns the vibration component in ADC counts
+static int32_t high_pass(int axis, int sample)
+{
+    int32_t v = sample * (1 << FRAC_BITS);
+    // Division rather than >> keeps it well-defined for negative values
+    gravity[axis] += (v - gravity[axis]) / (1 << hpf_shift);
+    return (v - gravity[axis]) / (1 << FRAC_BITS);
+}
+
+tamper_event_t tamper_detector_push(int x, int y, int z)
+{
+    if (window == 0) return TAMPER_NONE;
+    if (!primed) {
+        // Start the filter at rest so the first samples are not a step input
+        gravity[0] = x * (1 << FRAC_BITS);
+        gravity[1] = y * (1 << FRAC_BITS);
+        gravity[2] = z * (1 << FRAC_BITS);
+        primed = true;
+    }
+
+    int32_t hx = high_pass(0, x), hy = high_pass(1, y), hz = high_pass(2, z);
+    uint32_t e = (uint32_t)(hx * hx) + (uint32_t)(hy * hy) + (uint32_t)(hz * hz);
+    energy_sum += e;
+    energy_sum -= energy[pos];
+    energy[pos] = e;
+    if (++pos == window) pos = 0;
+    stats.samples++;
+    if (filled < window) {
+        filled++;
+        return TAMPER_NONE;
+    }
+    if (energy_sum > peak_sum) peak_sum = energy_sum;
+
+    if (state == STATE_IDLE) {
+        above = energy_sum > enter_sum ? above + 1 : 0;
+        if (above >= min_samples) {
+            state = STATE_ACTIVE;
+            stats.alarms++;
+            return TAMPER_START;
+        }
+    } else if (energy_sum < exit_sum) {
+        state = STATE_IDLE;
+        above = 0;
+        return TAMPER_END;
+    }
+    return TAMPER_NONE;
+}
+
+void tamper_detector_get_stats(tamper_stats_t* out)
+{
+    *out = stats;
+    out->active = state == STATE_ACTIVE;
+    out->rms = window ? isqrt64(energy_sum / window) : 0;
+    out->peak_rms = window ? isqrt64(peak_sum / window) : 0;
+}
+
+void tamper_detector_print_stats(void)
+{
+    tamper_stats_t s;
+    tamper_detector_get_stats(&s);
+    printf("[TAMPER] RMS %d (peak %d), %lu alarms, %s\n", s.rms, s.peak_rms, s.alarms,
+           s.active ? "vibrating" : "quiet");
+    peak_sum = 0;
+}
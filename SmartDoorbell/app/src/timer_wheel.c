@@ -0,0 +1,260 @@
+#define _GNU_SOURCE
+#include "timer_wheel.h"
+#include "reactor.h"
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/timerfd.h>
+
+// Four levels of 64 slots. Level 0 holds timers due within 64 ticks, one tick
+// per slot; each level above covers 64 times the span of the one below and is
+// cascaded down a slot at a time as the wheel turns. With 10 ms ticks the
+// wheel reaches 2^24 ticks (46 h); longer delays are clamped.
+#define LEVELS 4
+#define SLOT_BITS 6
+#define SLOTS (1 << SLOT_BITS)
+#define SLOT_MASK (SLOTS - 1)
+#define MAX_DELAY_TICKS ((1ULL << (LEVELS * SLOT_BITS)) - 1)
+#define NO_EXPIRY UINT64_MAX
+
+static wheel_timer_t* wheel[LEVELS][SLOTS];
+static uint64_t occupied[LEVELS]; // Bit per non-empty slot
+static uint64_t now_tick = 0;     // Next tick to be processed
+static uint64_t armed_tick = NO_EXPIRY;
+static long long origin_ms = 0;   // CLOCK_MONOTONIC time of tick 0
+static int tick = 0;
+static int timer_fd = -1;
+static bool dispatching = false;
+static timer_wheel_stats_t stats;
+
+static long long monotonic_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000LL + ts.tv_nsec / 1000000LL;
+}
+
+static uint64_t clock_tick(void)
+{
+    return (uint64_t)(monotonic_ms() - origin_ms) / tick;
+}
+
+// Distance from slot `from` to the first occupied slot at or after it
+static int first_occupied(uint64_t bits, int from)
+{
+    uint64_t rotated = from ? (bits >> from) | (bits << (SLOTS - from)) : bits;
+    return __builtin_ctzll(rotated);
+}
+
+static void link_timer(wheel_timer_t* t)
+{
+    // Callers guarantee expires >= now_tick
+    uint64_t delta = t->expires - now_tick;
+    if (delta > MAX_DELAY_TICKS) {
+        delta = MAX_DELAY_TICKS;
+        t->expires = now_tick + delta;
+    }
+    int level = 0;
+    while (level < LEVELS - 1 && delta >= (1ULL << ((level + 1) * SLOT_BITS))) level++;
+    int slot = (t->expires >> (level * SLOT_BITS)) & SLOT_MASK;
+
+    wheel_timer_t** head = &wheel[level][slot];
+    t->next = *head;
+    if (t->next) t->next->pprev = &t->next;
+    *head = t;
+    t->pprev = head;
+    t->level = level;
+    t->slot = slot;
+    occupied[level] |= 1ULL << slot;
+}
+
+static void unlink_timer(wheel_timer_t* t)
+{
+    *t->pprev = t->next;
+    if (t->next) t->next->pprev = t->pprev;
+    if (t->level >= 0 && !wheel[t->level][t->slot]) occupied[t->level] &= ~(1ULL << t->slot);
+    t->next = NULL;
+    t->pprev = NULL;
+}
+
+// Take a slot's whole list; the entries stay cancellable while it is walked
+static wheel_timer_t* detach_slot(int level, int slot, wheel_timer_t** list)
+{
+    *list = wheel[level][slot];
+    wheel[level][slot] = NULL;
+    occupied[level] &= ~(1ULL << slot);
+    for (wheel_timer_t* t = *list; t; t = t->next) t->level = -1;
+    if (*list) (*list)->pprev = list;
+    return *list;
+}
+
+static void cascade(int level, int slot)
+{
+    wheel_timer_t* list;
+    detach_slot(level, slot, &list);
+    while (list) {
+        wheel_timer_t* t = list;
+        unlink_timer(t);
+        link_timer(t);
+        stats.cascaded++;
+    }
+}
+
+static void run_tick(void)
+{
+    int slot = now_tick & SLOT_MASK;
+    // Level 0 has wrapped: pull the next slot of each level above down
+    if (slot == 0) {
+        for (int level = 1; level < LEVELS; level++) {
+            int upper = (now_tick >> (level * SLOT_BITS)) & SLOT_MASK;
+            cascade(level, upper);
+            if (upper != 0) break;
+        }
+    }
+
+    wheel_timer_t* list;
+    if (!detach_slot(0, slot, &list)) {
+        now_tick++;
+        return;
+    }
+    long long late = monotonic_ms() - (origin_ms + (long long)now_tick * tick);
+    if (late > stats.max_late_ms) stats.max_late_ms = late;
+    now_tick++;
+    while (list) {
+        wheel_timer_t* t = list;
+        unlink_timer(t);
+        stats.pending--;
+        stats.fired++;
+        if (t->fn) t->fn(t->ctx);
+    }
+}
+
+// Earliest tick at which a timer fires or a cascade is due
+static uint64_t next_event(void)
+{
+    uint64_t best = NO_EXPIRY;
+    if (occupied[0]) best = now_tick + first_occupied(occupied[0], now_tick & SLOT_MASK);
+    for (int level = 1; level < LEVELS; level++) {
+        if (!occupied[level]) continue;
+        int shift = level * SLOT_BITS;
+        uint64_t boundary = ((now_tick + (1ULL << shift) - 1) >> shift) << shift;
+        int from = (boundary >> shift) & SLOT_MASK;
+        uint64_t t = boundary + ((uint64_t)first_occupied(occupied[level], from) << shift);
+        if (t < best) best = t;
+    }
+    return best;
+}
+
+static void arm(uint64_t at)
+{
+    struct itimerspec its;
+    memset(&its, 0, sizeof(its));
+    if (at != NO_EXPIRY) {
+        long long ms = origin_ms + (long long)at * tick;
+        its.it_value.tv_sec = ms / 1000;
+        its.it_value.tv_nsec = (ms % 1000) * 1000000L;
+    }
+    if (timerfd_settime(timer_fd, TFD_TIMER_ABSTIME, &its, NULL) != 0) {
+        perror("Error arming timer wheel");
+        return;
+    }
+    armed_tick = at;
+}
+
+static void on_wheel_timer(int fd, uint32_t expirations, void* ctx)
+{
+    (void)fd; (void)expirations; (void)ctx;
+    stats.wakeups++;
+    armed_tick = NO_EXPIRY;
+    dispatching = true;
+    uint64_t target = clock_tick();
+    while (now_tick <= target && stats.pending > 0) {
+        // Skip straight to the next tick with work; nothing happens in between
+        uint64_t next = next_event();
+        if (next > target) break;
+        if (next > now_tick) now_tick = next;
+        run_tick();
+    }
+    dispatching = false;
+    uint64_t next = stats.pending > 0 ? next_event() : NO_EXPIRY;
+    if (next != NO_EXPIRY) arm(next);
+}
+
+int timer_wheel_init(int tick_ms)
+{
+    if (tick_ms <= 0 || timer_fd >= 0) return -1;
+    timer_fd = reactor_add_timer(on_wheel_timer, NULL);
+    if (timer_fd < 0) return -1;
+    tick = tick_ms;
+    origin_ms = monotonic_ms();
+    now_tick = 0;
+    armed_tick = NO_EXPIRY;
+    memset(wheel, 0, sizeof(wheel));
+    memset(occupied, 0, sizeof(occupied));
+    memset(&stats, 0, sizeof(stats));
+    return 0;
+}
+
+void timer_wheel_timer_init(wheel_timer_t* t, timer_wheel_fn fn, void* ctx)
+{
+    memset(t, 0, sizeof(*t));
+    t->fn = fn;
+    t->ctx = ctx;
+}
+
+void timer_wheel_schedule(wheel_timer_t* t, int delay_ms)
+{
+    if (timer_fd < 0) return;
+    timer_wheel_cancel(t);
+
+    long long elapsed = monotonic_ms() - origin_ms;
+    // An empty wheel has not been turning; bring it up to date first
+    if (stats.pending == 0 && !dispatching) now_tick = (uint64_t)elapsed / tick;
+    // First tick boundary at least delay_ms from now
+    if (delay_ms < 0) delay_ms = 0;
+    t->expires = (uint64_t)(elapsed + delay_ms + tick - 1) / tick;
+    if (t->expires < now_tick) t->expires = now_tick;
+    link_timer(t);
+    stats.scheduled++;
+    stats.pending++;
+
+    if (!dispatching && t->expires < armed_tick) arm(next_event());
+}
+
+void timer_wheel_cancel(wheel_timer_t* t)
+{
+    if (!t->pprev) return;
+    // The timerfd stays armed; a wakeup with nothing due just re-arms it
+    unlink_timer(t);
+    stats.pending--;
+    stats.cancelled++;
+}
+
+bool timer_wheel_pending(const wheel_timer_t* t)
+{
+    return t->pprev != NULL;
+}
+
+void timer_wheel_get_stats(timer_wheel_stats_t* out)
+{
+    *out = stats;
+}
+
+void timer_wheel_print_stats(void)
+{
+    printf("[WHEEL] %lu pending, %lu fired, %lu cancelled, %lu cascaded, %lu wakeups, max late %ld ms\n",
+           stats.pending, stats.fired, stats.cancelled, stats.cascaded, stats.wakeups, stats.max_late_ms);
+}
+
+void timer_wheel_cleanup(void)
+{
+    for (int level = 0; level < LEVELS; level++) {
+        for (int slot = 0; slot < SLOTS; slot++) {
+            while (wheel[level][slot]) unlink_timer(wheel[level][slot]);
+        }
+    }
+    stats.pending = 0;
+    if (timer_fd >= 0) reactor_remove(timer_fd);
+    timer_fd = -1;
+}
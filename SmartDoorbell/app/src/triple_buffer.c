@@ -0,0 +1,46 @@
+#include "triple_buffer.h"
+
+#define FRESH_BIT  0x4u
+#define INDEX_MASK 0x3u
+
+void triple_buffer_init(triple_buffer_t* tb)
+{
+    tb->back = 0;
+    atomic_init(&tb->middle, 1u);
+    tb->front = 2;
+}
+
+unsigned int triple_buffer_write_index(const triple_buffer_t* tb)
+{
+    return tb->back;
+}
+
+bool triple_buffer_publish(triple_buffer_t* tb)
+{
+    // Release: the slot contents must be visible before the reader can take it
+    unsigned int prev = atomic_exchange_explicit(&tb->middle, tb->back | FRESH_BIT,
+                                                 memory_order_acq_rel);
+    tb->back = prev & INDEX_MASK;
+    return (prev & FRESH_BIT) != 0;
+}
+
+bool triple_buffer_acquire(triple_buffer_t* tb)
+{
+    if ((atomic_load_explicit(&tb->middle, memory_order_relaxed) & FRESH_BIT) == 0) {
+        return false;
+    }
+    // Acquire: pairs with the writer's release in triple_buffer_publish()
+    unsigned int prev = atomic_exchange_explicit(&tb->middle, tb->front, memory_order_acq_rel);
+    tb->front = prev & INDEX_MASK;
+    return true;
+}
+
+bool triple_buffer_pending(const triple_buffer_t* tb)
+{
+    return (atomic_load_explicit(&tb->middle, memory_order_acquire) & FRESH_BIT) != 0;
+}
+
+unsigned int triple_buffer_read_index(const triple_buffer_t* tb)
+{
+    return tb->front;
+}
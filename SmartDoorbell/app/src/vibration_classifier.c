@@ -0,0 +1,180 @@
+#include "vibration_classifier.h"
+#include "isqrt.h"
+#include "fft_q15.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+#define AXES 3
+#define FFT_LIMIT 16384 // Largest input magnitude the FFT takes
+
+static int16_t ring[AXES][VIB_WINDOW];
+static int pos = 0;
+static int filled = 0;
+static int since_analysis = 0;
+
+static const fft_q15_t* fft = NULL;
+static int16_t hann[VIB_WINDOW];      // Q15
+static int knock_bin = 0;             // First FFT bin of the knock band
+static uint64_t min_energy = 0;       // min_rms^2 * VIB_WINDOW
+static int knock_band_pct = 0;
+static int impulse_pct = 0;
+static int tamper_windows = 0;
+
+static int sustained = 0;             // Consecutive sustained windows
+static bool tamper_active = false;
+static int knock_holdoff = 0;         // Windows until the last knock has left the window
+
+static vibration_stats_t stats;
+
+int vibration_classifier_init(const vibration_config_t* config)
+{
+    if (config->sample_rate_hz <= 0 || config->min_rms <= 0 || config->knock_hz <= 0 ||
+        config->knock_band_pct < 0 || config->knock_band_pct > 100 ||
+        config->impulse_pct < 0 || config->impulse_pct > 100) {
+        return -1;
+    }
+    // Bin k is centred on k * rate / VIB_WINDOW Hz
+    int bin = (int)(((long)config->knock_hz * VIB_WINDOW + config->sample_rate_hz - 1) / config->sample_rate_hz);
+    if (bin < 1 || bin > VIB_WINDOW / 2) return -1;
+
+    for (int i = 0; i < VIB_WINDOW; i++) {
+        hann[i] = (int16_t)lrint(16383.5 * (1.0 - cos(2.0 * M_PI * i / VIB_WINDOW)));
+    }
+    fft = fft_q15_get();
+    knock_bin = bin;
+    min_energy = (uint64_t)config->min_rms * config->min_rms * VIB_WINDOW;
+    knock_band_pct = config->knock_band_pct;
+    impulse_pct = config->impulse_pct;
+    long tamper_samples = (long)config->tamper_ms * config->sample_rate_hz / 1000;
+    tamper_windows = (int)((tamper_samples + VIB_HOP - 1) / VIB_HOP);
+    if (tamper_windows < 1) tamper_windows = 1;
+
+    memset(ring, 0, sizeof(ring));
+    pos = filled = since_analysis = 0;
+    sustained = 0;
+    tamper_active = false;
+    knock_holdoff = 0;
+    memset(&stats, 0, sizeof(stats));
+    return 0;
+}
+
+// Share of the window's energy above knock_bin, from the FFT of each axis.
+// The window is scaled up to the FFT's input range first; only the ratio matters.
+static int knock_band_share(int32_t dev[AXES][VIB_WINDOW], int32_t max_abs)
+{
+    int shift = 0;
+    while (max_abs > 0 && (max_abs << (shift + 1)) <= FFT_LIMIT) shift++;
+
+    int16_t re[VIB_WINDOW], im[VIB_WINDOW];
+    uint64_t band = 0, total = 0;
+    for (int a = 0; a < AXES; a++) {
+        for (int i = 0; i < VIB_WINDOW; i++) {
+            re[i] = (int16_t)((dev[a][i] * (1 << shift) * hann[i]) >> 15);
+            im[i] = 0;
+        }
+        fft->fft(re, im, VIB_WINDOW_LOG2);
+        // Real input: bins above VIB_WINDOW / 2 mirror these
+        for (int k = 1; k <= VIB_WINDOW / 2; k++) {
+            uint32_t p = (uint32_t)(re[k] * re[k]) + (uint32_t)(im[k] * im[k]);
+            total += p;
+            if (k >= knock_bin) band += p;
+        }
+    }
+    return total ? (int)(band * 100 / total) : 0;
+}
+
+static vibration_event_t analyse(void)
+{
+    // Oldest sample first, with each axis's mean (gravity and tilt) removed
+    int32_t dev[AXES][VIB_WINDOW];
+    int32_t max_abs = 0;
+    for (int a = 0; a < AXES; a++) {
+        int32_t sum = 0;
+        for (int i = 0; i < VIB_WINDOW; i++) {
+            dev[a][i] = ring[a][(pos + i) & (VIB_WINDOW - 1)];
+            sum += dev[a][i];
+        }
+        int32_t mean = sum / VIB_WINDOW;
+        for (int i = 0; i < VIB_WINDOW; i++) {
+            dev[a][i] -= mean;
+            int32_t m = dev[a][i] < 0 ? -dev[a][i] : dev[a][i];
+            if (m > max_abs) max_abs = m;
+        }
+    }
+
+    // Total energy, and the most of it inside any VIB_BLOCK consecutive samples
+    uint32_t energy[VIB_WINDOW];
+    uint64_t total = 0, block = 0, block_max = 0;
+    int block_mid = 0;
+    for (int i = 0; i < VIB_WINDOW; i++) {
+        energy[i] = (uint32_t)(dev[0][i] * dev[0][i]) + (uint32_t)(dev[1][i] * dev[1][i]) +
+                    (uint32_t)(dev[2][i] * dev[2][i]);
+        total += energy[i];
+        block += energy[i];
+        if (i >= VIB_BLOCK) block -= energy[i - VIB_BLOCK];
+        if (block > block_max) {
+            block_max = block;
+            block_mid = i - VIB_BLOCK / 2;
+        }
+    }
+
+    stats.windows++;
+    if (knock_holdoff > 0) knock_holdoff--;
+    if (total < min_energy) {
+        sustained = 0;
+        tamper_active = false;
+        return VIB_NONE;
+    }
+
+    int impulse = (int)(block_max * 100 / total);
+    int band = knock_band_share(dev, max_abs);
+    stats.rms = isqrt64(total / VIB_WINDOW);
+    stats.knock_band_pct = band;
+    stats.impulse_pct = impulse;
+
+    if (impulse >= impulse_pct) {
+        // An impulse is judged while it is in the middle half of the window,
+        // where the Hann window keeps its energy; that is two windows at
+        // most, and the holdoff reports it once
+        bool centred = block_mid >= VIB_WINDOW / 4 && block_mid < VIB_WINDOW * 3 / 4;
+        if (centred && band >= knock_band_pct && knock_holdoff == 0) {
+            knock_holdoff = VIB_WINDOW / VIB_HOP;
+            stats.knocks++;
+            return VIB_KNOCK;
+        }
+        return VIB_NONE;
+    }
+    if (++sustained >= tamper_windows && !tamper_active) {
+        tamper_active = true;
+        stats.tampers++;
+        return VIB_TAMPER;
+    }
+    return VIB_NONE;
+}
+
+vibration_event_t vibration_classifier_push(int x, int y, int z)
+{
+    if (!fft) return VIB_NONE;
+    ring[0][pos] = (int16_t)x;
+    ring[1][pos] = (int16_t)y;
+    ring[2][pos] = (int16_t)z;
+    pos = (pos + 1) & (VIB_WINDOW - 1);
+    if (filled < VIB_WINDOW) filled++;
+    if (++since_analysis < VIB_HOP || filled < VIB_WINDOW) return VIB_NONE;
+    since_analysis = 0;
+    return analyse();
+}
+
+void vibration_classifier_get_stats(vibration_stats_t* out)
+{
+    *out = stats;
+}
+
+void vibration_classifier_print_stats(void)
+{
+    printf("[VIBRATION] %lu windows, %lu knocks, %lu tamper; last active: RMS %d, "
+           "%d%% in knock band, %d%% in one block\n",
+           stats.windows, stats.knocks, stats.tampers, stats.rms, stats.knock_band_pct, stats.impulse_pct);
+}
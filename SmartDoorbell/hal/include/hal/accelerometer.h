@@ -1,6 +1,11 @@
 #ifndef ACCELEROMETER_H_
 #define ACCELEROMETER_H_
 
+// ADC channels of each axis, for consumers of hal/adc_sampler.h frames
+#define ACCEL_X_CH 2
+#define ACCEL_Y_CH 1
+#define ACCEL_Z_CH 0
+
 // Initialize accelerometer logic (no hardware init needed, relies on ADC)
 void Accel_init(void);
 
@@ -0,0 +1,50 @@
+#ifndef HAL_ADC_SAMPLER_H
+#define HAL_ADC_SAMPLER_H
+
+#include <stdint.h>
+
+// Fixed-rate ADC sampling on a background thread. The thread wakes on an
+// absolute CLOCK_MONOTONIC schedule, reads every configured channel in one
+// SPI transaction (through hal/spi_bus.h) and pushes a timestamped frame into
+// a single-producer/single-consumer ring. One consumer thread drains it with
+// hal_adc_sampler_read(), which takes no locks.
+//
+// If the kernel's mcp320x IIO driver owns the ADC instead of spidev, the
+// sampler uses that (hal/spi_adc.h): an hrtimer trigger paces the kernel's
+// conversions and the thread moves the queued frames into the same ring.
+
+#define HAL_ADC_CHANNELS 8 // MCP3208
+
+typedef struct {
+    uint64_t timestamp_ns;            // CLOCK_MONOTONIC, taken before the transfer
+    uint32_t seq;                     // Frame number; gaps mean dropped frames
+    uint16_t ch[HAL_ADC_CHANNELS];    // Indexed by ADC channel; unsampled channels are 0
+} hal_adc_frame_t;
+
+typedef struct {
+    int rate_hz;
+    unsigned long frames;        // Frames sampled
+    unsigned long dropped;       // Frames lost because the ring was full
+    unsigned long missed;        // Sample periods skipped because the thread woke too late (spidev)
+    unsigned long errors;        // Failed SPI transactions or IIO reads
+    double jitter_mean_us;       // Wake-up delay after the scheduled time (spidev)
+    double jitter_max_us;
+} hal_adc_sampler_stats_t;
+
+// Start sampling channels `chs` of the ADC at `rate_hz`, through IIO if the
+// kernel driver owns it and otherwise through spidev `device` at `speed_hz`.
+// Returns 0 on success, -1 on failure.
+int hal_adc_sampler_start(const char *device, uint32_t speed_hz, const int *chs, int n, int rate_hz);
+
+// Move up to `max` frames (oldest first) out of the ring. Returns the number
+// copied, 0 if none are ready or the sampler is not running.
+int hal_adc_sampler_read(hal_adc_frame_t *frames, int max);
+
+void hal_adc_sampler_get_stats(hal_adc_sampler_stats_t *stats);
+
+// Rates, jitter and overruns since the previous call
+void hal_adc_sampler_print_stats(void);
+
+void hal_adc_sampler_stop(void);
+
+#endif
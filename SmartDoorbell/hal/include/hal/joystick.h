@@ -13,6 +13,10 @@ typedef enum {
     JOY_CENTER
 } joystick_dir_t;
 
+// ADC channels of the stick axes, for consumers of hal/adc_sampler.h frames
+#define JOYSTICK_X_CH 6
+#define JOYSTICK_Y_CH 7
+
 // Initialize joystick (SPI for directions, libgpiod for button)
 // Returns 0 on success, -1 on failure
 int hal_joystick_init(const char *spi_device, uint32_t spi_speed_hz);
@@ -22,14 +26,68 @@ void hal_joystick_cleanup(void);
 // Read direction of joystick stick
 joystick_dir_t hal_joystick_read_direction(void);
 
-// Wait until joystick stick is released to center
-void hal_joystick_wait_until_released(void);
-
 // Read raw ADC values (helper)
 int hal_joystick_read_raw(int *x_out, int *y_out);
 
+// Map raw ADC values (e.g. from a sampler frame) to a direction
+joystick_dir_t hal_joystick_direction_from_raw(int xv, int yv);
+
+// --- Stick gestures ---
+// A direction is pressed once the stick is deflected past enter_threshold
+// (ADC counts from the calibrated center, along the dominant axis) for
+// debounce_ms, and released once that axis falls back inside exit_threshold
+// for debounce_ms. The gap between the two thresholds keeps a stick resting
+// near the edge from chattering, so each deflection is exactly one press.
+typedef enum {
+    JOY_GESTURE_PRESS = 1,   // Stick deflected
+    JOY_GESTURE_HOLD,        // Still deflected; every hold_ms
+    JOY_GESTURE_LONG_PRESS,  // Deflected for long_press_ms (once per press)
+    JOY_GESTURE_RELEASE      // Back to center
+} joystick_gesture_type_t;
+
+typedef struct {
+    joystick_gesture_type_t type;
+    joystick_dir_t dir;
+    uint64_t timestamp_ns;   // When it happened (a release: when the stick came back)
+    int held_ms;             // Time since the press
+} joystick_gesture_t;
+
+typedef struct {
+    int enter_threshold;
+    int exit_threshold;      // Below enter_threshold
+    int debounce_ms;
+    int hold_ms;
+    int long_press_ms;
+} joystick_gesture_config_t;
+
+// Reset the gesture decoder. Returns 0, or -1 if the configuration is invalid.
+int hal_joystick_gesture_init(const joystick_gesture_config_t *config);
+
+// Feed one raw sample with its CLOCK_MONOTONIC timestamp (samples in time
+// order). Never blocks. Returns the number of gestures written to `out`
+// (at most 2: a hold and the long press can fall on the same sample).
+int hal_joystick_gesture_feed(int xv, int yv, uint64_t timestamp_ns, joystick_gesture_t *out, int max);
+
 // Check if the joystick button (SEL) is pressed
 // Returns true (1) if pressed, false (0) otherwise
 bool hal_joystick_is_pressed(void);
 
+// One debounced edge of the joystick button
+typedef struct {
+    bool pressed;            // true on press (falling edge), false on release
+    uint64_t timestamp_ns;   // Kernel timestamp of the edge (CLOCK_MONOTONIC)
+    unsigned long seqno;     // Per-line sequence number
+} joystick_button_event_t;
+
+// Pollable fd that becomes readable when button edges are queued in the
+// kernel. Returns -1 if the button line is not available.
+int hal_joystick_get_button_fd(void);
+
+// Read up to max_events queued button edges (oldest first) without blocking.
+// Returns the number read (0 if none), or -1 on error.
+int hal_joystick_read_button_events(joystick_button_event_t *events, int max_events);
+
+// Edges dropped because the kernel queue overflowed (gaps in seqno)
+unsigned long hal_joystick_get_lost_button_events(void);
+
 #endif
\ No newline at end of file
@@ -3,9 +3,26 @@
 
 #include <stdbool.h>
 
+#define HAL_LED_SYSFS_DIR "/sys/class/leds"
+
+typedef enum {
+    HAL_LED_GREEN = 0,   // ACT
+    HAL_LED_RED,         // PWR
+    HAL_LED_COUNT
+} hal_led_t;
+
 void hal_led_init(void);
+
+// Same, for the LEDs under another directory (e.g. a fake sysfs tree).
+// Returns 0, or -1 if a brightness file cannot be opened.
+int hal_led_init_at(const char *leds_dir);
+
 void hal_led_cleanup(void);
 
+// Steady on/off; stops any blinking the kernel is doing for the LED.
+// One pwrite() on an fd kept open since init.
+void hal_led_set(hal_led_t led, bool on);
+
 //leds on or off
 void hal_led_green_on(void);
 void hal_led_green_off(void);
@@ -15,9 +32,18 @@ void hal_led_red_off(void);
 
 void hal_led_all_off(void);
 
-//flashing for correct of incorrect answer
+// Blinking run by the kernel's LED triggers, so it costs no wakeups here.
+// Both return -1 if the trigger is not available for the LED; the caller
+// then has to toggle it itself.
+
+// Blink until the next hal_led_set() ("timer" trigger)
+int hal_led_blink(hal_led_t led, int on_ms, int off_ms);
+
+// `n` on/off cycles, ending off ("pattern" trigger)
+int hal_led_flash(hal_led_t led, int n, int on_ms, int off_ms);
+
+//flashing for correct of incorrect answer (blocks unless the kernel flashes the LED)
 void hal_led_flash_green_n_times(int n, long total_ms);
 void hal_led_flash_red_n_times(int n, long total_ms);
 
-#endif 
-
+#endif
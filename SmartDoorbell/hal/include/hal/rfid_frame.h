@@ -0,0 +1,71 @@
+#ifndef HAL_RFID_FRAME_H
+#define HAL_RFID_FRAME_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Binary RFID frames from the Flipper bridge (smart_doorbell_flipper/rfid_frame.c
+// encodes the same format). Multi-byte fields are little-endian:
+//
+//   sync    0xA5
+//   len     bytes from proto to seq: HAL_RFID_FIXED_LEN + UID length
+//   proto   Flipper LFRFID protocol of the tag
+//   uid     1..HAL_RFID_MAX_UID bytes
+//   time    u32, Flipper tick (ms) when the tag was read
+//   seq     u16, +1 per frame sent
+//   crc     u16, CRC-16/CCITT-FALSE over len..seq
+//
+// Frames are self-delimiting, so a sender may batch several into one write.
+// Anything else on the line (noise, a cut-off frame) is skipped a byte at a
+// time until the next sync byte that starts a frame with a valid CRC.
+#define HAL_RFID_SYNC 0xA5
+#define HAL_RFID_MAX_UID 16
+#define HAL_RFID_FIXED_LEN 7   // proto + time + seq
+#define HAL_RFID_OVERHEAD 4    // sync + len + crc
+#define HAL_RFID_MAX_FRAME (HAL_RFID_OVERHEAD + HAL_RFID_FIXED_LEN + HAL_RFID_MAX_UID)
+
+typedef struct {
+    uint8_t protocol;
+    uint8_t uid_len;
+    const uint8_t* uid;        // Points into the receive buffer (see below)
+    uint32_t timestamp_ms;
+    uint16_t seq;
+} hal_rfid_frame_t;
+
+typedef struct {
+    unsigned long frames;      // Valid frames handed out
+    unsigned long crc_errors;  // Candidate frames whose CRC did not match
+    unsigned long skipped_bytes; // Bytes dropped while looking for a frame
+} hal_rfid_frame_stats_t;
+
+// CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF), one table lookup per byte
+uint16_t hal_rfid_crc16(const uint8_t* data, size_t len);
+
+// Encode `frame` into `out` (at least HAL_RFID_MAX_FRAME bytes).
+// Returns the frame length, or -1 if the UID length is out of range.
+int hal_rfid_frame_encode(uint8_t* out, const hal_rfid_frame_t* frame);
+
+// Forget any buffered bytes and zero the statistics
+void hal_rfid_frame_reset(void);
+
+// Zero-copy receive: read() straight into the space returned (`*room` bytes),
+// then commit what was read. Returns NULL if the buffer is full, which only
+// happens if the caller stops taking frames.
+uint8_t* hal_rfid_rx_space(size_t* room);
+void hal_rfid_rx_commit(size_t len);
+
+// Next complete frame in the buffer: 1 if one was found, 0 if more bytes are
+// needed. frame->uid stays valid until the next hal_rfid_rx_space() or
+// hal_rfid_frame_read().
+int hal_rfid_frame_next(hal_rfid_frame_t* frame);
+
+// Read whatever the UART (hal_uart_get_fd()) has and return the next frame.
+// Returns 1, 0 if there is none yet, -1 on error.
+// Do not mix with the other UART reads on the same port.
+int hal_rfid_frame_read(hal_rfid_frame_t* frame);
+
+void hal_rfid_frame_get_stats(hal_rfid_frame_stats_t* stats);
+
+void hal_rfid_frame_print_stats(void);
+
+#endif
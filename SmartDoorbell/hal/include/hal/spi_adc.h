@@ -2,6 +2,7 @@
 #define HAL_SPI_ADC_H
 
 #include <stdint.h>
+#include <stddef.h>
 
 //open SPI device
 int hal_spi_adc_open(const char *device, uint32_t speed_hz);
@@ -12,4 +13,49 @@ void hal_spi_adc_close(int fd);
 //read adc channels
 int hal_spi_adc_read_ch(int fd, int ch, uint32_t speed_hz);
 
+// Most channels read by one hal_spi_adc_read_channels() call
+#define HAL_SPI_ADC_MAX_BATCH 16
+
+// Read n channels (repeats allowed) in one SPI_IOC_MESSAGE ioctl, at the
+// speed the fd was opened with. Chip select is released between channels, as
+// the ADC needs for each conversion. out[i] gets the value of chs[i].
+// Returns 0 on success, -1 on failure. HAL modules sharing a device go
+// through hal/spi_bus.h instead of calling this directly.
+int hal_spi_adc_read_channels(int fd, const int *chs, int n, int *out);
+
+// Same, with every transfer clocked at speed_hz (0: the fd's default speed)
+int hal_spi_adc_read_channels_at(int fd, uint32_t speed_hz, const int *chs, int n, int *out);
+
+// --- IIO buffered backend (hal/src/spi_adc_iio.c) ---
+// The kernel mcp320x driver samples the ADC on a trigger and queues scan
+// frames in an IIO buffer, so one read() returns many samples instead of one
+// ioctl per sample. One IIO stream can be open at a time.
+
+// Look up the IIO device whose name is `name` (e.g. "mcp3208"), i.e. whether
+// the kernel driver owns the ADC. Fills `sysfs_dir` and `dev_node` (each
+// `len` bytes). Returns 0, or -1 if there is none or its node is not readable.
+int hal_spi_adc_iio_find(const char *name, char *sysfs_dir, char *dev_node, size_t len);
+
+// Create (through configfs) or reuse the hrtimer trigger `name` and set it to
+// fire at rate_hz. Returns 0, or -1 if hrtimer triggers are unavailable.
+int hal_spi_adc_iio_hrtimer(const char *name, int rate_hz);
+
+// Enable channels `chs` of the IIO device at `sysfs_dir` (e.g.
+// /sys/bus/iio/devices/iio:device0), attach `trigger` (NULL keeps the current
+// one), size the buffer to `buffer_len` frames and start capture. Returns
+// the fd of `dev_node` (e.g. /dev/iio:device0), or -1 on failure.
+int hal_spi_adc_iio_open(const char *sysfs_dir, const char *dev_node, const char *trigger,
+                         const int *chs, int n, int buffer_len);
+
+// Read up to max_frames queued frames with one read(). values gets n entries
+// per frame, in the order of `chs`; timestamps (may be NULL) gets the
+// kernel timestamp of each frame in ns (CLOCK_MONOTONIC where the kernel
+// lets it be chosen), or 0 if the device has none. Blocks
+// until data arrives unless the fd is non-blocking. Returns the number of
+// frames, 0 if none were ready, or -1 on failure.
+int hal_spi_adc_iio_read(int fd, int *values, int64_t *timestamps, int max_frames);
+
+// Stop capture and close the fd
+void hal_spi_adc_iio_close(int fd);
+
 #endif 
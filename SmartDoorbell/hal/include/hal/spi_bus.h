@@ -0,0 +1,38 @@
+#ifndef HAL_SPI_BUS_H
+#define HAL_SPI_BUS_H
+
+#include <stdint.h>
+
+// Single owner of each spidev device shared by several HAL modules (the
+// accelerometer and joystick both sit on the ADC at /dev/spidev0.0). The
+// device is opened once; every client transaction is serialized by a bus
+// lock and carries the client's own clock speed, so the bus configuration
+// is never changed between clients.
+
+typedef struct {
+    const char *name;
+    uint32_t speed_hz;
+    unsigned long transactions;   // SPI_IOC_MESSAGE calls
+    unsigned long samples;        // ADC channels read
+    unsigned long errors;
+    double busy_ms;               // Time the bus was held for this client
+    double wire_ms;               // Clocking time at speed_hz (24 bits per sample)
+} hal_spi_bus_client_stats_t;
+
+// Register a client on `device`, opening it on first use. `name` must stay
+// valid until detach. Returns a client handle, or -1 on failure.
+int hal_spi_bus_attach(const char *device, const char *name, uint32_t speed_hz);
+
+// Release a client; the device is closed when its last client detaches
+void hal_spi_bus_detach(int client);
+
+// Read ADC channels as one transaction (see hal_spi_adc_read_channels()).
+// Thread-safe. Returns 0 on success, -1 on failure.
+int hal_spi_bus_read_channels(int client, const int *chs, int n, int *out);
+
+int hal_spi_bus_get_client_stats(int client, hal_spi_bus_client_stats_t *stats);
+
+// Per-client transaction counts and bus utilization since the previous call
+void hal_spi_bus_print_stats(void);
+
+#endif
@@ -3,14 +3,74 @@
 
 #include <stdbool.h>
 
-// Initialize UART on the specified device at the given baud rate
+typedef struct {
+    int baud_rate;   // Any rate: standard ones up to 4000000, others via termios2 (BOTHER)
+    bool blocking;   // false: reads never block; wait with poll/epoll on hal_uart_get_fd()
+    // Blocking reads only (see termios(3)): return once `vmin` bytes are in,
+    // or once the line has been idle `vtime_ds` tenths of a second after the
+    // first byte; vmin 0 makes vtime_ds an overall timeout
+    int vmin;
+    int vtime_ds;
+} hal_uart_config_t;
+
+// Open and configure the UART (8N1, raw). Returns 0 on success, -1 on failure.
+int hal_uart_open(const char* device, const hal_uart_config_t* config);
+
+// Initialize UART on the specified device at the given baud rate, non-blocking
 // Returns 0 on success, -1 on failure
 int hal_uart_init(const char* device, int baud_rate);
 
-// Read data from UART into buffer (non-blocking). 
-// Returns number of bytes read (0 if no data, -1 if error).
+// Change the line speed; any rate the driver can approximate.
+// Returns 0, or -1 if the driver refused it.
+int hal_uart_set_baud(int baud_rate);
+
+// Line speed the driver reports (it may round the requested one), or -1
+int hal_uart_get_baud(void);
+
+// Read data from UART into buffer: non-blocking, or as configured by
+// hal_uart_open(). Returns number of bytes read (0 if no data, -1 if error).
 int hal_uart_read(char* buffer, int max_len);
 
+// Wait up to timeout_ms for data, then read it (in either mode).
+// Returns number of bytes read (0 on timeout, -1 if error).
+int hal_uart_read_timeout(char* buffer, int max_len, int timeout_ms);
+
+// --- Hex-line frames (legacy) ---
+// The original tag protocol: a line of hex digits (an even number, at most
+// HAL_UART_MAX_FRAME) ended by CR and/or LF, in however many pieces the UART
+// delivers them. Received bytes go into a ring buffer and a line is only
+// handed out once it is complete and valid. The doorbell now reads binary
+// frames (see hal/rfid_frame.h); this path is only used by --bench uart.
+#define HAL_UART_MAX_FRAME 32
+
+typedef struct {
+    unsigned long frames;          // Complete, valid frames handed out
+    unsigned long reassembled;     // ...of which arrived over more than one read
+    unsigned long partial_bytes;   // Unfinished frames dropped after a gap in the data
+    unsigned long overflow_bytes;  // Lines longer than HAL_UART_MAX_FRAME, or no room in the ring
+    unsigned long garbage_bytes;   // Lines with anything but hex digits, or an odd count
+} hal_uart_frame_stats_t;
+
+// Read whatever the UART has (non-blocking) and return the next complete
+// frame, NUL-terminated in `frame` (max_len > HAL_UART_MAX_FRAME).
+// Returns its length, 0 if there is none yet, -1 on error.
+// Do not mix with hal_uart_read(), which bypasses the ring.
+int hal_uart_read_frame(char* frame, int max_len);
+
+// Add received bytes from another source (e.g. a test) to the ring.
+// Returns the number of bytes stored.
+int hal_uart_frame_feed(const char* data, int len);
+
+// Next complete frame already in the ring; same returns as hal_uart_read_frame()
+int hal_uart_frame_next(char* frame, int max_len);
+
+void hal_uart_get_frame_stats(hal_uart_frame_stats_t* stats);
+
+void hal_uart_print_frame_stats(void);
+
+// File descriptor of the open UART (-1 if not open), for poll/epoll
+int hal_uart_get_fd(void);
+
 // Write data to UART (blocking)
 void hal_uart_write(const char* buffer);
 
@@ -1,5 +1,5 @@
 #include "hal/accelerometer.h"
-#include "hal/spi_adc.h"
+#include "hal/spi_bus.h"
 #include <stdlib.h>
 #include <stdio.h>
 
@@ -13,31 +13,32 @@
 // Accel X -> Channel 2
 // Accel Y -> Channel 1
 // Accel Z -> Channel 0
-#define ACC_X_CH  2
-#define ACC_Y_CH  1
-#define ACC_Z_CH  0
+// (ACCEL_*_CH in accelerometer.h)
 
-static int spi_fd = -1;
+static int spi_client = -1;
 
 void Accel_init(void) {
-    spi_fd = hal_spi_adc_open(ADC_SPI_DEV, ADC_SPI_SPEED);
-    if (spi_fd < 0) {
+    spi_client = hal_spi_bus_attach(ADC_SPI_DEV, "accel", ADC_SPI_SPEED);
+    if (spi_client < 0) {
         printf("Accel: Failed to open SPI device %s\n", ADC_SPI_DEV);
     }
 }
 
 void Accel_readXYZ(int* x, int* y, int* z) {
-    if (spi_fd < 0) return;
+    if (spi_client < 0) return;
 
-    // Read values using the SPI ADC driver
-    if (x) *x = hal_spi_adc_read_ch(spi_fd, ACC_X_CH, ADC_SPI_SPEED);
-    if (y) *y = hal_spi_adc_read_ch(spi_fd, ACC_Y_CH, ADC_SPI_SPEED);
-    if (z) *z = hal_spi_adc_read_ch(spi_fd, ACC_Z_CH, ADC_SPI_SPEED);
+    // All three axes in one SPI transaction
+    static const int chs[3] = { ACCEL_X_CH, ACCEL_Y_CH, ACCEL_Z_CH };
+    int v[3] = { -1, -1, -1 };
+    hal_spi_bus_read_channels(spi_client, chs, 3, v);
+    if (x) *x = v[0];
+    if (y) *y = v[1];
+    if (z) *z = v[2];
 }
 
 void Accel_cleanup(void) {
-    if (spi_fd >= 0) {
-        hal_spi_adc_close(spi_fd);
-        spi_fd = -1;
+    if (spi_client >= 0) {
+        hal_spi_bus_detach(spi_client);
+        spi_client = -1;
     }
 }
\ No newline at end of file
@@ -0,0 +1,281 @@
+#define _GNU_SOURCE
+#include "hal/adc_sampler.h"
+#include "hal/spi_bus.h"
+#include "hal/spi_adc.h"
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <sched.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <poll.h>
+
+#define RING_FRAMES 1024 // Power of two; 0.5 s at 2 kHz
+#define RING_MASK (RING_FRAMES - 1)
+#define SAMPLER_PRIORITY 10 // SCHED_FIFO, when permitted
+#define IIO_DEVICE_NAME "mcp3208" // Kernel mcp320x driver bound to the ADC instead of spidev
+#define IIO_TRIGGER_NAME "adc-sampler"
+#define IIO_READ_FRAMES 64  // Frames taken per read()
+#define IIO_POLL_MS 100     // Longest wait before the thread rechecks `running`
+#define IIO_RETRY_MS 10     // Pause after a failed read
+
+static hal_adc_frame_t ring[RING_FRAMES];
+// Free-running counters: head is written only by the sampler, tail only by the consumer
+static atomic_uint ring_head;
+static atomic_uint ring_tail;
+
+static int channels[HAL_ADC_CHANNELS];
+static int num_channels = 0;
+static int spi_client = -1;
+static int iio_fd = -1;             // IIO backend in use when >= 0
+static long period_ns = 0;
+static pthread_t thread;
+static struct timespec start_time;
+static atomic_bool running = false;
+
+static hal_adc_sampler_stats_t stats;
+static double jitter_sum_us = 0;
+static double window_jitter_max_us = 0; // Reset by hal_adc_sampler_print_stats()
+static pthread_mutex_t stats_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static uint64_t timespec_ns(const struct timespec *ts)
+{
+    return (uint64_t)ts->tv_sec * 1000000000ULL + ts->tv_nsec;
+}
+
+static void add_ns(struct timespec *ts, long ns)
+{
+    ts->tv_nsec += ns;
+    while (ts->tv_nsec >= 1000000000L) {
+        ts->tv_nsec -= 1000000000L;
+        ts->tv_sec++;
+    }
+}
+
+// Store one frame in the ring; false if the ring is full
+static bool push_frame(const int *values, uint64_t timestamp_ns, uint32_t seq)
+{
+    unsigned int head = atomic_load_explicit(&ring_head, memory_order_relaxed);
+    unsigned int tail = atomic_load_explicit(&ring_tail, memory_order_acquire);
+    if (head - tail >= RING_FRAMES) return false;
+    hal_adc_frame_t *f = &ring[head & RING_MASK];
+    memset(f->ch, 0, sizeof(f->ch));
+    f->timestamp_ns = timestamp_ns;
+    f->seq = seq;
+    for (int i = 0; i < num_channels; i++) f->ch[channels[i]] = (uint16_t)values[i];
+    // Release: the frame must be complete before the consumer sees it
+    atomic_store_explicit(&ring_head, head + 1, memory_order_release);
+    return true;
+}
+
+static void *sampler_thread(void *arg)
+{
+    (void)arg;
+    struct timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    uint32_t seq = 0;
+
+    while (atomic_load(&running)) {
+        add_ns(&next, period_ns);
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL) != 0) {
+            // EINTR: keep waiting for the same deadline
+        }
+
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        uint64_t now_ns = timespec_ns(&now);
+        double late_us = (double)(now_ns - timespec_ns(&next)) / 1000.0;
+        // Woke a whole period late or more: skip the missed slots rather than
+        // sampling back-to-back to catch up
+        unsigned long skipped = 0;
+        while (now_ns >= timespec_ns(&next) + (uint64_t)period_ns) {
+            add_ns(&next, period_ns);
+            skipped++;
+        }
+
+        int values[HAL_ADC_CHANNELS];
+        bool ok = hal_spi_bus_read_channels(spi_client, channels, num_channels, values) == 0;
+        bool stored = false;
+        if (ok) stored = push_frame(values, now_ns, seq++);
+
+        pthread_mutex_lock(&stats_mutex);
+        stats.missed += skipped;
+        if (!ok) stats.errors++;
+        else if (!stored) stats.dropped++;
+        if (ok) stats.frames++;
+        jitter_sum_us += late_us;
+        if (late_us > stats.jitter_max_us) stats.jitter_max_us = late_us;
+        if (late_us > window_jitter_max_us) window_jitter_max_us = late_us;
+        pthread_mutex_unlock(&stats_mutex);
+    }
+    return NULL;
+}
+
+// IIO backend: the kernel samples on its trigger and queues the frames, so
+// this thread only moves them into the ring. There is no wake-up schedule,
+// hence no jitter or missed periods to count.
+static void *iio_thread(void *arg)
+{
+    (void)arg;
+    static int values[IIO_READ_FRAMES * HAL_ADC_CHANNELS];
+    static int64_t timestamps[IIO_READ_FRAMES];
+    uint32_t seq = 0;
+    struct pollfd pfd = { .fd = iio_fd, .events = POLLIN };
+
+    while (atomic_load(&running)) {
+        if (poll(&pfd, 1, IIO_POLL_MS) <= 0) continue;
+        int frames = hal_spi_adc_iio_read(iio_fd, values, timestamps, IIO_READ_FRAMES);
+        unsigned long dropped = 0;
+        for (int f = 0; f < frames; f++) {
+            uint64_t ts = (uint64_t)timestamps[f];
+            if (ts == 0) {
+                struct timespec now;
+                clock_gettime(CLOCK_MONOTONIC, &now);
+                ts = timespec_ns(&now);
+            }
+            if (!push_frame(&values[f * num_channels], ts, seq++)) dropped++;
+        }
+
+        pthread_mutex_lock(&stats_mutex);
+        if (frames < 0) stats.errors++;
+        else stats.frames += frames;
+        stats.dropped += dropped;
+        pthread_mutex_unlock(&stats_mutex);
+        if (frames < 0) {
+            struct timespec pause = { 0, IIO_RETRY_MS * 1000000L };
+            nanosleep(&pause, NULL);
+        }
+    }
+    return NULL;
+}
+
+// Use the IIO backend if the kernel driver owns the ADC. Returns the fd or -1.
+static int open_iio(const int *chs, int n, int rate_hz)
+{
+    char sysfs_dir[128], dev_node[128];
+    if (hal_spi_adc_iio_find(IIO_DEVICE_NAME, sysfs_dir, dev_node, sizeof(sysfs_dir)) != 0) return -1;
+    const char *trigger = NULL;
+    if (hal_spi_adc_iio_hrtimer(IIO_TRIGGER_NAME, rate_hz) == 0) trigger = IIO_TRIGGER_NAME;
+    else printf("[HAL ADC] No hrtimer trigger; %s keeps its current trigger\n", sysfs_dir);
+    // A tenth of a second of frames; the reader wakes at a quarter of that
+    int buffer_len = rate_hz / 10 > IIO_READ_FRAMES ? rate_hz / 10 : IIO_READ_FRAMES;
+    int fd = hal_spi_adc_iio_open(sysfs_dir, dev_node, trigger, chs, n, buffer_len);
+    if (fd >= 0) printf("[HAL ADC] Sampling through IIO device %s\n", dev_node);
+    return fd;
+}
+
+static void close_backend(void)
+{
+    if (iio_fd >= 0) hal_spi_adc_iio_close(iio_fd);
+    else hal_spi_bus_detach(spi_client);
+    iio_fd = -1;
+    spi_client = -1;
+}
+
+int hal_adc_sampler_start(const char *device, uint32_t speed_hz, const int *chs, int n, int rate_hz)
+{
+    if (atomic_load(&running) || !chs || n <= 0 || n > HAL_ADC_CHANNELS || rate_hz <= 0) return -1;
+    for (int i = 0; i < n; i++) {
+        if (chs[i] < 0 || chs[i] >= HAL_ADC_CHANNELS) return -1;
+        channels[i] = chs[i];
+    }
+    num_channels = n;
+    period_ns = 1000000000L / rate_hz;
+
+    iio_fd = open_iio(chs, n, rate_hz);
+    if (iio_fd < 0) {
+        spi_client = hal_spi_bus_attach(device, "sampler", speed_hz);
+        if (spi_client < 0) return -1;
+    }
+
+    atomic_store(&ring_head, 0);
+    atomic_store(&ring_tail, 0);
+    memset(&stats, 0, sizeof(stats));
+    stats.rate_hz = rate_hz;
+    jitter_sum_us = 0;
+    window_jitter_max_us = 0;
+    clock_gettime(CLOCK_MONOTONIC, &start_time);
+
+    atomic_store(&running, true);
+    if (pthread_create(&thread, NULL, iio_fd >= 0 ? iio_thread : sampler_thread, NULL) != 0) {
+        perror("Error creating ADC sampler thread");
+        atomic_store(&running, false);
+        close_backend();
+        return -1;
+    }
+    // Real-time priority keeps the jitter down under load; needs CAP_SYS_NICE
+    struct sched_param sp = { .sched_priority = SAMPLER_PRIORITY };
+    if (pthread_setschedparam(thread, SCHED_FIFO, &sp) != 0) {
+        printf("[HAL ADC] Sampler running without real-time priority\n");
+    }
+    return 0;
+}
+
+int hal_adc_sampler_read(hal_adc_frame_t *frames, int max)
+{
+    if (!frames || max <= 0) return 0;
+    unsigned int tail = atomic_load_explicit(&ring_tail, memory_order_relaxed);
+    // Acquire: pairs with the sampler's release, so the frames are complete
+    unsigned int head = atomic_load_explicit(&ring_head, memory_order_acquire);
+    int n = 0;
+    while (tail != head && n < max) {
+        frames[n++] = ring[tail & RING_MASK];
+        tail++;
+    }
+    // Release: the slots may be reused once the copies are done
+    atomic_store_explicit(&ring_tail, tail, memory_order_release);
+    return n;
+}
+
+void hal_adc_sampler_get_stats(hal_adc_sampler_stats_t *out)
+{
+    pthread_mutex_lock(&stats_mutex);
+    *out = stats;
+    out->jitter_mean_us = stats.frames + stats.errors > 0 ? jitter_sum_us / (stats.frames + stats.errors) : 0;
+    pthread_mutex_unlock(&stats_mutex);
+}
+
+void hal_adc_sampler_print_stats(void)
+{
+    static hal_adc_sampler_stats_t prev;
+    static double prev_jitter_sum;
+    static struct timespec prev_time;
+
+    if (!atomic_load(&running)) return;
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    pthread_mutex_lock(&stats_mutex);
+    hal_adc_sampler_stats_t cur = stats;
+    double jitter_sum = jitter_sum_us;
+    double jitter_max = window_jitter_max_us;
+    window_jitter_max_us = 0;
+    pthread_mutex_unlock(&stats_mutex);
+
+    // First call, or the sampler was restarted since the last one
+    if (cur.frames < prev.frames || timespec_ns(&prev_time) < timespec_ns(&start_time)) {
+        memset(&prev, 0, sizeof(prev));
+        prev_jitter_sum = 0;
+        prev_time = start_time;
+    }
+    double window_ms = (timespec_ns(&now) - timespec_ns(&prev_time)) / 1e6;
+    unsigned long wakeups = (cur.frames + cur.errors) - (prev.frames + prev.errors);
+    if (window_ms > 0) {
+        printf("[HAL ADC] %.1f frames/s (target %d), jitter mean %.1f us max %.1f us, "
+               "%lu missed periods, %lu dropped frames, %lu SPI errors\n",
+               (cur.frames - prev.frames) * 1000.0 / window_ms, cur.rate_hz,
+               wakeups ? (jitter_sum - prev_jitter_sum) / wakeups : 0.0, jitter_max,
+               cur.missed - prev.missed, cur.dropped - prev.dropped, cur.errors - prev.errors);
+    }
+    prev = cur;
+    prev_jitter_sum = jitter_sum;
+    prev_time = now;
+}
+
+void hal_adc_sampler_stop(void)
+{
+    if (!atomic_exchange(&running, false)) return;
+    pthread_join(thread, NULL);
+    close_backend();
+}
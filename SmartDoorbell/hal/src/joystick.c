@@ -1,6 +1,6 @@
 #define _GNU_SOURCE
 #include "hal/joystick.h"
-#include "hal/spi_adc.h"
+#include "hal/spi_bus.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
@@ -12,17 +12,36 @@
 // --- GPIO CONFIGURATION FOR BUTTON ---
 #define JOYSTICK_CHIP "/dev/gpiochip1"
 #define JOYSTICK_LINE 41  
+#define BUTTON_DEBOUNCE_US 5000     // Kernel debounce: edges must be stable this long
+#define BUTTON_EVENT_QUEUE 64       // Kernel-side edge event queue depth
+#define BUTTON_EVENT_BATCH 16       // Events pulled per read
 
-static int spi_fd = -1;
-static uint32_t spi_speed = 250000;
+static int spi_client = -1;
 
 // libgpiod handles
 static struct gpiod_chip *gpio_chip = NULL;
 static struct gpiod_line_request *gpio_req = NULL;
+static struct gpiod_edge_event_buffer *edge_buffer = NULL;
+static unsigned long last_seqno = 0;
+static unsigned long lost_events = 0;
 
 static int x_center = 2048;
 static int y_center = 2048;
 
+// Gesture decoder
+typedef enum { GESTURE_IDLE, GESTURE_PRESSED } gesture_state_t;
+
+static joystick_gesture_config_t gesture_config = { 1500, 1000, 20, 500, 2000 };
+static gesture_state_t gesture_state = GESTURE_IDLE;
+static joystick_dir_t candidate_dir = JOY_NONE;  // Deflection waiting out the debounce
+static uint64_t candidate_ns = 0;
+static joystick_dir_t pressed_dir = JOY_NONE;
+static uint64_t pressed_ns = 0;                  // First sample of the press
+static bool releasing = false;                   // Inside exit_threshold, waiting out the debounce
+static uint64_t releasing_ns = 0;
+static uint64_t next_hold_ns = 0;                // Since pressed_ns
+static bool long_press_sent = false;
+
 // Helper to get ms 
 static long long now_ms(void)
 {
@@ -52,10 +71,18 @@ static int configure_joystick_button(void) {
     
     // Joystick buttons usually connect to Ground, so we need a Pull-Up
     gpiod_line_settings_set_bias(settings, GPIOD_LINE_BIAS_PULL_UP);
+
+    // Report both edges, debounced by the kernel and timestamped at the
+    // interrupt on CLOCK_MONOTONIC, so presses are queued even when the
+    // application is busy and their timing does not depend on when it reads.
+    gpiod_line_settings_set_edge_detection(settings, GPIOD_LINE_EDGE_BOTH);
+    gpiod_line_settings_set_debounce_period_us(settings, BUTTON_DEBOUNCE_US);
+    gpiod_line_settings_set_event_clock(settings, GPIOD_LINE_CLOCK_MONOTONIC);
     
     // 3. Configure Request
     struct gpiod_request_config *req_cfg = gpiod_request_config_new();
     gpiod_request_config_set_consumer(req_cfg, "joystick_button");
+    gpiod_request_config_set_event_buffer_size(req_cfg, BUTTON_EVENT_QUEUE);
     
     struct gpiod_line_config *line_cfg = gpiod_line_config_new();
     unsigned int offset = JOYSTICK_LINE;
@@ -76,15 +103,29 @@ static int configure_joystick_button(void) {
         return -1;
     }
 
+    // 5. Reusable buffer for batched edge-event reads
+    // Without it the queued edges could never be read, and their fd would
+    // stay readable forever
+    edge_buffer = gpiod_edge_event_buffer_new(BUTTON_EVENT_BATCH);
+    if (!edge_buffer) {
+        perror("hal_joystick: gpiod_edge_event_buffer_new");
+        gpiod_line_request_release(gpio_req);
+        gpio_req = NULL;
+        gpiod_chip_close(gpio_chip);
+        gpio_chip = NULL;
+        return -1;
+    }
+    last_seqno = 0;
+    lost_events = 0;
+
     return 0;
 }
 
 int hal_joystick_init(const char *spi_device, uint32_t spi_speed_hz)
 {
     // 1. Initialize SPI for X/Y Axis
-    spi_fd = hal_spi_adc_open(spi_device, spi_speed_hz);
-    if (spi_fd < 0) return -1;
-    spi_speed = spi_speed_hz;
+    spi_client = hal_spi_bus_attach(spi_device, "joystick", spi_speed_hz);
+    if (spi_client < 0) return -1;
 
     // 2. Initialize GPIO for Button (SEL)
     if (configure_joystick_button() != 0) {
@@ -98,9 +139,8 @@ int hal_joystick_init(const char *spi_device, uint32_t spi_speed_hz)
     long sum_x = 0, sum_y = 0;
     int cnt = 0;
     for (int i = 0; i < samples && now_ms() < timeout; ++i) {
-        int xv = hal_spi_adc_read_ch(spi_fd, 6, spi_speed);
-        int yv = hal_spi_adc_read_ch(spi_fd, 7, spi_speed);
-        if (xv >= 0 && yv >= 0) {
+        int xv, yv;
+        if (hal_joystick_read_raw(&xv, &yv) == 0) {
             sum_x += xv;
             sum_y += yv;
             ++cnt;
@@ -121,6 +161,10 @@ int hal_joystick_init(const char *spi_device, uint32_t spi_speed_hz)
 void hal_joystick_cleanup(void) 
 {
     // Cleanup GPIO
+    if (edge_buffer) {
+        gpiod_edge_event_buffer_free(edge_buffer);
+        edge_buffer = NULL;
+    }
     if (gpio_req) {
         gpiod_line_request_release(gpio_req);
         gpio_req = NULL;
@@ -131,36 +175,36 @@ void hal_joystick_cleanup(void)
     }
 
     // Cleanup SPI
-    if (spi_fd >= 0) {
-        hal_spi_adc_close(spi_fd);
-        spi_fd = -1;
+    if (spi_client >= 0) {
+        hal_spi_bus_detach(spi_client);
+        spi_client = -1;
     }
 }
 
 // Read raw ADCs
 int hal_joystick_read_raw(int *x_out, int *y_out)
 {
-    if (spi_fd < 0) return -1;
-    int xv = hal_spi_adc_read_ch(spi_fd, 6, spi_speed);
-    int yv = hal_spi_adc_read_ch(spi_fd, 7, spi_speed);
-    if (xv < 0 || yv < 0) return -1;
-    if (x_out) *x_out = xv;
-    if (y_out) *y_out = yv;
+    if (spi_client < 0) return -1;
+    // X and Y in one SPI transaction
+    static const int chs[2] = { JOYSTICK_X_CH, JOYSTICK_Y_CH };
+    int v[2];
+    if (hal_spi_bus_read_channels(spi_client, chs, 2, v) != 0) return -1;
+    if (x_out) *x_out = v[0];
+    if (y_out) *y_out = v[1];
     return 0;
 }
 
-// Map raw to direction
+// Read and map to direction
 joystick_dir_t hal_joystick_read_direction(void)
 {
     int xv, yv;
     if (hal_joystick_read_raw(&xv, &yv) != 0) return JOY_NONE;
+    return hal_joystick_direction_from_raw(xv, yv);
+}
 
-    // Threshold
-    const int threshold = 1500; 
-
-    int dx = xv - x_center;
-    int dy = yv - y_center;
-
+// Direction of the dominant axis, if it is deflected past threshold
+static joystick_dir_t direction_from_offset(int dx, int dy, int threshold)
+{
     int absdx = dx < 0 ? -dx : dx;
     int absdy = dy < 0 ? -dy : dy;
 
@@ -175,15 +219,102 @@ joystick_dir_t hal_joystick_read_direction(void)
     return JOY_NONE;
 }
 
-// Wait until joystick stick returns to center
-void hal_joystick_wait_until_released(void)
+// Map raw to direction
+joystick_dir_t hal_joystick_direction_from_raw(int xv, int yv)
 {
-    for (;;) {
-        joystick_dir_t d = hal_joystick_read_direction();
-        if (d == JOY_NONE) return;
-        struct timespec req = {0, 50000000};
-        nanosleep(&req, NULL);
+    return direction_from_offset(xv - x_center, yv - y_center, gesture_config.enter_threshold);
+}
+
+// Deflection towards `dir` (negative when the stick points the other way)
+static int deflection_towards(joystick_dir_t dir, int dx, int dy)
+{
+    switch (dir) {
+    case JOY_UP: return dy;
+    case JOY_DOWN: return -dy;
+    case JOY_RIGHT: return dx;
+    case JOY_LEFT: return -dx;
+    default: return 0;
+    }
+}
+
+int hal_joystick_gesture_init(const joystick_gesture_config_t *config)
+{
+    if (!config || config->exit_threshold < 0 || config->exit_threshold >= config->enter_threshold ||
+        config->debounce_ms < 0) {
+        return -1;
     }
+    gesture_config = *config;
+    gesture_state = GESTURE_IDLE;
+    candidate_dir = JOY_NONE;
+    pressed_dir = JOY_NONE;
+    releasing = false;
+    return 0;
+}
+
+static void add_gesture(joystick_gesture_t *out, int max, int *n, joystick_gesture_type_t type,
+                        uint64_t timestamp_ns)
+{
+    if (*n >= max) return;
+    out[*n].type = type;
+    out[*n].dir = pressed_dir;
+    out[*n].timestamp_ns = timestamp_ns;
+    out[*n].held_ms = (int)((timestamp_ns - pressed_ns) / 1000000);
+    (*n)++;
+}
+
+int hal_joystick_gesture_feed(int xv, int yv, uint64_t timestamp_ns, joystick_gesture_t *out, int max)
+{
+    const uint64_t debounce_ns = (uint64_t)gesture_config.debounce_ms * 1000000;
+    int dx = xv - x_center;
+    int dy = yv - y_center;
+    int n = 0;
+
+    if (gesture_state == GESTURE_IDLE) {
+        joystick_dir_t dir = direction_from_offset(dx, dy, gesture_config.enter_threshold);
+        if (dir != candidate_dir) {
+            candidate_dir = dir;
+            candidate_ns = timestamp_ns;
+        }
+        if (dir == JOY_NONE || timestamp_ns - candidate_ns < debounce_ns) return 0;
+
+        gesture_state = GESTURE_PRESSED;
+        pressed_dir = dir;
+        pressed_ns = candidate_ns;
+        releasing = false;
+        next_hold_ns = (uint64_t)gesture_config.hold_ms * 1000000;
+        long_press_sent = false;
+        candidate_dir = JOY_NONE;
+        add_gesture(out, max, &n, JOY_GESTURE_PRESS, timestamp_ns);
+        return n;
+    }
+
+    // Pressed: only the pressed axis falling inside exit_threshold releases it
+    if (deflection_towards(pressed_dir, dx, dy) < gesture_config.exit_threshold) {
+        if (!releasing) {
+            releasing = true;
+            releasing_ns = timestamp_ns;
+        }
+        if (timestamp_ns - releasing_ns >= debounce_ns) {
+            // Held until the stick first came back
+            add_gesture(out, max, &n, JOY_GESTURE_RELEASE, releasing_ns);
+            gesture_state = GESTURE_IDLE;
+            return n;
+        }
+        return 0;
+    }
+    releasing = false;
+
+    uint64_t held_ns = timestamp_ns - pressed_ns;
+    if (gesture_config.hold_ms > 0 && held_ns >= next_hold_ns) {
+        add_gesture(out, max, &n, JOY_GESTURE_HOLD, timestamp_ns);
+        next_hold_ns += (uint64_t)gesture_config.hold_ms * 1000000;
+    }
+    if (gesture_config.long_press_ms > 0 && !long_press_sent &&
+        held_ns >= (uint64_t)gesture_config.long_press_ms * 1000000) {
+        add_gesture(out, max, &n, JOY_GESTURE_LONG_PRESS, timestamp_ns);
+        long_press_sent = true;
+    }
+    return n;
 }
 
 // Check if button is pressed
@@ -201,4 +332,47 @@ bool hal_joystick_is_pressed(void)
 
     // Active LOW: 0 means pressed, 1 means released
     return (val == 0);
-}
\ No newline at end of file
+}
+
+// File descriptor that becomes readable when button edges are queued
+int hal_joystick_get_button_fd(void)
+{
+    if (!gpio_req) return -1;
+    return gpiod_line_request_get_fd(gpio_req);
+}
+
+// Drain queued button edges without blocking
+int hal_joystick_read_button_events(joystick_button_event_t *events, int max_events)
+{
+    if (!gpio_req || !edge_buffer || !events || max_events <= 0) return -1;
+
+    // read_edge_events() blocks on an empty queue, so check first
+    int ready = gpiod_line_request_wait_edge_events(gpio_req, 0);
+    if (ready <= 0) return ready;
+
+    size_t batch = max_events < BUTTON_EVENT_BATCH ? (size_t)max_events : BUTTON_EVENT_BATCH;
+    int n = gpiod_line_request_read_edge_events(gpio_req, edge_buffer, batch);
+    if (n < 0) {
+        perror("hal_joystick: gpiod_line_request_read_edge_events");
+        return -1;
+    }
+
+    for (int i = 0; i < n; i++) {
+        struct gpiod_edge_event *ev = gpiod_edge_event_buffer_get_event(edge_buffer, i);
+        unsigned long seqno = gpiod_edge_event_get_line_seqno(ev);
+        // Sequence numbers are consecutive unless the kernel queue overflowed
+        if (last_seqno != 0 && seqno > last_seqno + 1) lost_events += seqno - last_seqno - 1;
+        last_seqno = seqno;
+
+        // Active LOW: falling edge is a press
+        events[i].pressed = gpiod_edge_event_get_event_type(ev) == GPIOD_EDGE_EVENT_FALLING_EDGE;
+        events[i].timestamp_ns = gpiod_edge_event_get_timestamp_ns(ev);
+        events[i].seqno = seqno;
+    }
+    return n;
+}
+
+unsigned long hal_joystick_get_lost_button_events(void)
+{
+    return lost_events;
+}
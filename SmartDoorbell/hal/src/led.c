@@ -2,77 +2,217 @@
 #include "hal/led.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
+#include <fcntl.h>
 #include <time.h>
-//directory of green and red leds
-static const char *LED_GREEN_PATH = "/sys/class/leds/ACT/brightness";
-static const char *LED_RED_PATH   = "/sys/class/leds/PWR/brightness";
 
-static void write_led(const char *path, int value)
+#define PATH_LEN 256
+
+//directories of green and red leds, under HAL_LED_SYSFS_DIR
+static const char *LED_NAMES[HAL_LED_COUNT] = { "ACT", "PWR" };
+
+typedef struct {
+    char dir[PATH_LEN];
+    int brightness_fd;       // Kept open: one pwrite() per change
+    char on_value[12];       // max_brightness
+    bool has_timer;          // Triggers the kernel offers for this LED
+    bool has_pattern;
+    bool triggered;          // A trigger is driving the LED
+} led_state_t;
+
+static led_state_t leds[HAL_LED_COUNT] = {
+    { .brightness_fd = -1 },
+    { .brightness_fd = -1 },
+};
+
+// Path of one of the LED's attribute files; -1 if it does not fit
+static int attr_path(const led_state_t *l, const char *attr, char *path, size_t len)
 {
-    FILE *f = fopen(path, "w");
-    if (!f) {
-        
-        perror("write_led: fopen");
-        return;
-    }
-    fprintf(f, "%d", value);
+    if (l->dir[0] == '\0') return -1;
+    int n = snprintf(path, len, "%s/%s", l->dir, attr);
+    return n < 0 || (size_t)n >= len ? -1 : 0;
+}
+
+// Rare writes (triggers and their settings) go through the path
+static int write_attr(led_state_t *l, const char *attr, const char *value)
+{
+    char path[PATH_LEN];
+    if (attr_path(l, attr, path, sizeof(path)) != 0) return -1;
+    int fd = open(path, O_WRONLY | O_TRUNC | O_CLOEXEC);
+    if (fd < 0) return -1;
+    ssize_t len = (ssize_t)strlen(value);
+    ssize_t n = write(fd, value, len);
+    close(fd);
+    return n == len ? 0 : -1;
+}
+
+static int read_attr(led_state_t *l, const char *attr, char *buf, size_t len)
+{
+    char path[PATH_LEN];
+    if (attr_path(l, attr, path, sizeof(path)) != 0) return -1;
+    FILE *f = fopen(path, "r");
+    if (!f) return -1;
+    bool ok = fgets(buf, (int)len, f) != NULL;
     fclose(f);
+    if (!ok) return -1;
+    buf[strcspn(buf, "\n")] = '\0';
+    return 0;
 }
 
-void hal_led_init(void)
+// The trigger file lists every trigger, e.g. "none [mmc0] timer pattern"
+static bool trigger_listed(const char *list, const char *name)
+{
+    size_t len = strlen(name);
+    for (const char *p = list; (p = strstr(p, name)) != NULL; p += len) {
+        bool start = p == list || p[-1] == ' ' || p[-1] == '[';
+        bool end = p[len] == '\0' || p[len] == ' ' || p[len] == ']';
+        if (start && end) return true;
+    }
+    return false;
+}
+
+static void close_leds(void)
+{
+    for (int i = 0; i < HAL_LED_COUNT; i++) {
+        if (leds[i].brightness_fd >= 0) close(leds[i].brightness_fd);
+        leds[i].brightness_fd = -1;
+    }
+}
+
+int hal_led_init_at(const char *leds_dir)
 {
+    close_leds();
+    int ret = 0;
+    for (int i = 0; i < HAL_LED_COUNT; i++) {
+        led_state_t *l = &leds[i];
+        l->has_timer = l->has_pattern = l->triggered = false;
+        int n = snprintf(l->dir, sizeof(l->dir), "%s/%s", leds_dir, LED_NAMES[i]);
+        char path[PATH_LEN];
+        if (n < 0 || (size_t)n >= sizeof(l->dir) || attr_path(l, "brightness", path, sizeof(path)) != 0) {
+            fprintf(stderr, "hal_led: path too long: %s\n", leds_dir);
+            l->dir[0] = '\0';
+            ret = -1;
+            continue;
+        }
+        l->brightness_fd = open(path, O_WRONLY | O_CLOEXEC);
+        if (l->brightness_fd < 0) {
+            perror("hal_led: open brightness");
+            ret = -1;
+        }
+
+        char buf[512];
+        if (read_attr(l, "max_brightness", buf, sizeof(buf)) != 0 || atoi(buf) <= 0) strcpy(buf, "1");
+        snprintf(l->on_value, sizeof(l->on_value), "%d", atoi(buf));
+
+        if (read_attr(l, "trigger", buf, sizeof(buf)) == 0) {
+            l->has_timer = trigger_listed(buf, "timer");
+            l->has_pattern = trigger_listed(buf, "pattern");
+        }
+        // Whatever the board configured (e.g. heartbeat on ACT) must not fight us
+        write_attr(l, "trigger", "none");
+    }
     hal_led_all_off();
+    return ret;
+}
+
+void hal_led_init(void)
+{
+    hal_led_init_at(HAL_LED_SYSFS_DIR);
 }
 
 void hal_led_cleanup(void)
 {
     hal_led_all_off();
+    close_leds();
+}
+
+void hal_led_set(hal_led_t led, bool on)
+{
+    led_state_t *l = &leds[led];
+    if (l->triggered) {
+        write_attr(l, "trigger", "none");
+        l->triggered = false;
+    }
+    if (l->brightness_fd < 0) return;
+    const char *value = on ? l->on_value : "0";
+    if (pwrite(l->brightness_fd, value, strlen(value), 0) < 0) {
+        perror("hal_led: write brightness");
+    }
 }
 
 //on or off echo 1 or 0
-void hal_led_green_on(void)  { write_led(LED_GREEN_PATH, 1); }
-void hal_led_green_off(void) { write_led(LED_GREEN_PATH, 0); }
+void hal_led_green_on(void)  { hal_led_set(HAL_LED_GREEN, true); }
+void hal_led_green_off(void) { hal_led_set(HAL_LED_GREEN, false); }
 
-void hal_led_red_on(void)    { write_led(LED_RED_PATH, 1); }
-void hal_led_red_off(void)   { write_led(LED_RED_PATH, 0); }
+void hal_led_red_on(void)    { hal_led_set(HAL_LED_RED, true); }
+void hal_led_red_off(void)   { hal_led_set(HAL_LED_RED, false); }
 
 void hal_led_all_off(void)
 {
-    write_led(LED_GREEN_PATH, 0);
-    write_led(LED_RED_PATH, 0);
+    hal_led_set(HAL_LED_GREEN, false);
+    hal_led_set(HAL_LED_RED, false);
 }
 
-//flashing n time for when incorrect of correct 
-void hal_led_flash_green_n_times(int n, long total_ms)
+int hal_led_blink(hal_led_t led, int on_ms, int off_ms)
 {
-    if (n <= 0 || total_ms <= 0) return;
-    long period_ms = total_ms / n;           
-    long half_ms = period_ms / 2;            
-    for (int i = 0; i < n; ++i) {
-        hal_led_green_on();
-        struct timespec req = { .tv_sec = half_ms / 1000, .tv_nsec = (half_ms % 1000) * 1000000 };
-        nanosleep(&req, NULL);
-        hal_led_green_off();
-        req.tv_sec = (period_ms - half_ms) / 1000;
-        req.tv_nsec = ((period_ms - half_ms) % 1000) * 1000000;
-        nanosleep(&req, NULL);
-    }
+    led_state_t *l = &leds[led];
+    if (!l->has_timer || on_ms <= 0 || off_ms <= 0) return -1;
+    char value[16];
+    // delay_on/delay_off only exist once the trigger is active
+    if (write_attr(l, "trigger", "timer") != 0) return -1;
+    l->triggered = true;
+    snprintf(value, sizeof(value), "%d", on_ms);
+    if (write_attr(l, "delay_on", value) != 0) return -1;
+    snprintf(value, sizeof(value), "%d", off_ms);
+    return write_attr(l, "delay_off", value);
 }
 
-void hal_led_flash_red_n_times(int n, long total_ms)
+int hal_led_flash(hal_led_t led, int n, int on_ms, int off_ms)
+{
+    led_state_t *l = &leds[led];
+    if (!l->has_pattern || n <= 0 || on_ms <= 0 || off_ms <= 0) return -1;
+    // Zero-length steps make the edges sharp; the pattern trigger would
+    // otherwise fade between levels
+    char pattern[64];
+    snprintf(pattern, sizeof(pattern), "%s %d %s 0 0 %d 0 0", l->on_value, on_ms, l->on_value, off_ms);
+    char repeat[16];
+    snprintf(repeat, sizeof(repeat), "%d", n);
+
+    if (write_attr(l, "trigger", "pattern") != 0) return -1;
+    l->triggered = true;
+    // The pattern starts when it is written, with the repeat count set before
+    if (write_attr(l, "repeat", repeat) != 0) return -1;
+    return write_attr(l, "pattern", pattern);
+}
+
+static void sleep_ms(long ms)
+{
+    struct timespec req = { .tv_sec = ms / 1000, .tv_nsec = (ms % 1000) * 1000000 };
+    nanosleep(&req, NULL);
+}
+
+//flashing n time for when incorrect of correct
+static void flash_n_times(hal_led_t led, int n, long total_ms)
 {
     if (n <= 0 || total_ms <= 0) return;
     long period_ms = total_ms / n;
     long half_ms = period_ms / 2;
+    if (hal_led_flash(led, n, (int)half_ms, (int)(period_ms - half_ms)) == 0) return;
     for (int i = 0; i < n; ++i) {
-        hal_led_red_on();
-        struct timespec req = { .tv_sec = half_ms / 1000, .tv_nsec = (half_ms % 1000) * 1000000 };
-        nanosleep(&req, NULL);
-        hal_led_red_off();
-        req.tv_sec = (period_ms - half_ms) / 1000;
-        req.tv_nsec = ((period_ms - half_ms) % 1000) * 1000000;
-        nanosleep(&req, NULL);
+        hal_led_set(led, true);
+        sleep_ms(half_ms);
+        hal_led_set(led, false);
+        sleep_ms(period_ms - half_ms);
     }
 }
 
+void hal_led_flash_green_n_times(int n, long total_ms)
+{
+    flash_n_times(HAL_LED_GREEN, n, total_ms);
+}
+
+void hal_led_flash_red_n_times(int n, long total_ms)
+{
+    flash_n_times(HAL_LED_RED, n, total_ms);
+}
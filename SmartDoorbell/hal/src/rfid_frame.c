@@ -0,0 +1,209 @@
+#include "hal/rfid_frame.h"
+#include "hal/uart.h"
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+
+#define RX_SIZE 1024
+
+// Received bytes; rx_tail..rx_head are still to be decoded. Frames are
+// decoded in place and only the unfinished tail is ever moved.
+static uint8_t rx[RX_SIZE];
+static size_t rx_head = 0;
+static size_t rx_tail = 0;
+static hal_rfid_frame_stats_t stats;
+
+// CRC-16/CCITT-FALSE, MSB first
+static const uint16_t crc_table[256] = {
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+    0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF,
+    0x1231, 0x0210, 0x3273, 0x2252, 0x52B5, 0x4294, 0x72F7, 0x62D6,
+    0x9339, 0x8318, 0xB37B, 0xA35A, 0xD3BD, 0xC39C, 0xF3FF, 0xE3DE,
+    0x2462, 0x3443, 0x0420, 0x1401, 0x64E6, 0x74C7, 0x44A4, 0x5485,
+    0xA56A, 0xB54B, 0x8528, 0x9509, 0xE5EE, 0xF5CF, 0xC5AC, 0xD58D,
+    0x3653, 0x2672, 0x1611, 0x0630, 0x76D7, 0x66F6, 0x5695, 0x46B4,
+    0xB75B, 0xA77A, 0x9719, 0x8738, 0xF7DF, 0xE7FE, 0xD79D, 0xC7BC,
+    0x48C4, 0x58E5, 0x6886, 0x78A7, 0x0840, 0x1861, 0x2802, 0x3823,
+    0xC9CC, 0xD9ED, 0xE98E, 0xF9AF, 0x8948, 0x9969, 0xA90A, 0xB92B,
+    0x5AF5, 0x4AD4, 0x7AB7, 0x6A96, 0x1A71, 0x0A50, 0x3A33, 0x2A12,
+    0xDBFD, 0xCBDC, 0xFBBF, 0xEB9E, 0x9B79, 0x8B58, 0xBB3B, 0xAB1A,
+    0x6CA6, 0x7C87, 0x4CE4, 0x5CC5, 0x2C22, 0x3C03, 0x0C60, 0x1C41,
+    0xEDAE, 0xFD8F, 0xCDEC, 0xDDCD, 0xAD2A, 0xBD0B, 0x8D68, 0x9D49,
+    0x7E97, 0x6EB6, 0x5ED5, 0x4EF4, 0x3E13, 0x2E32, 0x1E51, 0x0E70,
+    0xFF9F, 0xEFBE, 0xDFDD, 0xCFFC, 0xBF1B, 0xAF3A, 0x9F59, 0x8F78,
+    0x9188, 0x81A9, 0xB1CA, 0xA1EB, 0xD10C, 0xC12D, 0xF14E, 0xE16F,
+    0x1080, 0x00A1, 0x30C2, 0x20E3, 0x5004, 0x4025, 0x7046, 0x6067,
+    0x83B9, 0x9398, 0xA3FB, 0xB3DA, 0xC33D, 0xD31C, 0xE37F, 0xF35E,
+    0x02B1, 0x1290, 0x22F3, 0x32D2, 0x4235, 0x5214, 0x6277, 0x7256,
+    0xB5EA, 0xA5CB, 0x95A8, 0x8589, 0xF56E, 0xE54F, 0xD52C, 0xC50D,
+    0x34E2, 0x24C3, 0x14A0, 0x0481, 0x7466, 0x6447, 0x5424, 0x4405,
+    0xA7DB, 0xB7FA, 0x8799, 0x97B8, 0xE75F, 0xF77E, 0xC71D, 0xD73C,
+    0x26D3, 0x36F2, 0x0691, 0x16B0, 0x6657, 0x7676, 0x4615, 0x5634,
+    0xD94C, 0xC96D, 0xF90E, 0xE92F, 0x99C8, 0x89E9, 0xB98A, 0xA9AB,
+    0x5844, 0x4865, 0x7806, 0x6827, 0x18C0, 0x08E1, 0x3882, 0x28A3,
+    0xCB7D, 0xDB5C, 0xEB3F, 0xFB1E, 0x8BF9, 0x9BD8, 0xABBB, 0xBB9A,
+    0x4A75, 0x5A54, 0x6A37, 0x7A16, 0x0AF1, 0x1AD0, 0x2AB3, 0x3A92,
+    0xFD2E, 0xED0F, 0xDD6C, 0xCD4D, 0xBDAA, 0xAD8B, 0x9DE8, 0x8DC9,
+    0x7C26, 0x6C07, 0x5C64, 0x4C45, 0x3CA2, 0x2C83, 0x1CE0, 0x0CC1,
+    0xEF1F, 0xFF3E, 0xCF5D, 0xDF7C, 0xAF9B, 0xBFBA, 0x8FD9, 0x9FF8,
+    0x6E17, 0x7E36, 0x4E55, 0x5E74, 0x2E93, 0x3EB2, 0x0ED1, 0x1EF0,
+};
+
+uint16_t hal_rfid_crc16(const uint8_t* data, size_t len) {
+    uint16_t crc = 0xFFFF;
+    for (size_t i = 0; i < len; i++) {
+        crc = (uint16_t)((crc << 8) ^ crc_table[(crc >> 8) ^ data[i]]);
+    }
+    return crc;
+}
+
+int hal_rfid_frame_encode(uint8_t* out, const hal_rfid_frame_t* frame) {
+    if (frame->uid_len < 1 || frame->uid_len > HAL_RFID_MAX_UID) return -1;
+    int len = HAL_RFID_FIXED_LEN + frame->uid_len;
+    uint8_t* p = out;
+    *p++ = HAL_RFID_SYNC;
+    *p++ = (uint8_t)len;
+    *p++ = frame->protocol;
+    memcpy(p, frame->uid, frame->uid_len);
+    p += frame->uid_len;
+    for (int i = 0; i < 4; i++) *p++ = (uint8_t)(frame->timestamp_ms >> (8 * i));
+    *p++ = (uint8_t)frame->seq;
+    *p++ = (uint8_t)(frame->seq >> 8);
+    uint16_t crc = hal_rfid_crc16(out + 1, (size_t)len + 1);
+    *p++ = (uint8_t)crc;
+    *p++ = (uint8_t)(crc >> 8);
+    return (int)(p - out);
+}
+
+void hal_rfid_frame_reset(void) {
+    rx_head = rx_tail = 0;
+    memset(&stats, 0, sizeof(stats));
+}
+
+uint8_t* hal_rfid_rx_space(size_t* room) {
+    // Move the unfinished tail down once the free space gets short; it is
+    // under a frame long unless frames are not being taken
+    if (rx_tail > 0 && RX_SIZE - rx_head < RX_SIZE / 2) {
+        memmove(rx, rx + rx_tail, rx_head - rx_tail);
+        rx_head -= rx_tail;
+        rx_tail = 0;
+    }
+    *room = RX_SIZE - rx_head;
+    return *room ? rx + rx_head : NULL;
+}
+
+void hal_rfid_rx_commit(size_t len) {
+    if (len > RX_SIZE - rx_head) len = RX_SIZE - rx_head;
+    rx_head += len;
+}
+
+enum { FRAME_INCOMPLETE, FRAME_VALID, FRAME_BAD_LENGTH, FRAME_BAD_CRC };
+
+// Is there a frame starting at the sync byte at `pos`?
+static int check_frame(size_t pos, size_t* frame_len) {
+    size_t avail = rx_head - pos;
+    if (avail < 2) return FRAME_INCOMPLETE;
+    size_t len = rx[pos + 1];
+    if (len < HAL_RFID_FIXED_LEN + 1 || len > HAL_RFID_FIXED_LEN + HAL_RFID_MAX_UID) return FRAME_BAD_LENGTH;
+    size_t total = len + HAL_RFID_OVERHEAD;
+    if (avail < total) return FRAME_INCOMPLETE;
+    uint16_t crc = (uint16_t)(rx[pos + total - 2] | rx[pos + total - 1] << 8);
+    if (hal_rfid_crc16(rx + pos + 1, len + 1) != crc) return FRAME_BAD_CRC;
+    *frame_len = total;
+    return FRAME_VALID;
+}
+
+// First sync byte after `pos` that starts a complete, valid frame
+static size_t find_valid_frame(size_t pos) {
+    size_t frame_len;
+    for (; pos < rx_head; pos++) {
+        uint8_t* sync = memchr(rx + pos, HAL_RFID_SYNC, rx_head - pos);
+        if (!sync) break;
+        pos = (size_t)(sync - rx);
+        if (check_frame(pos, &frame_len) == FRAME_VALID) return pos;
+    }
+    return rx_head;
+}
+
+static void skip_to(size_t pos) {
+    stats.skipped_bytes += pos - rx_tail;
+    rx_tail = pos;
+}
+
+int hal_rfid_frame_next(hal_rfid_frame_t* frame) {
+    while (rx_tail < rx_head) {
+        uint8_t* sync = memchr(rx + rx_tail, HAL_RFID_SYNC, rx_head - rx_tail);
+        skip_to(sync ? (size_t)(sync - rx) : rx_head);
+        if (!sync) break;
+
+        size_t frame_len = 0;
+        int result = check_frame(rx_tail, &frame_len);
+        if (result == FRAME_INCOMPLETE) {
+            // Usually the rest is on its way. If a whole frame is already
+            // buffered behind it, though, this sync byte was noise: do not
+            // hold that frame back until more data comes.
+            size_t next = find_valid_frame(rx_tail + 1);
+            if (next == rx_head) return 0;
+            skip_to(next);
+            continue;
+        }
+        if (result != FRAME_VALID) {
+            if (result == FRAME_BAD_CRC) stats.crc_errors++;
+            skip_to(rx_tail + 1);
+            continue;
+        }
+
+        const uint8_t* p = rx + rx_tail + 2;
+        frame->protocol = *p++;
+        frame->uid_len = (uint8_t)(frame_len - HAL_RFID_OVERHEAD - HAL_RFID_FIXED_LEN);
+        frame->uid = p;
+        p += frame->uid_len;
+        frame->timestamp_ms = (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+        frame->seq = (uint16_t)(p[4] | p[5] << 8);
+        rx_tail += frame_len;
+        // A frame cut short by its last CRC byte still checks out when the
+        // next frame's sync byte equals that byte; it then ends on that sync.
+        // Leave the byte for the next call if a frame starts (or may yet
+        // start) there. After an intact frame ending in HAL_RFID_SYNC the
+        // next byte is a sync, which is no valid length, so that byte is
+        // only skipped.
+        if (rx[rx_tail - 1] == HAL_RFID_SYNC) {
+            size_t next_len;
+            int next = check_frame(rx_tail - 1, &next_len);
+            if (next == FRAME_VALID || next == FRAME_INCOMPLETE) rx_tail--;
+        }
+        stats.frames++;
+        return 1;
+    }
+    return 0;
+}
+
+int hal_rfid_frame_read(hal_rfid_frame_t* frame) {
+    int fd = hal_uart_get_fd();
+    if (fd == -1) return -1;
+
+    // Hand out what is already complete before reading more
+    if (hal_rfid_frame_next(frame)) return 1;
+
+    size_t room;
+    uint8_t* space = hal_rfid_rx_space(&room);
+    if (!space) return 0;
+    ssize_t bytes_read = read(fd, space, room);
+    if (bytes_read < 0) {
+        if (errno == EAGAIN || errno == EINTR) return 0;
+        perror("[HAL RFID] Read error");
+        return -1;
+    }
+    hal_rfid_rx_commit((size_t)bytes_read);
+    return hal_rfid_frame_next(frame);
+}
+
+void hal_rfid_frame_get_stats(hal_rfid_frame_stats_t* out) {
+    *out = stats;
+}
+
+void hal_rfid_frame_print_stats(void) {
+    printf("[HAL RFID] %lu frames, %lu CRC errors, %lu bytes skipped\n",
+           stats.frames, stats.crc_errors, stats.skipped_bytes);
+}
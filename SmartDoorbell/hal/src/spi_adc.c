@@ -45,15 +45,26 @@ void hal_spi_adc_close(int fd)
 }
 
 
+// Single-ended start command for a channel
+static void encode_command(uint8_t tx[3], int ch)
+{
+    tx[0] = (uint8_t)(0x06 | ((ch & 0x04) >> 2));
+    tx[1] = (uint8_t)((ch & 0x03) << 6);
+    tx[2] = 0x00;
+}
+
+static int decode_sample(const uint8_t rx[3])
+{
+    return ((rx[1] & 0x0F) << 8) | rx[2];
+}
+
 //channel 0 is x and channel 1 is y
 int hal_spi_adc_read_ch(int fd, int ch, uint32_t speed_hz)
 {
     if (fd < 0 || ch < 0 || ch > 7) return -1;
 
     uint8_t tx[3];
-    tx[0] = (uint8_t)(0x06 | ((ch & 0x04) >> 2));
-    tx[1] = (uint8_t)((ch & 0x03) << 6);
-    tx[2] = 0x00;
+    encode_command(tx, ch);
 
     uint8_t rx[3] = {0,0,0};
 
@@ -73,7 +84,53 @@ int hal_spi_adc_read_ch(int fd, int ch, uint32_t speed_hz)
         return -1;
     }
 
-    int val = ((rx[1] & 0x0F) << 8) | rx[2]; 
+    int val = decode_sample(rx); 
     return val;
 }
 
+// Transfer descriptors for batched reads, one set per thread. Buffer pointers
+// and lengths are set once; each call only rewrites the command bytes, speed
+// and cs_change.
+static _Thread_local struct spi_ioc_transfer batch_tr[HAL_SPI_ADC_MAX_BATCH];
+static _Thread_local uint8_t batch_tx[HAL_SPI_ADC_MAX_BATCH][3];
+static _Thread_local uint8_t batch_rx[HAL_SPI_ADC_MAX_BATCH][3];
+static _Thread_local int batch_ready = 0;
+
+int hal_spi_adc_read_channels(int fd, const int *chs, int n, int *out)
+{
+    return hal_spi_adc_read_channels_at(fd, 0, chs, n, out);
+}
+
+int hal_spi_adc_read_channels_at(int fd, uint32_t speed_hz, const int *chs, int n, int *out)
+{
+    if (fd < 0 || !chs || !out || n <= 0 || n > HAL_SPI_ADC_MAX_BATCH) return -1;
+
+    if (!batch_ready) {
+        memset(batch_tr, 0, sizeof(batch_tr));
+        for (int i = 0; i < HAL_SPI_ADC_MAX_BATCH; i++) {
+            batch_tr[i].tx_buf = (unsigned long)batch_tx[i];
+            batch_tr[i].rx_buf = (unsigned long)batch_rx[i];
+            batch_tr[i].len = 3;
+            batch_tr[i].bits_per_word = 8;
+        }
+        batch_ready = 1;
+    }
+
+    for (int i = 0; i < n; i++) {
+        if (chs[i] < 0 || chs[i] > 7) return -1;
+        encode_command(batch_tx[i], chs[i]);
+        batch_tr[i].speed_hz = speed_hz;
+        // Deselect between conversions, but not after the last one
+        batch_tr[i].cs_change = (i < n - 1);
+    }
+
+    int ret = ioctl(fd, SPI_IOC_MESSAGE(n), batch_tr);
+    if (ret < 1) {
+        perror("hal_spi_adc_read_channels: SPI_IOC_MESSAGE");
+        return -1;
+    }
+
+    for (int i = 0; i < n; i++) out[i] = decode_sample(batch_rx[i]);
+    return 0;
+}
+
@@ -0,0 +1,311 @@
+#define _GNU_SOURCE
+#include "hal/spi_adc.h"
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#define IIO_CHANNELS 8       // MCP3208
+#define PATH_LEN 256
+#define MAX_FRAME_BYTES 64
+#define READ_CHUNK 8192      // Bytes decoded per read()
+#define IIO_DEVICES "/sys/bus/iio/devices"
+#define HRTIMER_CONFIGFS "/sys/kernel/config/iio/triggers/hrtimer"
+
+// Storage of one scan element, from scan_elements/<name>_type
+// (e.g. "be:u12/16>>0": big-endian, unsigned, 12 bits in 16, no shift)
+typedef struct {
+    bool enabled;
+    int index;           // Position in the scan, from <name>_index
+    bool big_endian;
+    bool is_signed;
+    int bits;
+    int bytes;
+    int shift;
+    int offset;          // Byte offset within a frame
+} scan_element_t;
+
+static char sysfs[PATH_LEN];
+static scan_element_t voltage[IIO_CHANNELS];
+static scan_element_t timestamp;
+static int requested[IIO_CHANNELS]; // Channels in caller order
+static int num_requested = 0;
+static int frame_bytes = 0;
+static unsigned char chunk[READ_CHUNK];
+
+static int write_attr(const char *attr, const char *value)
+{
+    char path[2 * PATH_LEN];
+    snprintf(path, sizeof(path), "%s/%s", sysfs, attr);
+    int fd = open(path, O_WRONLY | O_CLOEXEC);
+    if (fd < 0) return -1;
+    ssize_t len = (ssize_t)strlen(value);
+    ssize_t n = write(fd, value, len);
+    close(fd);
+    return n == len ? 0 : -1;
+}
+
+static int write_attr_int(const char *attr, int value)
+{
+    char buf[16];
+    snprintf(buf, sizeof(buf), "%d", value);
+    return write_attr(attr, buf);
+}
+
+static int read_attr(const char *attr, char *buf, size_t len)
+{
+    char path[2 * PATH_LEN];
+    snprintf(path, sizeof(path), "%s/%s", sysfs, attr);
+    FILE *f = fopen(path, "r");
+    if (!f) return -1;
+    bool ok = fgets(buf, (int)len, f) != NULL;
+    fclose(f);
+    if (!ok) return -1;
+    buf[strcspn(buf, "\n")] = '\0';
+    return 0;
+}
+
+// First line of <dir>/<entry>/name
+static int read_name(const char *entry, char *buf, size_t len)
+{
+    char path[PATH_LEN];
+    int n = snprintf(path, sizeof(path), "%s/%s/name", IIO_DEVICES, entry);
+    if (n < 0 || (size_t)n >= sizeof(path)) return -1;
+    FILE *f = fopen(path, "r");
+    if (!f) return -1;
+    bool ok = fgets(buf, (int)len, f) != NULL;
+    fclose(f);
+    if (!ok) return -1;
+    buf[strcspn(buf, "\n")] = '\0';
+    return 0;
+}
+
+// Entry of IIO_DEVICES starting with `prefix` whose name is `name`
+static int find_entry(const char *prefix, const char *name, char *entry, size_t len)
+{
+    DIR *d = opendir(IIO_DEVICES);
+    if (!d) return -1;
+    int ret = -1;
+    struct dirent *de;
+    char buf[64];
+    while (ret != 0 && (de = readdir(d)) != NULL) {
+        if (strncmp(de->d_name, prefix, strlen(prefix)) != 0) continue;
+        if (read_name(de->d_name, buf, sizeof(buf)) != 0 || strcmp(buf, name) != 0) continue;
+        if (strlen(de->d_name) < len) {
+            strcpy(entry, de->d_name);
+            ret = 0;
+        }
+    }
+    closedir(d);
+    return ret;
+}
+
+// Read <prefix>_index and <prefix>_type of one scan element
+static int parse_element(const char *prefix, scan_element_t *e)
+{
+    char attr[64], buf[64];
+    snprintf(attr, sizeof(attr), "scan_elements/%s_index", prefix);
+    if (read_attr(attr, buf, sizeof(buf)) != 0) return -1;
+    e->index = atoi(buf);
+
+    snprintf(attr, sizeof(attr), "scan_elements/%s_type", prefix);
+    if (read_attr(attr, buf, sizeof(buf)) != 0) return -1;
+    char endian, sign;
+    unsigned bits, storage, shift;
+    if (sscanf(buf, "%ce:%c%u/%u>>%u", &endian, &sign, &bits, &storage, &shift) != 5) return -1;
+    if (storage % 8 != 0 || storage == 0 || storage > 64 || bits > storage) return -1;
+    e->big_endian = (endian == 'b');
+    e->is_signed = (sign == 's');
+    e->bits = bits;
+    e->bytes = storage / 8;
+    e->shift = shift;
+    return 0;
+}
+
+// Lay out the enabled elements in index order, each aligned to its own size
+static int compute_layout(void)
+{
+    scan_element_t *order[IIO_CHANNELS + 1];
+    int n = 0;
+    for (int ch = 0; ch < IIO_CHANNELS; ch++) {
+        if (voltage[ch].enabled) order[n++] = &voltage[ch];
+    }
+    if (timestamp.enabled) order[n++] = &timestamp;
+    for (int i = 1; i < n; i++) {
+        for (int j = i; j > 0 && order[j]->index < order[j - 1]->index; j--) {
+            scan_element_t *t = order[j];
+            order[j] = order[j - 1];
+            order[j - 1] = t;
+        }
+    }
+
+    int offset = 0, align = 1;
+    for (int i = 0; i < n; i++) {
+        int size = order[i]->bytes;
+        offset = (offset + size - 1) / size * size;
+        order[i]->offset = offset;
+        offset += size;
+        if (size > align) align = size;
+    }
+    frame_bytes = (offset + align - 1) / align * align;
+    return frame_bytes > 0 && frame_bytes <= MAX_FRAME_BYTES ? 0 : -1;
+}
+
+static int64_t decode_element(const scan_element_t *e, const unsigned char *frame)
+{
+    const unsigned char *p = frame + e->offset;
+    uint64_t raw = 0;
+    for (int i = 0; i < e->bytes; i++) {
+        int b = e->big_endian ? i : e->bytes - 1 - i;
+        raw = (raw << 8) | p[b];
+    }
+    raw >>= e->shift;
+    if (e->bits < 64) {
+        raw &= (1ULL << e->bits) - 1;
+        if (e->is_signed && (raw & (1ULL << (e->bits - 1)))) raw |= ~0ULL << e->bits;
+    }
+    return (int64_t)raw;
+}
+
+// Switch off every voltage channel, so only the requested ones end up in the scan
+static void disable_all_channels(void)
+{
+    char attr[64];
+    for (int ch = 0; ch < IIO_CHANNELS; ch++) {
+        snprintf(attr, sizeof(attr), "scan_elements/in_voltage%d_en", ch);
+        write_attr(attr, "0");
+    }
+}
+
+int hal_spi_adc_iio_find(const char *name, char *sysfs_dir, char *dev_node, size_t len)
+{
+    char entry[64];
+    if (find_entry("iio:device", name, entry, sizeof(entry)) != 0) return -1;
+    int a = snprintf(sysfs_dir, len, "%s/%s", IIO_DEVICES, entry);
+    int b = snprintf(dev_node, len, "/dev/%s", entry);
+    if (a < 0 || (size_t)a >= len || b < 0 || (size_t)b >= len) return -1;
+    return access(dev_node, R_OK) == 0 ? 0 : -1;
+}
+
+int hal_spi_adc_iio_hrtimer(const char *name, int rate_hz)
+{
+    if (!name || rate_hz <= 0) return -1;
+    char path[PATH_LEN];
+    int n = snprintf(path, sizeof(path), "%s/%s", HRTIMER_CONFIGFS, name);
+    if (n < 0 || (size_t)n >= sizeof(path)) return -1;
+    // Creating the configfs directory registers the trigger
+    if (mkdir(path, 0755) != 0 && errno != EEXIST) return -1;
+
+    char entry[64];
+    if (find_entry("trigger", name, entry, sizeof(entry)) != 0) return -1;
+    n = snprintf(path, sizeof(path), "%s/%s/sampling_frequency", IIO_DEVICES, entry);
+    if (n < 0 || (size_t)n >= sizeof(path)) return -1;
+    int fd = open(path, O_WRONLY | O_CLOEXEC);
+    if (fd < 0) return -1;
+    char value[16];
+    int len = snprintf(value, sizeof(value), "%d", rate_hz);
+    bool ok = write(fd, value, len) == len;
+    close(fd);
+    return ok ? 0 : -1;
+}
+
+int hal_spi_adc_iio_open(const char *sysfs_dir, const char *dev_node, const char *trigger,
+                         const int *chs, int n, int buffer_len)
+{
+    if (!sysfs_dir || !dev_node || !chs || n <= 0 || n > IIO_CHANNELS || buffer_len <= 0) return -1;
+    if (strlen(sysfs_dir) >= PATH_LEN) return -1;
+    strcpy(sysfs, sysfs_dir);
+
+    // Scan elements can only be changed while the buffer is off
+    write_attr("buffer/enable", "0");
+    disable_all_channels();
+    // Timestamps on the same clock as the rest of the HAL (older kernels lack this)
+    write_attr("current_timestamp_clock", "monotonic");
+    memset(voltage, 0, sizeof(voltage));
+    memset(&timestamp, 0, sizeof(timestamp));
+
+    char prefix[32], attr[64];
+    for (int i = 0; i < n; i++) {
+        int ch = chs[i];
+        if (ch < 0 || ch >= IIO_CHANNELS || voltage[ch].enabled) return -1;
+        snprintf(prefix, sizeof(prefix), "in_voltage%d", ch);
+        snprintf(attr, sizeof(attr), "scan_elements/%s_en", prefix);
+        if (parse_element(prefix, &voltage[ch]) != 0 || write_attr(attr, "1") != 0) {
+            fprintf(stderr, "[HAL IIO] Cannot enable channel %d in %s\n", ch, sysfs_dir);
+            return -1;
+        }
+        voltage[ch].enabled = true;
+        requested[i] = ch;
+    }
+    num_requested = n;
+    if (parse_element("in_timestamp", &timestamp) == 0 &&
+        write_attr("scan_elements/in_timestamp_en", "1") == 0) {
+        timestamp.enabled = true;
+    }
+    if (compute_layout() != 0) {
+        fprintf(stderr, "[HAL IIO] Unsupported scan layout in %s\n", sysfs_dir);
+        return -1;
+    }
+
+    if (trigger && write_attr("trigger/current_trigger", trigger) != 0) {
+        fprintf(stderr, "[HAL IIO] Cannot attach trigger %s\n", trigger);
+        return -1;
+    }
+    if (write_attr_int("buffer/length", buffer_len) != 0) {
+        perror("[HAL IIO] Cannot set buffer length");
+        return -1;
+    }
+    // Wake the reader once a quarter of the buffer is queued (older kernels lack this)
+    write_attr_int("buffer/watermark", buffer_len / 4 > 0 ? buffer_len / 4 : 1);
+
+    int fd = open(dev_node, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        perror("[HAL IIO] Unable to open device node");
+        return -1;
+    }
+    if (write_attr("buffer/enable", "1") != 0) {
+        perror("[HAL IIO] Cannot enable buffer");
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int hal_spi_adc_iio_read(int fd, int *values, int64_t *timestamps, int max_frames)
+{
+    if (fd < 0 || !values || max_frames <= 0 || frame_bytes == 0) return -1;
+    int want = max_frames;
+    if (want > READ_CHUNK / frame_bytes) want = READ_CHUNK / frame_bytes;
+
+    // The IIO core only hands out whole scans
+    ssize_t got = read(fd, chunk, (size_t)want * frame_bytes);
+    if (got < 0) {
+        if (errno == EAGAIN || errno == EINTR) return 0;
+        perror("[HAL IIO] read");
+        return -1;
+    }
+
+    int frames = (int)(got / frame_bytes);
+    for (int f = 0; f < frames; f++) {
+        const unsigned char *frame = chunk + (size_t)f * frame_bytes;
+        for (int i = 0; i < num_requested; i++) {
+            values[f * num_requested + i] = (int)decode_element(&voltage[requested[i]], frame);
+        }
+        if (timestamps) timestamps[f] = timestamp.enabled ? decode_element(&timestamp, frame) : 0;
+    }
+    return frames;
+}
+
+void hal_spi_adc_iio_close(int fd)
+{
+    if (fd < 0) return;
+    write_attr("buffer/enable", "0");
+    disable_all_channels();
+    close(fd);
+    frame_bytes = 0;
+}
@@ -0,0 +1,192 @@
+#define _GNU_SOURCE
+#include "hal/spi_bus.h"
+#include "hal/spi_adc.h"
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#define MAX_BUSES 2
+#define MAX_CLIENTS 8
+#define PATH_LEN 64
+#define BITS_PER_SAMPLE 24 // 3-byte MCP3208 transfer
+
+typedef struct {
+    char device[PATH_LEN];
+    int fd;                   // -1 when the slot is free
+    int clients;
+    pthread_mutex_t lock;     // Held for the whole of each transaction
+    double busy_ms;
+    double opened_ms;
+} spi_bus_t;
+
+typedef struct {
+    spi_bus_t *bus;           // NULL when the slot is free
+    hal_spi_bus_client_stats_t stats;
+} spi_client_t;
+
+static spi_bus_t buses[MAX_BUSES] = {
+    { .fd = -1, .lock = PTHREAD_MUTEX_INITIALIZER },
+    { .fd = -1, .lock = PTHREAD_MUTEX_INITIALIZER },
+};
+static spi_client_t clients[MAX_CLIENTS];
+// Guards attach/detach (bus and client slots), not transactions. Taken
+// before a bus lock, never while holding one.
+static pthread_mutex_t registry_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static double now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+static spi_bus_t *get_bus(const char *device)
+{
+    spi_bus_t *free_bus = NULL;
+    for (int i = 0; i < MAX_BUSES; i++) {
+        if (buses[i].fd >= 0 && strcmp(buses[i].device, device) == 0) return &buses[i];
+        if (buses[i].fd < 0 && !free_bus) free_bus = &buses[i];
+    }
+    if (!free_bus || strlen(device) >= PATH_LEN) return NULL;
+
+    // Speed 0 leaves the device default alone; each transfer sets its own
+    int fd = hal_spi_adc_open(device, 0);
+    if (fd < 0) return NULL;
+    strcpy(free_bus->device, device);
+    free_bus->fd = fd;
+    free_bus->clients = 0;
+    free_bus->busy_ms = 0;
+    free_bus->opened_ms = now_ms();
+    return free_bus;
+}
+
+int hal_spi_bus_attach(const char *device, const char *name, uint32_t speed_hz)
+{
+    if (!device || speed_hz == 0) return -1;
+
+    int handle = -1;
+    pthread_mutex_lock(&registry_lock);
+    for (int i = 0; i < MAX_CLIENTS; i++) {
+        if (clients[i].bus) continue;
+        spi_bus_t *bus = get_bus(device);
+        if (!bus) break;
+        bus->clients++;
+        memset(&clients[i].stats, 0, sizeof(clients[i].stats));
+        clients[i].stats.name = name ? name : "?";
+        clients[i].stats.speed_hz = speed_hz;
+        clients[i].bus = bus;
+        handle = i;
+        break;
+    }
+    pthread_mutex_unlock(&registry_lock);
+    if (handle < 0) fprintf(stderr, "[HAL SPI] Cannot attach %s to %s\n", name ? name : "client", device);
+    return handle;
+}
+
+void hal_spi_bus_detach(int client)
+{
+    if (client < 0 || client >= MAX_CLIENTS) return;
+    pthread_mutex_lock(&registry_lock);
+    spi_bus_t *bus = clients[client].bus;
+    if (bus) {
+        clients[client].bus = NULL;
+        if (--bus->clients == 0) {
+            // Waits out a transaction still running on the fd
+            pthread_mutex_lock(&bus->lock);
+            hal_spi_adc_close(bus->fd);
+            bus->fd = -1;
+            pthread_mutex_unlock(&bus->lock);
+        }
+    }
+    pthread_mutex_unlock(&registry_lock);
+}
+
+// Lock the client's bus, or return NULL if the client is not attached. Once
+// the bus lock is held, detach cannot close the fd underneath the caller.
+static spi_bus_t *lock_client_bus(int client)
+{
+    if (client < 0 || client >= MAX_CLIENTS) return NULL;
+    pthread_mutex_lock(&registry_lock);
+    spi_bus_t *bus = clients[client].bus;
+    if (bus) pthread_mutex_lock(&bus->lock);
+    pthread_mutex_unlock(&registry_lock);
+    return bus;
+}
+
+int hal_spi_bus_read_channels(int client, const int *chs, int n, int *out)
+{
+    spi_bus_t *bus = lock_client_bus(client);
+    if (!bus) return -1;
+    spi_client_t *c = &clients[client];
+
+    double start = now_ms();
+    int ret = hal_spi_adc_read_channels_at(bus->fd, c->stats.speed_hz, chs, n, out);
+    double held = now_ms() - start;
+    bus->busy_ms += held;
+    c->stats.transactions++;
+    c->stats.busy_ms += held;
+    if (ret == 0) {
+        c->stats.samples += n;
+        c->stats.wire_ms += n * BITS_PER_SAMPLE * 1000.0 / c->stats.speed_hz;
+    } else {
+        c->stats.errors++;
+    }
+    pthread_mutex_unlock(&bus->lock);
+    return ret;
+}
+
+int hal_spi_bus_get_client_stats(int client, hal_spi_bus_client_stats_t *stats)
+{
+    spi_bus_t *bus = lock_client_bus(client);
+    if (!bus) return -1;
+    *stats = clients[client].stats;
+    pthread_mutex_unlock(&bus->lock);
+    return 0;
+}
+
+void hal_spi_bus_print_stats(void)
+{
+    static hal_spi_bus_client_stats_t prev[MAX_CLIENTS];
+    static double prev_busy[MAX_BUSES];
+    static double prev_ms[MAX_BUSES];
+
+    pthread_mutex_lock(&registry_lock);
+    double now = now_ms();
+    for (int b = 0; b < MAX_BUSES; b++) {
+        spi_bus_t *bus = &buses[b];
+        if (bus->fd < 0) continue;
+
+        pthread_mutex_lock(&bus->lock);
+        // First report since the device was (re)opened
+        if (prev_ms[b] < bus->opened_ms) {
+            prev_ms[b] = bus->opened_ms;
+            prev_busy[b] = 0;
+        }
+        double window = now - prev_ms[b];
+        if (window > 0) {
+            printf("[HAL SPI] %s: %d clients, busy %.2f%%\n", bus->device, bus->clients,
+                   (bus->busy_ms - prev_busy[b]) * 100.0 / window);
+        }
+        for (int i = 0; i < MAX_CLIENTS && window > 0; i++) {
+            spi_client_t *c = &clients[i];
+            if (c->bus != bus) continue;
+            hal_spi_bus_client_stats_t *p = &prev[i];
+            // A slot reused by a new client starts from zero
+            if (p->name != c->stats.name || p->transactions > c->stats.transactions) memset(p, 0, sizeof(*p));
+            printf("[HAL SPI]   %-10s %4u kHz: %.1f transactions/s, %.1f samples/s, %lu errors, busy %.2f%% (wire %.2f%%)\n",
+                   c->stats.name, c->stats.speed_hz / 1000,
+                   (c->stats.transactions - p->transactions) * 1000.0 / window,
+                   (c->stats.samples - p->samples) * 1000.0 / window,
+                   c->stats.errors,
+                   (c->stats.busy_ms - p->busy_ms) * 100.0 / window,
+                   (c->stats.wire_ms - p->wire_ms) * 100.0 / window);
+            *p = c->stats;
+        }
+        prev_busy[b] = bus->busy_ms;
+        prev_ms[b] = now;
+        pthread_mutex_unlock(&bus->lock);
+    }
+    pthread_mutex_unlock(&registry_lock);
+}
@@ -6,33 +6,74 @@
 #include <fcntl.h>
 #include <termios.h>
 #include <errno.h>
+#include <time.h>
+#include <poll.h>
+
+#define RX_RING_SIZE 512   // Power of two
+#define RX_RING_MASK (RX_RING_SIZE - 1)
+#define FRAME_GAP_MS 100   // Silence that abandons an unfinished frame
 
 static int uart_fd = -1;
 
-int hal_uart_init(const char* device, int baud_rate) {
-    // Open in Read/Write, No Controlling TTY, Non-Blocking mode
-    uart_fd = open(device, O_RDWR | O_NOCTTY | O_NDELAY);
+// Received bytes; free-running indexes. Bytes before rx_scan are known not
+// to end a frame.
+static unsigned char rx_ring[RX_RING_SIZE];
+static unsigned int rx_head = 0;
+static unsigned int rx_tail = 0;
+static unsigned int rx_scan = 0;
+static int rx_discarding = 0;      // Line too long: drop up to the next terminator
+static int rx_fragmented = 0;      // The pending frame started in an earlier read
+static long long rx_last_ms = 0;   // When the last bytes arrived
+static hal_uart_frame_stats_t frame_stats;
+
+// Rates with a termios speed code; anything else goes through hal_uart_set_baud()
+static speed_t standard_speed(int baud_rate) {
+    switch(baud_rate) {
+        case 9600:    return B9600;
+        case 19200:   return B19200;
+        case 38400:   return B38400;
+        case 57600:   return B57600;
+        case 115200:  return B115200;
+        case 230400:  return B230400;
+        case 460800:  return B460800;
+        case 500000:  return B500000;
+        case 576000:  return B576000;
+        case 921600:  return B921600;
+        case 1000000: return B1000000;
+        case 1500000: return B1500000;
+        case 2000000: return B2000000;
+        case 3000000: return B3000000;
+        case 4000000: return B4000000;
+        default:      return B0;
+    }
+}
+
+int hal_uart_open(const char* device, const hal_uart_config_t* config) {
+    if (!config || config->baud_rate <= 0 || config->vmin < 0 || config->vmin > 255 ||
+        config->vtime_ds < 0 || config->vtime_ds > 255) {
+        return -1;
+    }
+    // Open in Read/Write, No Controlling TTY; non-blocking unless asked otherwise
+    int flags = O_RDWR | O_NOCTTY | O_CLOEXEC;
+    if (!config->blocking) flags |= O_NONBLOCK;
+    uart_fd = open(device, flags);
     if (uart_fd == -1) {
         perror("[HAL UART] Unable to open UART");
         return -1;
     }
 
     struct termios options;
-    tcgetattr(uart_fd, &options);
+    if (tcgetattr(uart_fd, &options) != 0) {
+        perror("[HAL UART] tcgetattr");
+        hal_uart_cleanup();
+        return -1;
+    }
 
-    // Set Baud Rate (supports common rates)
-    speed_t baud;
-    switch(baud_rate) {
-        case 9600:   baud = B9600; break;
-        case 19200:  baud = B19200; break;
-        case 38400:  baud = B38400; break;
-        case 57600:  baud = B57600; break;
-        case 115200: baud = B115200; break;
-        default:     baud = B9600; printf("[HAL UART] Warning: Defaulting to 9600\n"); break;
+    speed_t baud = standard_speed(config->baud_rate);
+    if (baud != B0) {
+        cfsetispeed(&options, baud);
+        cfsetospeed(&options, baud);
     }
-    
-    cfsetispeed(&options, baud);
-    cfsetospeed(&options, baud);
 
     // --- Configure 8N1 (8 bits, No parity, 1 stop bit) ---
     options.c_cflag &= ~PARENB; // No parity
@@ -55,29 +96,185 @@ int hal_uart_init(const char* device, int baud_rate) {
     // Canonical mode off (raw input), no echo
     options.c_lflag &= ~(ICANON | ECHO | ECHOE | ISIG);
 
+    // --- Read wakeups (blocking mode) ---
+    options.c_cc[VMIN] = (cc_t)config->vmin;
+    options.c_cc[VTIME] = (cc_t)config->vtime_ds;
+
     // Apply settings
-    tcsetattr(uart_fd, TCSANOW, &options);
-    
-    // Ensure non-blocking is set explicitly
-    fcntl(uart_fd, F_SETFL, FNDELAY);
+    if (tcsetattr(uart_fd, TCSANOW, &options) != 0) {
+        perror("[HAL UART] tcsetattr");
+        hal_uart_cleanup();
+        return -1;
+    }
+    if (baud == B0 && hal_uart_set_baud(config->baud_rate) != 0) {
+        printf("[HAL UART] %d baud is not supported by %s\n", config->baud_rate, device);
+        hal_uart_cleanup();
+        return -1;
+    }
 
-    printf("[HAL UART] Initialized %s at %d baud\n", device, baud_rate);
+    int actual = hal_uart_get_baud();
+    if (actual > 0 && actual != config->baud_rate) {
+        printf("[HAL UART] Initialized %s at %d baud (%d requested)\n", device, actual, config->baud_rate);
+    } else {
+        printf("[HAL UART] Initialized %s at %d baud\n", device, config->baud_rate);
+    }
     return 0;
 }
 
+int hal_uart_init(const char* device, int baud_rate) {
+    hal_uart_config_t config = { .baud_rate = baud_rate, .blocking = false };
+    return hal_uart_open(device, &config);
+}
+
 int hal_uart_read(char* buffer, int max_len) {
     if (uart_fd == -1) return -1;
     
     int bytes_read = read(uart_fd, buffer, max_len);
     if (bytes_read < 0) {
         // EAGAIN means no data available right now (normal for non-blocking)
-        if (errno == EAGAIN) return 0; 
+        if (errno == EAGAIN || errno == EINTR) return 0;
         perror("[HAL UART] Read error");
         return -1;
     }
     return bytes_read;
 }
 
+int hal_uart_read_timeout(char* buffer, int max_len, int timeout_ms) {
+    if (uart_fd == -1) return -1;
+    struct pollfd pfd = { .fd = uart_fd, .events = POLLIN };
+    int ready = poll(&pfd, 1, timeout_ms);
+    if (ready < 0) {
+        if (errno == EINTR) return 0;
+        perror("[HAL UART] poll");
+        return -1;
+    }
+    if (ready == 0) return 0;
+    return hal_uart_read(buffer, max_len);
+}
+
+static long long monotonic_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000LL + ts.tv_nsec / 1000000LL;
+}
+
+// Called before new bytes are added
+static void rx_arrival(void) {
+    long long now = monotonic_ms();
+    unsigned int pending = rx_head - rx_tail;
+    if (pending > 0 && rx_scan == rx_head) {
+        // Only the start of a frame is waiting
+        if (now - rx_last_ms > FRAME_GAP_MS) {
+            if (rx_discarding) frame_stats.overflow_bytes += pending;
+            else frame_stats.partial_bytes += pending;
+            rx_tail = rx_head;
+            rx_discarding = 0;
+        } else {
+            rx_fragmented = 1;
+        }
+    }
+    rx_last_ms = now;
+}
+
+int hal_uart_frame_feed(const char* data, int len) {
+    if (len <= 0) return 0;
+    rx_arrival();
+    int room = RX_RING_SIZE - (int)(rx_head - rx_tail);
+    int n = len < room ? len : room;
+    for (int i = 0; i < n; i++) rx_ring[(rx_head + i) & RX_RING_MASK] = (unsigned char)data[i];
+    rx_head += n;
+    frame_stats.overflow_bytes += len - n;
+    return n;
+}
+
+static int is_hex(unsigned char c) {
+    return (c >= '0' && c <= '9') || (c >= 'A' && c <= 'F') || (c >= 'a' && c <= 'f');
+}
+
+int hal_uart_frame_next(char* frame, int max_len) {
+    if (!frame || max_len <= HAL_UART_MAX_FRAME) return -1;
+    for (; rx_scan != rx_head; rx_scan++) {
+        unsigned char c = rx_ring[rx_scan & RX_RING_MASK];
+        if (c != '\r' && c != '\n') {
+            if (rx_scan + 1 - rx_tail > HAL_UART_MAX_FRAME) {
+                // Too long for a tag: drop it as it arrives
+                frame_stats.overflow_bytes += rx_scan + 1 - rx_tail;
+                rx_tail = rx_scan + 1;
+                rx_discarding = 1;
+            }
+            continue;
+        }
+
+        unsigned int start = rx_tail;
+        int len = (int)(rx_scan - start);
+        rx_tail = rx_scan + 1;
+        if (rx_discarding) {
+            frame_stats.overflow_bytes += len;
+            rx_discarding = 0;
+            rx_fragmented = 0;
+            continue;
+        }
+        if (len == 0) continue; // Second half of CRLF, or a blank line
+
+        int valid = len % 2 == 0;
+        for (int i = 0; i < len && valid; i++) valid = is_hex(rx_ring[(start + i) & RX_RING_MASK]);
+        if (!valid) {
+            frame_stats.garbage_bytes += len;
+            rx_fragmented = 0;
+            continue;
+        }
+        for (int i = 0; i < len; i++) frame[i] = (char)rx_ring[(start + i) & RX_RING_MASK];
+        frame[len] = '\0';
+        frame_stats.frames++;
+        if (rx_fragmented) frame_stats.reassembled++;
+        rx_fragmented = 0;
+        rx_scan++;
+        return len;
+    }
+    return 0;
+}
+
+int hal_uart_read_frame(char* frame, int max_len) {
+    if (uart_fd == -1) return -1;
+
+    // Hand out what is already complete before reading more
+    int len = hal_uart_frame_next(frame, max_len);
+    if (len != 0) return len;
+
+    unsigned int room = RX_RING_SIZE - (rx_head - rx_tail);
+    if (room > 0) {
+        // Contiguous free space up to the end of the ring
+        unsigned int offset = rx_head & RX_RING_MASK;
+        unsigned int chunk = RX_RING_SIZE - offset < room ? RX_RING_SIZE - offset : room;
+        int bytes_read = read(uart_fd, rx_ring + offset, chunk);
+        if (bytes_read < 0) {
+            if (errno == EAGAIN || errno == EINTR) return 0;
+            perror("[HAL UART] Read error");
+            return -1;
+        }
+        if (bytes_read > 0) {
+            // The bytes are already in place; account for them as an arrival
+            rx_arrival();
+            rx_head += bytes_read;
+        }
+    }
+    return hal_uart_frame_next(frame, max_len);
+}
+
+void hal_uart_get_frame_stats(hal_uart_frame_stats_t* stats) {
+    *stats = frame_stats;
+}
+
+void hal_uart_print_frame_stats(void) {
+    printf("[HAL UART] %lu frames (%lu reassembled); dropped bytes: %lu partial, %lu overflow, %lu garbage\n",
+           frame_stats.frames, frame_stats.reassembled, frame_stats.partial_bytes,
+           frame_stats.overflow_bytes, frame_stats.garbage_bytes);
+}
+
+int hal_uart_get_fd(void) {
+    return uart_fd;
+}
+
 void hal_uart_write(const char* buffer) {
     if (uart_fd == -1) return;
     int len = strlen(buffer);
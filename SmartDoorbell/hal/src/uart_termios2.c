@@ -0,0 +1,36 @@
+// Arbitrary UART speeds through the Linux termios2 interface. Kept apart from
+// uart.c because <asm/termbits.h> and glibc's <termios.h> define the same types.
+#include "hal/uart.h"
+#include <stdio.h>
+#include <sys/ioctl.h>
+#include <asm/termbits.h>
+
+int hal_uart_set_baud(int baud_rate)
+{
+    int fd = hal_uart_get_fd();
+    if (fd < 0 || baud_rate <= 0) return -1;
+
+    struct termios2 tio;
+    if (ioctl(fd, TCGETS2, &tio) != 0) {
+        perror("[HAL UART] TCGETS2");
+        return -1;
+    }
+    // BOTHER: take the rate from c_ispeed/c_ospeed instead of a Bxxx code
+    tio.c_cflag &= ~(CBAUD | (CBAUD << IBSHIFT));
+    tio.c_cflag |= BOTHER | (BOTHER << IBSHIFT);
+    tio.c_ispeed = baud_rate;
+    tio.c_ospeed = baud_rate;
+    if (ioctl(fd, TCSETS2, &tio) != 0) {
+        perror("[HAL UART] TCSETS2");
+        return -1;
+    }
+    return 0;
+}
+
+int hal_uart_get_baud(void)
+{
+    int fd = hal_uart_get_fd();
+    struct termios2 tio;
+    if (fd < 0 || ioctl(fd, TCGETS2, &tio) != 0) return -1;
+    return (int)tio.c_ospeed;
+}
@@ -32,6 +32,31 @@ const UDP_SERVER_ADDRESS = '127.0.0.1';
 // Path where the C app saves the image before sending the UDP alert
 const LOCAL_IMAGE_PATH = '/tmp/visitor.jpg';
 
+// Frames from the seconds before the alert, exported by the C app next to the snapshot.
+// index.txt lists "<file> <unix time ms> <ms before alert>", oldest first.
+const PREROLL_DIR = '/tmp/preroll';
+const MAX_PREROLL_ATTACHMENTS = 9; // Discord allows 10 files per message, one is the snapshot
+
+/**
+ * @brief Picks up to MAX_PREROLL_ATTACHMENTS pre-event frames, evenly spaced over the window.
+ * @returns {Array<{path: string, name: string}>} Empty if no pre-event frames were exported.
+ */
+const getPrerollFrames = () => {
+    let lines;
+    try {
+        lines = fs.readFileSync(`${PREROLL_DIR}/index.txt`, 'utf8').trim().split('\n').filter(Boolean);
+    } catch (e) {
+        return [];
+    }
+    const count = Math.min(lines.length, MAX_PREROLL_ATTACHMENTS);
+    const frames = [];
+    for (let i = 0; i < count; i++) {
+        const [file, , msBefore] = lines[Math.floor(i * lines.length / count)].split(' ');
+        frames.push({ path: `${PREROLL_DIR}/${file}`, name: `before_${msBefore}ms.jpg` });
+    }
+    return frames;
+};
+
 // --- DISCORD FUNCTION WITH IMAGE ---
 /**
  * @brief Sends an alert message with an image attachment to Discord.
@@ -43,15 +68,20 @@ const sendDiscordAlert = async (message) => {
     // --- Dynamic Title Logic ---
     let alertTitle = "🚨 Security Alert";
     const msgLower = message.toLowerCase();
+    // The C app only exports pre-event frames for these alerts
+    let withPreroll = false;
 
     if (msgLower.includes("motion")) {
         alertTitle = "📸 Motion Detected";
+        withPreroll = true;
     } else if (msgLower.includes("tamper")) {
         alertTitle = "⚠️ Tamper Alert!";
+        withPreroll = true;
     } else if (msgLower.includes("unlocked")) {
         alertTitle = "🔓 Door Unlocked";
     } else if (msgLower.includes("button") || msgLower.includes("pressed")) {
         alertTitle = "🔔 Doorbell Ring";
+        withPreroll = true;
     }
 
     try {
@@ -73,6 +103,13 @@ const sendDiscordAlert = async (message) => {
         
         // Attach the image file stream
         form.append('file', imageStream, 'snapshot.jpg');
+
+        // Attach the frames leading up to the alert as extra files
+        (withPreroll ? getPrerollFrames() : []).forEach((frame, i) => {
+            if (fs.existsSync(frame.path)) {
+                form.append(`file${i + 1}`, fs.createReadStream(frame.path), frame.name);
+            }
+        });
         
         // Attach the JSON payload for the message content (embeds, text, etc.)
         const payload = {
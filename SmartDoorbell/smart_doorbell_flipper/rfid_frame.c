@@ -0,0 +1,47 @@
+/**
+ * @file rfid_frame.c
+ * @brief Encoder for the binary RFID frame (see rfid_frame.h).
+ */
+#include "rfid_frame.h"
+#include <string.h>
+
+// CRC-16/CCITT-FALSE, bit by bit: a frame is a few dozen bytes per tag read,
+// not worth a 512 byte table in flash
+static uint16_t crc16(const uint8_t* data, size_t len) {
+    uint16_t crc = 0xFFFF;
+    for(size_t i = 0; i < len; i++) {
+        crc ^= (uint16_t)(data[i] << 8);
+        for(int bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+size_t rfid_frame_encode(
+    uint8_t* out,
+    uint8_t protocol,
+    const uint8_t* uid,
+    size_t uid_len,
+    uint32_t tick_ms,
+    uint16_t seq) {
+    if(uid_len < 1 || uid_len > RFID_FRAME_MAX_UID) return 0;
+
+    uint8_t* p = out;
+    *p++ = RFID_FRAME_SYNC;
+    *p++ = (uint8_t)(RFID_FRAME_FIXED_LEN + uid_len);
+    *p++ = protocol;
+    memcpy(p, uid, uid_len);
+    p += uid_len;
+    for(int i = 0; i < 4; i++) {
+        *p++ = (uint8_t)(tick_ms >> (8 * i));
+    }
+    *p++ = (uint8_t)seq;
+    *p++ = (uint8_t)(seq >> 8);
+
+    // Everything after the sync byte
+    uint16_t crc = crc16(out + 1, (size_t)(p - out - 1));
+    *p++ = (uint8_t)crc;
+    *p++ = (uint8_t)(crc >> 8);
+    return (size_t)(p - out);
+}
@@ -0,0 +1,30 @@
+/**
+ * @file rfid_frame.h
+ * @brief Binary frame carrying one tag read to the doorbell board.
+ * * Same format as SmartDoorbell/hal/include/hal/rfid_frame.h, which decodes
+ * it; change both together. Multi-byte fields are little-endian:
+ * sync 0xA5 | len | protocol | UID (1-16 bytes) | read tick (u32, ms) |
+ * sequence (u16) | CRC-16/CCITT-FALSE over len..sequence (u16).
+ * * Plain C with no Furi dependencies.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define RFID_FRAME_SYNC 0xA5
+#define RFID_FRAME_MAX_UID 16
+#define RFID_FRAME_FIXED_LEN 7 // protocol + tick + sequence
+#define RFID_FRAME_MAX_SIZE (4 + RFID_FRAME_FIXED_LEN + RFID_FRAME_MAX_UID)
+
+/**
+ * @brief Encodes one tag read into `out` (at least RFID_FRAME_MAX_SIZE bytes)
+ * @return Frame length, or 0 if the UID length is out of range
+ */
+size_t rfid_frame_encode(
+    uint8_t* out,
+    uint8_t protocol,
+    const uint8_t* uid,
+    size_t uid_len,
+    uint32_t tick_ms,
+    uint16_t seq);
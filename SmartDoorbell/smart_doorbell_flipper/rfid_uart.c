@@ -2,7 +2,8 @@
  * @file rfid_uart.c
  * @brief Flipper Zero Application: RFID to UART Bridge
  * * This application scans for 125kHz RFID tags (LFRFID) and transmits 
- * the detected Unique ID (UID) over the GPIO UART pins.
+ * the detected Unique ID (UID) over the GPIO UART pins, one CRC-checked
+ * binary frame per read (see rfid_frame.h).
  * * Hardware Connections:
  * - Flipper Pin 13 (TX) -> Receiver RX
  * - Flipper Pin 14 (RX) -> Receiver TX
@@ -11,8 +12,11 @@
 #include <furi.h>
 #include <furi_hal.h>
 #include <gui/gui.h>
+#include <notification/notification_messages.h>
 #include <lfrfid/lfrfid_worker.h>
 #include <lfrfid/protocols/lfrfid_protocols.h>
+#include "rfid_frame.h"
+#include "tag_dedupe.h"
 
 // --- CONFIGURATION ---
 
@@ -20,13 +24,17 @@
 #define UART_CH FuriHalSerialIdUsart
 #define BAUDRATE 9600
 
+// A tag held against the reader is sent once; it is sent again only after
+// it has been out of range this long
+#define DEDUPE_HOLD_MS 1000
+
 // --- EVENT SYSTEM ---
 
 /**
  * @brief Event types used to notify the main thread
  */
 typedef enum {
-    EventTypeTick,      // Timer tick (unused in this simple app)
+    EventTypeTick,      // Dedupe timer: a remembered tag may have gone
     EventTypeKey,       // Hardware button inputs
     EventTypeRfidRead   // RFID tag successfully read
 } EventType;
@@ -37,7 +45,12 @@ typedef enum {
 typedef struct {
     EventType type;
     InputEvent input;       // Payload for Key events
-    char rfid_data[32];     // Payload for RFID events (Hex String of UID)
+    // Payload for RFID events
+    uint8_t uid[RFID_FRAME_MAX_UID];
+    uint8_t uid_len;
+    uint8_t protocol;
+    uint32_t read_tick;     // furi_get_tick() when the tag was read
+    char rfid_data[2 * RFID_FRAME_MAX_UID + 1]; // Hex String of UID, for the screen and log
 } AppEvent;
 
 // --- APP STATE ---
@@ -53,19 +66,25 @@ typedef struct {
     FuriHalSerialHandle* serial_handle; // Handle for UART communication
     FuriMessageQueue* event_queue;      // Queue to pass events to main thread
     FuriString* temp_str;               // Helper string for UI rendering
+    uint16_t tx_seq;                    // Sequence number of the next frame
+    NotificationApp* notifications;     // Runs haptics without blocking us
+    TagDedupe dedupe;                   // Tags recently sent (main thread only)
+    FuriTimer* dedupe_timer;            // Fires when the next one should be forgotten
 } RfidUartApp;
 
 // --- UART SENDER ---
 
 /**
- * @brief Transmits a string followed by a newline over UART
+ * @brief Transmits one tag read as a binary frame over UART
  * @param app Pointer to app state
- * @param str Null-terminated string to send
+ * @param event RFID event carrying the read
  */
-void send_uart_string(RfidUartApp* app, const char* str) {
+void send_uart_frame(RfidUartApp* app, const AppEvent* event) {
     if(app->serial_handle) {
-        furi_hal_serial_tx(app->serial_handle, (uint8_t*)str, strlen(str));
-        furi_hal_serial_tx(app->serial_handle, (uint8_t*)"\r\n", 2); // Standard CRLF
+        uint8_t frame[RFID_FRAME_MAX_SIZE];
+        size_t len = rfid_frame_encode(
+            frame, event->protocol, event->uid, event->uid_len, event->read_tick, app->tx_seq++);
+        if(len > 0) furi_hal_serial_tx(app->serial_handle, frame, len);
     }
 }
 
@@ -85,13 +104,14 @@ static void lfrfid_read_callback(LFRFIDWorkerReadResult result, ProtocolId proto
         size_t data_size = protocol_dict_get_data_size(app->dict, protocol);
         
         // 2. Sanity check to prevent buffer overflow (most tags are 5-7 bytes)
-        if(data_size > 0 && data_size < 10) { 
-            uint8_t* data = malloc(data_size);
-            protocol_dict_get_data(app->dict, protocol, data, data_size);
-
+        if(data_size > 0 && data_size <= RFID_FRAME_MAX_UID) { 
             // 3. Prepare the event
             AppEvent event;
             event.type = EventTypeRfidRead;
+            event.read_tick = furi_get_tick();
+            event.protocol = (uint8_t)protocol;
+            event.uid_len = (uint8_t)data_size;
+            protocol_dict_get_data(app->dict, protocol, event.uid, data_size);
             event.rfid_data[0] = '\0'; // Initialize string
             
             // 4. Convert Raw Bytes -> Hex String
@@ -100,9 +120,8 @@ static void lfrfid_read_callback(LFRFIDWorkerReadResult result, ProtocolId proto
             char* ptr = event.rfid_data;
             for(size_t i = 0; i < data_size; i++) {
                 // formatting: %02X ensures 0x5 becomes "05"
-                ptr += snprintf(ptr, 32 - (ptr - event.rfid_data), "%02X", data[i]);
+                ptr += snprintf(ptr, sizeof(event.rfid_data) - (ptr - event.rfid_data), "%02X", event.uid[i]);
             }
-            free(data);
 
             // 5. Send to Main Thread
             // '0' timeout means if queue is full, drop the packet (don't block)
@@ -124,6 +143,28 @@ static void input_callback(InputEvent* input_event, void* ctx) {
     furi_message_queue_put(app->event_queue, &event, 0);
 }
 
+// --- DEDUPE TIMER (Runs in Timer Thread) ---
+
+/**
+ * @brief Wakes the main loop to forget tags that have left the reader
+ */
+static void dedupe_timer_callback(void* ctx) {
+    RfidUartApp* app = ctx;
+    AppEvent event;
+    event.type = EventTypeTick;
+    furi_message_queue_put(app->event_queue, &event, 0);
+}
+
+/**
+ * @brief Forgets expired tags and arms the timer for the next one
+ */
+static void dedupe_expire(RfidUartApp* app) {
+    uint32_t next_ms = tag_dedupe_expire(&app->dedupe, furi_get_tick());
+    if(next_ms > 0) {
+        furi_timer_start(app->dedupe_timer, furi_ms_to_ticks(next_ms));
+    }
+}
+
 // --- GUI RENDER (Runs in GUI Thread) ---
 
 /**
@@ -158,6 +199,10 @@ int32_t rfid_uart_app(void* p) {
     // 1. Allocation
     RfidUartApp* app = malloc(sizeof(RfidUartApp));
     app->temp_str = furi_string_alloc();
+    app->tx_seq = 0;
+    tag_dedupe_init(&app->dedupe, DEDUPE_HOLD_MS);
+    app->dedupe_timer = furi_timer_alloc(dedupe_timer_callback, FuriTimerTypeOnce, app);
+    app->notifications = furi_record_open(RECORD_NOTIFICATION);
     // Queue holds up to 8 events
     app->event_queue = furi_message_queue_alloc(8, sizeof(AppEvent));
 
@@ -204,31 +249,34 @@ int32_t rfid_uart_app(void* p) {
                 }
             }
             
+            // --- Forget tags that have left the reader ---
+            else if(event.type == EventTypeTick) {
+                dedupe_expire(app);
+            }
+
             // --- Handle RFID Reads ---
             else if(event.type == EventTypeRfidRead) {
-                // Update internal string for the UI
-                furi_string_set(app->temp_str, event.rfid_data);
-                view_port_update(app->view_port); // Trigger redraw
-
-                // Send data over UART
-                FURI_LOG_I("RFID", "Sent: %s", event.rfid_data);
-                send_uart_string(app, event.rfid_data);
-                
-                // Haptic Feedback
-                furi_hal_vibro_on(true);
-                furi_delay_ms(100);
-                furi_hal_vibro_on(false);
-
-                // --- Debounce Logic ---
-                // To prevent spamming the UART if the fob is held against the reader:
-                
-                // 1. Stop the *reading process* (keep thread alive)
-                lfrfid_worker_stop(app->lfrfid_worker); 
-                
-                // 2. Wait 1 second
-                furi_delay_ms(1000); 
-                
-                // 3. Resume the *reading process*
+                bool is_new = tag_dedupe_check(
+                    &app->dedupe, event.protocol, event.uid, event.uid_len, event.read_tick);
+                if(is_new) {
+                    // Update internal string for the UI
+                    furi_string_set(app->temp_str, event.rfid_data);
+                    view_port_update(app->view_port); // Trigger redraw
+
+                    // Send data over UART
+                    FURI_LOG_I("RFID", "Sent: %s", event.rfid_data);
+                    send_uart_frame(app, &event);
+
+                    // Haptic Feedback, played by the notification service
+                    notification_message(app->notifications, &sequence_single_vibro);
+                }
+
+                // A repeat read pushes the tag's expiry back
+                dedupe_expire(app);
+
+                // The worker's read mode ends once it has reported a tag; start it
+                // again straight away so the next tag is not kept waiting
+                lfrfid_worker_stop(app->lfrfid_worker);
                 lfrfid_worker_read_start(app->lfrfid_worker, LFRFIDWorkerReadTypeAuto, lfrfid_read_callback, app);
             }
         }
@@ -252,13 +300,18 @@ int32_t rfid_uart_app(void* p) {
     view_port_free(app->view_port);
     furi_record_close(RECORD_GUI);
 
-    // E. Cleanup UART
+    // E. Stop the dedupe timer before the queue it posts to is freed
+    furi_timer_stop(app->dedupe_timer);
+    furi_timer_free(app->dedupe_timer);
+    furi_record_close(RECORD_NOTIFICATION);
+
+    // F. Cleanup UART
     if(app->serial_handle) {
         furi_hal_serial_deinit(app->serial_handle);
         furi_hal_serial_control_release(app->serial_handle);
     }
 
-    // F. Free generic resources
+    // G. Free generic resources
     furi_message_queue_free(app->event_queue);
     furi_string_free(app->temp_str);
     free(app);
@@ -0,0 +1,63 @@
+/**
+ * @file tag_dedupe.c
+ * @brief Last-seen cache for repeat tag reads (see tag_dedupe.h).
+ */
+#include "tag_dedupe.h"
+#include <string.h>
+
+void tag_dedupe_init(TagDedupe* dedupe, uint32_t hold_ms) {
+    memset(dedupe, 0, sizeof(*dedupe));
+    dedupe->hold_ms = hold_ms;
+}
+
+// Unsigned difference, correct across tick wrap-around
+static bool expired(const TagDedupe* dedupe, const TagDedupeEntry* entry, uint32_t now) {
+    return now - entry->last_seen >= dedupe->hold_ms;
+}
+
+bool tag_dedupe_check(
+    TagDedupe* dedupe,
+    uint8_t protocol,
+    const uint8_t* uid,
+    size_t uid_len,
+    uint32_t now) {
+    if(uid_len > TAG_DEDUPE_MAX_UID) uid_len = TAG_DEDUPE_MAX_UID;
+
+    TagDedupeEntry* slot = NULL;
+    for(size_t i = 0; i < TAG_DEDUPE_SLOTS; i++) {
+        TagDedupeEntry* entry = &dedupe->entries[i];
+        if(entry->used && entry->protocol == protocol && entry->uid_len == uid_len &&
+           memcmp(entry->uid, uid, uid_len) == 0) {
+            // Held against the reader: a repeat, unless it had already gone
+            bool repeat = !expired(dedupe, entry, now);
+            entry->last_seen = now;
+            return !repeat;
+        }
+        // Otherwise remember it in a free slot, or in place of the tag seen longest ago
+        if(!slot || (slot->used && (!entry->used || now - entry->last_seen > now - slot->last_seen))) {
+            slot = entry;
+        }
+    }
+
+    slot->used = true;
+    slot->protocol = protocol;
+    slot->uid_len = (uint8_t)uid_len;
+    memcpy(slot->uid, uid, uid_len);
+    slot->last_seen = now;
+    return true;
+}
+
+uint32_t tag_dedupe_expire(TagDedupe* dedupe, uint32_t now) {
+    uint32_t next = 0;
+    for(size_t i = 0; i < TAG_DEDUPE_SLOTS; i++) {
+        TagDedupeEntry* entry = &dedupe->entries[i];
+        if(!entry->used) continue;
+        if(expired(dedupe, entry, now)) {
+            entry->used = false;
+            continue;
+        }
+        uint32_t left = dedupe->hold_ms - (now - entry->last_seen);
+        if(next == 0 || left < next) next = left;
+    }
+    return next;
+}
@@ -0,0 +1,50 @@
+/**
+ * @file tag_dedupe.h
+ * @brief Suppresses repeat reads of a tag held against the reader.
+ * * The reader reports a fob several times a second for as long as it is
+ * held there. A tag is passed on when it is first seen, and again only once
+ * it has been out of range for the hold time; each repeat read restarts that
+ * time. Other tags are passed on straight away.
+ * * Plain C with no Furi dependencies, so it can be built and tested on a host.
+ * Times are millisecond ticks and may wrap.
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define TAG_DEDUPE_SLOTS 8
+#define TAG_DEDUPE_MAX_UID 16
+
+typedef struct {
+    bool used;
+    uint8_t protocol;
+    uint8_t uid_len;
+    uint8_t uid[TAG_DEDUPE_MAX_UID];
+    uint32_t last_seen;
+} TagDedupeEntry;
+
+typedef struct {
+    uint32_t hold_ms;
+    TagDedupeEntry entries[TAG_DEDUPE_SLOTS];
+} TagDedupe;
+
+void tag_dedupe_init(TagDedupe* dedupe, uint32_t hold_ms);
+
+/**
+ * @brief Records a read
+ * @return true if the tag should be sent, false if it is a repeat
+ */
+bool tag_dedupe_check(
+    TagDedupe* dedupe,
+    uint8_t protocol,
+    const uint8_t* uid,
+    size_t uid_len,
+    uint32_t now);
+
+/**
+ * @brief Forgets tags that have been gone for the hold time
+ * @return ms until the next remembered tag expires, or 0 if none is left
+ */
+uint32_t tag_dedupe_expire(TagDedupe* dedupe, uint32_t now);